@@ -0,0 +1,14 @@
+#version 460
+
+// Fragment shader paired with IndirectDraw.vert, compile with
+//   glslc IndirectDraw.frag -o CompiledShaders/indirect_frag.spv
+
+layout(set = 1, binding = 2) uniform sampler2D texSampler;
+
+layout(location = 0) in vec2 fragTexCoord;
+
+layout(location = 0) out vec4 outColor;
+
+void main() {
+    outColor = texture(texSampler, fragTexCoord);
+}
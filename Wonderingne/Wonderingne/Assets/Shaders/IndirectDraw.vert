@@ -0,0 +1,59 @@
+#version 460
+
+// Vertex shader for indirect draws, compile with
+//   glslc IndirectDraw.vert -o CompiledShaders/indirect_vert.spv
+// Each multi draw call starts at drawDataBaseIndex, gl_DrawID picks the draw within it.
+
+// The pipeline variant's shader function (PipelineVariants.h), fixed when the pipeline is built so only its own path is compiled.
+layout(constant_id = 0) const uint SHADER_FUNCTION_ID = 0;
+const uint SHADER_FUNCTION_WORLD = 0;
+const uint SHADER_FUNCTION_UI_INSTANCE = 1;
+
+layout(set = 0, binding = 0) uniform CameraUniformBufferObject {
+    mat4 view;
+    mat4 proj;
+} camera;
+
+struct DrawData {
+    mat4 model;
+    vec4 boundingSphere;
+    vec4 positionDequantizationScale;
+    uint textureIndex;
+    uint instanceIndex;
+};
+
+layout(std430, set = 3, binding = 0) readonly buffer DrawDataBuffer {
+    DrawData draws[];
+} drawData;
+
+layout(std430, set = 2, binding = 3) readonly buffer UIInstanceModelBuffer {
+    mat4 instanceModels[];
+} uiInstances;
+
+// The first member is the shader function push constant of the prebuilt direct shaders, these read the specialization constant.
+layout(push_constant) uniform PushConstants {
+    layout(offset = 4) uint drawDataBaseIndex;
+} pushConstants;
+
+layout(location = 0) in vec3 inPosition;
+layout(location = 1) in vec2 inTexCoord;
+
+layout(location = 0) out vec2 fragTexCoord;
+layout(location = 1) flat out uint fragTextureIndex;
+
+// Has to match IndirectDrawDepth.vert bit for bit, the shading pass after the depth pre-pass tests with EQUAL.
+invariant gl_Position;
+
+void main() {
+
+    DrawData draw = drawData.draws[pushConstants.drawDataBaseIndex + gl_DrawID];
+    mat4 model = draw.model;
+
+    if (SHADER_FUNCTION_ID == SHADER_FUNCTION_UI_INSTANCE) {
+        model = uiInstances.instanceModels[gl_InstanceIndex] * model;
+    }
+
+    gl_Position = camera.proj * camera.view * model * vec4(inPosition, 1.0);
+    fragTexCoord = inTexCoord;
+    fragTextureIndex = draw.textureIndex;
+}
@@ -0,0 +1,17 @@
+#version 460
+#extension GL_EXT_nonuniform_qualifier : require
+
+// Fragment shader paired with IndirectDraw.vert when bindless textures are on, compile with
+//   glslc IndirectDrawBindless.frag -o CompiledShaders/indirect_bindless_frag.spv
+// The texture index comes from the draw data, so it can differ between the draws of one multi draw.
+
+layout(set = 4, binding = 0) uniform sampler2D textures[];
+
+layout(location = 0) in vec2 fragTexCoord;
+layout(location = 1) flat in uint fragTextureIndex;
+
+layout(location = 0) out vec4 outColor;
+
+void main() {
+    outColor = texture(textures[nonuniformEXT(fragTextureIndex)], fragTexCoord);
+}
@@ -1,30 +1,43 @@
 #pragma once
 
 #include "Model.h"
+#include "VertexFormats.h"
 
-static VkVertexInputBindingDescription GetBindingDescription() {
+template<typename VertexFormatType>
+constexpr std::array<VkVertexInputBindingDescription, VertexFormatType::bindingCount> GetBindingDescriptions() {
 
-    VkVertexInputBindingDescription bindingDescription{};
+    std::array<VkVertexInputBindingDescription, VertexFormatType::bindingCount> bindingDescriptions{};
 
-    bindingDescription.binding = 0;
-    bindingDescription.stride = sizeof(Vertex);
-    bindingDescription.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+    bindingDescriptions[0].binding = VertexFormatType::positionBinding;
+    bindingDescriptions[0].stride = VertexFormatType::positionStride;
+    bindingDescriptions[0].inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
 
-    return bindingDescription;
+    if constexpr (VertexFormatType::splitPositionStream) {
+        bindingDescriptions[1].binding = VertexFormatType::attributeBinding;
+        bindingDescriptions[1].stride = VertexFormatType::attributeStride;
+        bindingDescriptions[1].inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+    }
+
+    return bindingDescriptions;
 }
 
-static std::array<VkVertexInputAttributeDescription, 2> GetAttributeDescriptions() {
+template<typename VertexFormatType>
+constexpr std::array<VkVertexInputAttributeDescription, 2> GetAttributeDescriptions() {
     std::array<VkVertexInputAttributeDescription, 2> attributeDescriptions{};
 
-    attributeDescriptions[0].binding = 0;
+    attributeDescriptions[0].binding = VertexFormatType::positionBinding;
     attributeDescriptions[0].location = 0;
-    attributeDescriptions[0].format = VK_FORMAT_R32G32B32_SFLOAT;
-    attributeDescriptions[0].offset = offsetof(Vertex, position);
+    attributeDescriptions[0].format = VertexComponentTraits<typename VertexFormatType::PositionComponent>::format;
+    attributeDescriptions[0].offset = VertexFormatType::positionOffset;
 
-    attributeDescriptions[1].binding = 0;
+    attributeDescriptions[1].binding = VertexFormatType::attributeBinding;
     attributeDescriptions[1].location = 1;
-    attributeDescriptions[1].format = VK_FORMAT_R32G32_SFLOAT;
-    attributeDescriptions[1].offset = offsetof(Vertex, texCoord);
+    attributeDescriptions[1].format = VertexComponentTraits<typename VertexFormatType::TexCoordComponent>::format;
+    attributeDescriptions[1].offset = VertexFormatType::texCoordOffset;
 
     return attributeDescriptions;
 }
+
+// The full precision GPU layout has to stay byte compatible with the CPU side Vertex.
+static_assert(GetAttributeDescriptions<FullPrecisionVertexFormat>()[1].offset == offsetof(Vertex, texCoord));
+static_assert(FullPrecisionVertexFormat::bytesPerVertex == sizeof(Vertex));
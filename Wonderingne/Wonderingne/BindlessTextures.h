@@ -0,0 +1,19 @@
+#pragma once
+
+#include "DependencyIncludes.h"
+#include "StandardIncludes.h"
+
+#include "EngineConstants.h"
+
+// Every loaded texture in one partially bound sampler array, Texture::allLoadedTextures[i] sits at element i. Written once when the
+// texture's image view is created and never changed after that, so a single update after bind set serves every frame in flight.
+// The indirect shaders pick the texture with the index stored in the draw data, material changes no longer need a descriptor bind.
+struct BindlessTextures {
+
+public:
+
+	inline static VkDescriptorSetLayout vk_DescriptorSetLayout = VK_NULL_HANDLE;
+	inline static VkDescriptorPool vk_DescriptorPool = VK_NULL_HANDLE;
+	inline static VkDescriptorSet vk_DescriptorSet = VK_NULL_HANDLE;
+
+};
@@ -0,0 +1,129 @@
+#pragma once
+
+#include "BindlessTextures.h"
+
+#include "VulkanCreateUtils.h"
+
+#include <filesystem>
+
+// Only true when the device supports descriptor indexing and the bindless indirect shader is there, the indirect path binds the
+// material set per batch otherwise.
+bool IsBindlessTexturesActive() {
+    return BindlessTextures::vk_DescriptorSet != VK_NULL_HANDLE;
+}
+
+void CreateDescriptorSetLayoutForBindlessTextures() {
+
+    VkDescriptorSetLayoutBinding texturesLayoutBinding{};
+    texturesLayoutBinding.binding = BINDLESS_TEXTURES_BINDING_LOCATION;
+    texturesLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    texturesLayoutBinding.descriptorCount = MAX_BINDLESS_TEXTURES;
+    texturesLayoutBinding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+
+    // Elements past the loaded textures are never written, new textures are written while earlier frames still use the set.
+    VkDescriptorBindingFlags texturesBindingFlags = VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT | VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT | VK_DESCRIPTOR_BINDING_UPDATE_UNUSED_WHILE_PENDING_BIT;
+
+    VkDescriptorSetLayoutBindingFlagsCreateInfo bindingFlagsInfo{};
+    bindingFlagsInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO;
+    bindingFlagsInfo.bindingCount = 1;
+    bindingFlagsInfo.pBindingFlags = &texturesBindingFlags;
+
+    VkDescriptorSetLayoutCreateInfo layoutInfo{};
+    layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    layoutInfo.pNext = &bindingFlagsInfo;
+    layoutInfo.flags = VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT;
+    layoutInfo.bindingCount = 1;
+    layoutInfo.pBindings = &texturesLayoutBinding;
+
+    if (vkCreateDescriptorSetLayout(vk_LogicalDevice, &layoutInfo, nullptr, &BindlessTextures::vk_DescriptorSetLayout) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create bindless texture descriptor set layout!");
+    }
+}
+
+// Update after bind sets can not come from the shared pool, they need a pool created with the matching flag.
+void CreateDescriptorSetForBindlessTextures() {
+
+    VkDescriptorPoolSize poolSize{};
+    poolSize.type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    poolSize.descriptorCount = MAX_BINDLESS_TEXTURES;
+
+    VkDescriptorPoolCreateInfo poolInfo{};
+    poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    poolInfo.flags = VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT;
+    poolInfo.poolSizeCount = 1;
+    poolInfo.pPoolSizes = &poolSize;
+    poolInfo.maxSets = 1;
+
+    if (vkCreateDescriptorPool(vk_LogicalDevice, &poolInfo, nullptr, &BindlessTextures::vk_DescriptorPool) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create bindless texture descriptor pool!");
+    }
+
+    VkDescriptorSetAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    allocInfo.descriptorPool = BindlessTextures::vk_DescriptorPool;
+    allocInfo.descriptorSetCount = 1;
+    allocInfo.pSetLayouts = &BindlessTextures::vk_DescriptorSetLayout;
+
+    if (vkAllocateDescriptorSets(vk_LogicalDevice, &allocInfo, &BindlessTextures::vk_DescriptorSet) != VK_SUCCESS) {
+        throw std::runtime_error("failed to allocate bindless texture descriptor set!");
+    }
+}
+
+// Has to run before the pipeline layout is created, the bindless set is the last set of the layout when active.
+void CreateBindlessTextures() {
+
+    if (!USE_BINDLESS_TEXTURES || !USE_INDIRECT_DRAWS) {
+        return;
+    }
+
+    if (!bindlessTexturesEnabled) {
+        std::cout << "Device lacks the descriptor indexing features, bindless textures are disabled." << std::endl;
+        return;
+    }
+
+    if (!std::filesystem::exists(INDIRECT_DRAW_BINDLESS_FRAGMENT_SHADER_FILE_PATH)) {
+        std::cout << "Bindless fragment shader not found, bindless textures are disabled := " << INDIRECT_DRAW_BINDLESS_FRAGMENT_SHADER_FILE_PATH << std::endl;
+        return;
+    }
+
+    CreateDescriptorSetLayoutForBindlessTextures();
+    CreateDescriptorSetForBindlessTextures();
+}
+
+void DestroyBindlessTextures() {
+
+    if (!IsBindlessTexturesActive()) {
+        return;
+    }
+
+    vkDestroyDescriptorPool(vk_LogicalDevice, BindlessTextures::vk_DescriptorPool, nullptr);
+    vkDestroyDescriptorSetLayout(vk_LogicalDevice, BindlessTextures::vk_DescriptorSetLayout, nullptr);
+}
+
+// The image view has to exist, the upload itself may still be in flight since only usable uploads get drawn.
+void WriteBindlessTexture(uint32_t textureIndex, VkImageView textureImageView) {
+
+    if (!IsBindlessTexturesActive()) {
+        return;
+    }
+
+    if (textureIndex >= MAX_BINDLESS_TEXTURES) {
+        throw std::runtime_error("failed to write bindless texture, MAX_BINDLESS_TEXTURES is too small!");
+    }
+
+    VkDescriptorImageInfo imageInfo{};
+    imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    imageInfo.imageView = textureImageView;
+    imageInfo.sampler = vk_TextureSampler;
+
+    VkWriteDescriptorSet descriptorWrite{};
+    descriptorWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    descriptorWrite.dstSet = BindlessTextures::vk_DescriptorSet;
+    descriptorWrite.dstBinding = BINDLESS_TEXTURES_BINDING_LOCATION;
+    descriptorWrite.dstArrayElement = textureIndex;
+    descriptorWrite.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    descriptorWrite.descriptorCount = 1;
+    descriptorWrite.pImageInfo = &imageInfo;
+
+    vkUpdateDescriptorSets(vk_LogicalDevice, 1, &descriptorWrite, 0, nullptr);
+}
@@ -9,7 +9,7 @@ void CreateDescriptorSetLayoutForCameraUBO() {
     cameraUBOLayoutBinding.binding = CAMERA_UBO_BINDING_LOCATION;
     cameraUBOLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
     cameraUBOLayoutBinding.descriptorCount = 1;
-    cameraUBOLayoutBinding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+    cameraUBOLayoutBinding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_COMPUTE_BIT;      // Compute for the occlusion culling.
 
     std::array<VkDescriptorSetLayoutBinding, 1> bindings = { cameraUBOLayoutBinding };
 
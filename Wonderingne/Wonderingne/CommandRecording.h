@@ -0,0 +1,32 @@
+#pragma once
+
+#include "DependencyIncludes.h"
+#include "StandardIncludes.h"
+
+#include "EngineConstants.h"
+
+struct RenderQueue;
+
+// A contiguous range of a render queue's recorded items (draws, or batches with indirect draws), recorded into its own secondary.
+struct SecondaryRecordingJob {
+
+    const RenderQueue* renderQueue = nullptr;
+    uint32_t firstItem = 0;
+    uint32_t endItem = 0;
+    bool depthPrepass = false;
+    bool lateOcclusionPhase = false;
+};
+
+// Job i of a frame records into vk_CommandBuffers[frame][i], allocated from vk_CommandPools[frame][i]. Every job owns its pool, so
+// jobs can run on any worker thread without locking, and the pools are reset wholesale once the frame's fence has signalled.
+// Grown on the render thread when a frame needs more jobs than any frame before it.
+struct SecondaryCommandRecording {
+
+public:
+
+	inline static std::array<std::vector<VkCommandPool>, MAX_FRAMES_IN_FLIGHT> vk_CommandPools = {};
+	inline static std::array<std::vector<VkCommandBuffer>, MAX_FRAMES_IN_FLIGHT> vk_CommandBuffers = {};
+
+	inline static std::vector<SecondaryRecordingJob> jobs = {};
+
+};
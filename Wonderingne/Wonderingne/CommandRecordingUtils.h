@@ -0,0 +1,93 @@
+#pragma once
+
+#include "CommandRecording.h"
+
+#include "VulkanEngineVariables.h"
+#include "DynamicRenderingUtils.h"
+
+void EnsureSecondaryCommandBuffers(uint32_t indexOfDataForCurrentFrame, size_t commandBufferCount) {
+
+    std::vector<VkCommandPool>& commandPools = SecondaryCommandRecording::vk_CommandPools[indexOfDataForCurrentFrame];
+    std::vector<VkCommandBuffer>& commandBuffers = SecondaryCommandRecording::vk_CommandBuffers[indexOfDataForCurrentFrame];
+
+    while (commandPools.size() < commandBufferCount) {
+
+        VkCommandPoolCreateInfo poolInfo{};
+        poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+        poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+        poolInfo.queueFamilyIndex = graphicsQueueFamilyIndex;
+
+        VkCommandPool commandPool;
+        if (vkCreateCommandPool(vk_LogicalDevice, &poolInfo, nullptr, &commandPool) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create secondary command pool!");
+        }
+
+        VkCommandBufferAllocateInfo allocInfo{};
+        allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+        allocInfo.commandPool = commandPool;
+        allocInfo.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+        allocInfo.commandBufferCount = 1;
+
+        VkCommandBuffer commandBuffer;
+        if (vkAllocateCommandBuffers(vk_LogicalDevice, &allocInfo, &commandBuffer) != VK_SUCCESS) {
+            throw std::runtime_error("failed to allocate secondary command buffer!");
+        }
+
+        commandPools.push_back(commandPool);
+        commandBuffers.push_back(commandBuffer);
+    }
+}
+
+// Only once the frame's in flight fence has been waited on, resets the primary and every secondary recorded for the frame.
+void ResetFrameCommandPools(uint32_t indexOfDataForCurrentFrame) {
+
+    vkResetCommandPool(vk_LogicalDevice, vk_FrameCommandPools[indexOfDataForCurrentFrame], 0);
+
+    for (VkCommandPool commandPool : SecondaryCommandRecording::vk_CommandPools[indexOfDataForCurrentFrame]) {
+        vkResetCommandPool(vk_LogicalDevice, commandPool, 0);
+    }
+}
+
+// With dynamic rendering there is no render pass or framebuffer to inherit, the attachment formats BeginFrameRendering uses are inherited instead.
+void BeginSecondaryCommandBuffer(VkCommandBuffer commandBuffer, VkRenderPass renderPass, VkFramebuffer framebuffer) {
+
+    VkCommandBufferInheritanceInfo inheritanceInfo{};
+    inheritanceInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+    inheritanceInfo.renderPass = renderPass;
+    inheritanceInfo.subpass = 0;
+    inheritanceInfo.framebuffer = framebuffer;
+
+    VkCommandBufferInheritanceRenderingInfo inheritanceRenderingInfo{};
+    inheritanceRenderingInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_RENDERING_INFO;
+    inheritanceRenderingInfo.colorAttachmentCount = 1;
+    inheritanceRenderingInfo.pColorAttachmentFormats = &vk_SwapChainImageFormat;
+    inheritanceRenderingInfo.depthAttachmentFormat = FindDepthFormat();
+    inheritanceRenderingInfo.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+
+    if (IsDynamicRenderingActive()) {
+        inheritanceInfo.renderPass = VK_NULL_HANDLE;
+        inheritanceInfo.framebuffer = VK_NULL_HANDLE;
+        inheritanceInfo.pNext = &inheritanceRenderingInfo;
+    }
+
+    VkCommandBufferBeginInfo beginInfo{};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT | VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+    beginInfo.pInheritanceInfo = &inheritanceInfo;
+
+    if (vkBeginCommandBuffer(commandBuffer, &beginInfo) != VK_SUCCESS) {
+        throw std::runtime_error("failed to begin recording secondary command buffer!");
+    }
+}
+
+void DestroySecondaryCommandPools() {
+
+    for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+        for (VkCommandPool commandPool : SecondaryCommandRecording::vk_CommandPools[i]) {
+            vkDestroyCommandPool(vk_LogicalDevice, commandPool, nullptr);
+        }
+
+        SecondaryCommandRecording::vk_CommandPools[i].clear();
+        SecondaryCommandRecording::vk_CommandBuffers[i].clear();
+    }
+}
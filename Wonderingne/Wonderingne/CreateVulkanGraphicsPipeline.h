@@ -5,34 +5,85 @@
 #include "BindingDescriptions.h"
 #include "Camera.h"
 #include "UI.h"
+#include "IndirectDraw.h"
+#include "BindlessTexturesUtils.h"
+#include "PipelineCacheUtils.h"
+#include "PipelineVariants.h"
+#include "DynamicRenderingUtils.h"
 
-void CreateGraphicsPipeline(std::string& vertexShaderPath, std::string& fragmentShaderPath) {
+#include <filesystem>
+
+// Shared by every pipeline, the indirect draw data and bindless texture sets are simply unused by the direct shaders.
+void CreateGraphicsPipelineLayout() {
+
+    VkPushConstantRange shaderDecidingPushConstantRange = {};
+    shaderDecidingPushConstantRange.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+    shaderDecidingPushConstantRange.offset = 0;
+    shaderDecidingPushConstantRange.size = sizeof(SimplePushConstantData);
+
+
+    std::vector<VkDescriptorSetLayout> descriptorSetLayouts = { Camera::vk_CameraUBODescriptorSetLayout, Material::vk_DescriptorSetLayout, UI::vk_uiSSBODescriptorSetLayout, IndirectDrawBuffers::vk_DrawDataDescriptorSetLayout };
+    if (IsBindlessTexturesActive()) {
+        descriptorSetLayouts.push_back(BindlessTextures::vk_DescriptorSetLayout);
+    }
+
+    VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+    pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    pipelineLayoutInfo.setLayoutCount = static_cast<uint32_t>(descriptorSetLayouts.size());
+    pipelineLayoutInfo.pSetLayouts = descriptorSetLayouts.data();
+    pipelineLayoutInfo.pushConstantRangeCount = 1;
+    pipelineLayoutInfo.pPushConstantRanges = &shaderDecidingPushConstantRange;
+
+    if (vkCreatePipelineLayout(vk_LogicalDevice, &pipelineLayoutInfo, nullptr, &vk_PipelineLayout) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create pipeline layout!");
+    }
+}
+
+// Without a fragment shader path the pipeline is depth only, it fetches positions and nothing else and writes no color.
+VkPipeline CreateGraphicsPipelineFromShaders(const std::string& vertexShaderPath, const std::string& fragmentShaderPath, const PipelineVariantKey& variantKey) {
+
+    bool depthOnly = fragmentShaderPath.empty();
 
     VkShaderModule vertShaderModule = CreateShaderModule(vertexShaderPath);
-    VkShaderModule fragShaderModule = CreateShaderModule(fragmentShaderPath);
+    VkShaderModule fragShaderModule = depthOnly ? VK_NULL_HANDLE : CreateShaderModule(fragmentShaderPath);
+
+    // Shaders that do not declare the constant just ignore it.
+    VkSpecializationMapEntry shaderFunctionMapEntry{};
+    shaderFunctionMapEntry.constantID = SHADER_FUNCTION_SPECIALIZATION_CONSTANT_ID;
+    shaderFunctionMapEntry.offset = 0;
+    shaderFunctionMapEntry.size = sizeof(uint32_t);
+
+    VkSpecializationInfo specializationInfo{};
+    specializationInfo.mapEntryCount = 1;
+    specializationInfo.pMapEntries = &shaderFunctionMapEntry;
+    specializationInfo.dataSize = sizeof(uint32_t);
+    specializationInfo.pData = &variantKey.shaderFunctionID;
 
     VkPipelineShaderStageCreateInfo vertShaderStageInfo{};
     vertShaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
     vertShaderStageInfo.stage = VK_SHADER_STAGE_VERTEX_BIT;
     vertShaderStageInfo.module = vertShaderModule;
     vertShaderStageInfo.pName = "main";
+    vertShaderStageInfo.pSpecializationInfo = &specializationInfo;
 
     VkPipelineShaderStageCreateInfo fragShaderStageInfo{};
     fragShaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
     fragShaderStageInfo.stage = VK_SHADER_STAGE_FRAGMENT_BIT;
     fragShaderStageInfo.module = fragShaderModule;
     fragShaderStageInfo.pName = "main";
+    fragShaderStageInfo.pSpecializationInfo = &specializationInfo;
 
     std::array<VkPipelineShaderStageCreateInfo, 2> shaderStages = { vertShaderStageInfo, fragShaderStageInfo };
 
-    auto bindingDescription = GetBindingDescription();
-    auto attributeDescriptions = GetAttributeDescriptions();
+    constexpr auto bindingDescriptions = GetBindingDescriptions<GPUVertexFormat>();
+    constexpr auto attributeDescriptions = GetAttributeDescriptions<GPUVertexFormat>();
 
+    // Positions are always the first binding and attribute, with a split position stream the texture coordinates are never fetched.
     VkPipelineVertexInputStateCreateInfo vertexInputInfo{};
     vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
-    vertexInputInfo.vertexBindingDescriptionCount = 1;
-    vertexInputInfo.vertexAttributeDescriptionCount = static_cast<uint32_t>(attributeDescriptions.size());
-    vertexInputInfo.pVertexBindingDescriptions = &bindingDescription;
+    vertexInputInfo.vertexBindingDescriptionCount = depthOnly ? 1 : static_cast<uint32_t>(bindingDescriptions.size());
+    vertexInputInfo.vertexAttributeDescriptionCount = depthOnly ? 1 : static_cast<uint32_t>(attributeDescriptions.size());
+    vertexInputInfo.pVertexBindingDescriptions = bindingDescriptions.data();
     vertexInputInfo.pVertexAttributeDescriptions = attributeDescriptions.data();
 
     VkPipelineInputAssemblyStateCreateInfo inputAssembly{};
@@ -57,9 +108,9 @@ void CreateGraphicsPipeline(std::string& vertexShaderPath, std::string& fragment
 
     VkPipelineDepthStencilStateCreateInfo depthStencil{};
     depthStencil.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
-    depthStencil.depthTestEnable = VK_TRUE;
-    depthStencil.depthWriteEnable = VK_TRUE;
-    depthStencil.depthCompareOp = VK_COMPARE_OP_LESS;
+    depthStencil.depthTestEnable = variantKey.depthTestEnable;
+    depthStencil.depthWriteEnable = variantKey.depthWriteEnable;
+    depthStencil.depthCompareOp = variantKey.depthCompareOp;
     depthStencil.depthBoundsTestEnable = VK_FALSE;
     depthStencil.stencilTestEnable = VK_FALSE;
 
@@ -69,7 +120,7 @@ void CreateGraphicsPipeline(std::string& vertexShaderPath, std::string& fragment
     multisampling.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
 
     VkPipelineColorBlendAttachmentState colorBlendAttachment{};
-    colorBlendAttachment.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+    colorBlendAttachment.colorWriteMask = depthOnly ? 0 : VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
     colorBlendAttachment.blendEnable = VK_FALSE;
 
     VkPipelineColorBlendStateCreateInfo colorBlending{};
@@ -94,27 +145,9 @@ void CreateGraphicsPipeline(std::string& vertexShaderPath, std::string& fragment
     dynamicState.pDynamicStates = dynamicStates.data();
 
 
-    VkPushConstantRange shaderDecidingPushConstantRange = {};
-    shaderDecidingPushConstantRange.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
-    shaderDecidingPushConstantRange.offset = 0;
-    shaderDecidingPushConstantRange.size = sizeof(SimplePushConstantData);
-
-
-    std::array<VkDescriptorSetLayout, 3> descriptorSetLayouts = { Camera::vk_CameraUBODescriptorSetLayout, Material::vk_DescriptorSetLayout, UI::vk_uiSSBODescriptorSetLayout };
-    VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
-    pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-    pipelineLayoutInfo.setLayoutCount = static_cast<uint32_t>(descriptorSetLayouts.size());
-    pipelineLayoutInfo.pSetLayouts = descriptorSetLayouts.data();
-    pipelineLayoutInfo.pushConstantRangeCount = 1;
-    pipelineLayoutInfo.pPushConstantRanges = &shaderDecidingPushConstantRange;
-
-    if (vkCreatePipelineLayout(vk_LogicalDevice, &pipelineLayoutInfo, nullptr, &vk_PipelineLayout) != VK_SUCCESS) {
-        throw std::runtime_error("failed to create pipeline layout!");
-    }
-
     VkGraphicsPipelineCreateInfo pipelineInfo{};
     pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
-    pipelineInfo.stageCount = static_cast<uint32_t>(shaderStages.size());
+    pipelineInfo.stageCount = depthOnly ? 1 : static_cast<uint32_t>(shaderStages.size());
     pipelineInfo.pStages = shaderStages.data();
 
     pipelineInfo.pVertexInputState = &vertexInputInfo;
@@ -131,10 +164,113 @@ void CreateGraphicsPipeline(std::string& vertexShaderPath, std::string& fragment
     pipelineInfo.renderPass = vk_RenderPass;
     pipelineInfo.subpass = 0;
 
-    if (vkCreateGraphicsPipelines(vk_LogicalDevice, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &vk_GraphicsPipeline) != VK_SUCCESS) {
+    // Without a render pass the attachment formats come from here, the same ones CreateColorDepthRenderPass describes.
+    VkPipelineRenderingCreateInfo renderingInfo{};
+    renderingInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_RENDERING_CREATE_INFO;
+    renderingInfo.colorAttachmentCount = 1;
+    renderingInfo.pColorAttachmentFormats = &vk_SwapChainImageFormat;
+    renderingInfo.depthAttachmentFormat = FindDepthFormat();
+
+    if (IsDynamicRenderingActive()) {
+        pipelineInfo.renderPass = VK_NULL_HANDLE;
+        pipelineInfo.pNext = &renderingInfo;
+    }
+
+    VkPipeline pipeline;
+    if (vkCreateGraphicsPipelines(vk_LogicalDevice, PipelineCache::vk_PipelineCache, 1, &pipelineInfo, nullptr, &pipeline) != VK_SUCCESS) {
         throw std::runtime_error("failed to create graphics pipeline!");
     }
 
-    vkDestroyShaderModule(vk_LogicalDevice, fragShaderModule, nullptr);
+    if (!depthOnly) {
+        vkDestroyShaderModule(vk_LogicalDevice, fragShaderModule, nullptr);
+    }
     vkDestroyShaderModule(vk_LogicalDevice, vertShaderModule, nullptr);
+
+    return pipeline;
+}
+
+VkPipeline CreatePipelineVariant(const PipelineVariantKey& variantKey) {
+
+    if (variantKey.shaderProgram == PIPELINE_SHADER_PROGRAM_INDIRECT_DEPTH_ONLY) {
+        return CreateGraphicsPipelineFromShaders(DEPTH_PREPASS_VERTEX_SHADER_FILE_PATH, "", variantKey);
+    }
+
+    if (variantKey.shaderProgram == PIPELINE_SHADER_PROGRAM_INDIRECT) {
+        const std::string& indirectFragmentShaderPath = IsBindlessTexturesActive() ? INDIRECT_DRAW_BINDLESS_FRAGMENT_SHADER_FILE_PATH : INDIRECT_DRAW_FRAGMENT_SHADER_FILE_PATH;
+        return CreateGraphicsPipelineFromShaders(INDIRECT_DRAW_VERTEX_SHADER_FILE_PATH, indirectFragmentShaderPath, variantKey);
+    }
+
+    return CreateGraphicsPipelineFromShaders(PipelineVariants::directVertexShaderPath, PipelineVariants::directFragmentShaderPath, variantKey);
+}
+
+// Builds the variant the first time it is asked for. The variants the passes use are built up front in CreateGraphicsPipeline, so
+// recording jobs normally only look them up.
+VkPipeline GetPipelineVariant(const PipelineVariantKey& variantKey) {
+
+    std::lock_guard<std::mutex> lock(PipelineVariants::pipelinesMutex);
+
+    auto pipelineIterator = PipelineVariants::allPipelines.find(variantKey);
+    if (pipelineIterator != PipelineVariants::allPipelines.end()) {
+        return pipelineIterator->second;
+    }
+
+    VkPipeline pipeline = CreatePipelineVariant(variantKey);
+    PipelineVariants::allPipelines[variantKey] = pipeline;
+
+    return pipeline;
+}
+
+void DestroyPipelineVariants() {
+
+    for (auto& [variantKey, pipeline] : PipelineVariants::allPipelines) {
+        vkDestroyPipeline(vk_LogicalDevice, pipeline, nullptr);
+    }
+    PipelineVariants::allPipelines.clear();
+}
+
+void CreateGraphicsPipeline(std::string& vertexShaderPath, std::string& fragmentShaderPath) {
+
+    CreateGraphicsPipelineLayout();
+
+    PipelineVariants::directVertexShaderPath = vertexShaderPath;
+    PipelineVariants::directFragmentShaderPath = fragmentShaderPath;
+
+    PipelineVariantKey worldVariantKey{};
+    worldVariantKey.shaderFunctionID = SHADER_FUNCTION_WORLD;
+    vk_GraphicsPipeline = GetPipelineVariant(worldVariantKey);
+
+    PipelineVariantKey uiVariantKey{};
+    uiVariantKey.shaderFunctionID = SHADER_FUNCTION_UI_INSTANCE;
+    GetPipelineVariant(uiVariantKey);
+
+    // The indirect shaders live next to the others, without them everything is drawn directly.
+    if (USE_INDIRECT_DRAWS) {
+        if (std::filesystem::exists(INDIRECT_DRAW_VERTEX_SHADER_FILE_PATH) && std::filesystem::exists(INDIRECT_DRAW_FRAGMENT_SHADER_FILE_PATH)) {
+            PipelineVariantKey indirectVariantKey{};
+            indirectVariantKey.shaderProgram = PIPELINE_SHADER_PROGRAM_INDIRECT;
+            indirectVariantKey.shaderFunctionID = SHADER_FUNCTION_WORLD;
+            vk_IndirectGraphicsPipeline = GetPipelineVariant(indirectVariantKey);
+
+            // The pre-pass can be switched on at any time, so both of its pipelines and the EQUAL shading variant are built now.
+            if (USE_DEPTH_PREPASS && std::filesystem::exists(DEPTH_PREPASS_VERTEX_SHADER_FILE_PATH)) {
+
+                PipelineVariantKey depthPrepassVariantKey = indirectVariantKey;
+                depthPrepassVariantKey.shaderProgram = PIPELINE_SHADER_PROGRAM_INDIRECT_DEPTH_ONLY;
+                GetPipelineVariant(depthPrepassVariantKey);
+
+                PipelineVariantKey depthEqualVariantKey = indirectVariantKey;
+                depthEqualVariantKey.depthWriteEnable = VK_FALSE;
+                depthEqualVariantKey.depthCompareOp = VK_COMPARE_OP_EQUAL;
+                GetPipelineVariant(depthEqualVariantKey);
+
+                PipelineVariants::depthPrepassAvailable = true;
+            }
+            else if (USE_DEPTH_PREPASS) {
+                std::cout << "Depth pre-pass shader not found, the pre-pass is disabled := " << DEPTH_PREPASS_VERTEX_SHADER_FILE_PATH << std::endl;
+            }
+        }
+        else {
+            std::cout << "Indirect draw shaders not found, falling back to direct draws := " << INDIRECT_DRAW_VERTEX_SHADER_FILE_PATH << std::endl;
+        }
+    }
 }
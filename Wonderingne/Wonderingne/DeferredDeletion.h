@@ -0,0 +1,31 @@
+#pragma once
+
+#include "DependencyIncludes.h"
+#include "StandardIncludes.h"
+
+#include "EngineConstants.h"
+
+#include <deque>
+#include <functional>
+
+// Destroys something once the last frame submitted before it was retired has finished on the GPU.
+struct DeferredDeletion {
+
+    uint64_t lastFrameUsingIt = 0;
+    std::function<void()> destroy;
+};
+
+// Resources that frames in flight may still be using are retired here instead of destroyed behind vkDeviceWaitIdle. Every frame
+// submission is numbered, and since frames complete in submission order on the graphics queue, waiting for a frame slot completes
+// every frame up to the number that slot was submitted with.
+struct DeferredDeletionQueue {
+
+public:
+
+	inline static std::deque<DeferredDeletion> pendingDeletions = {};
+
+	inline static uint64_t submittedFrameCount = 0;
+	inline static uint64_t completedFrameCount = 0;
+	inline static std::array<uint64_t, MAX_FRAMES_IN_FLIGHT> frameNumbers = {};
+
+};
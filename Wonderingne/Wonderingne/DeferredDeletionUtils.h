@@ -0,0 +1,49 @@
+#pragma once
+
+#include "DeferredDeletion.h"
+
+// Anything recorded into a frame that is already submitted may be used until that frame completes, later frames no longer see it.
+void DeferDeletion(std::function<void()> destroy) {
+
+    DeferredDeletion deletion{};
+    deletion.lastFrameUsingIt = DeferredDeletionQueue::submittedFrameCount;
+    deletion.destroy = std::move(destroy);
+
+    DeferredDeletionQueue::pendingDeletions.push_back(std::move(deletion));
+}
+
+// For something the frame being recorded still uses, that frame only gets its number once it is submitted.
+void DeferDeletionAfterCurrentFrame(std::function<void()> destroy) {
+
+    DeferredDeletion deletion{};
+    deletion.lastFrameUsingIt = DeferredDeletionQueue::submittedFrameCount + 1;
+    deletion.destroy = std::move(destroy);
+
+    DeferredDeletionQueue::pendingDeletions.push_back(std::move(deletion));
+}
+
+void MarkFrameSubmitted(uint32_t frameIndex) {
+    DeferredDeletionQueue::frameNumbers[frameIndex] = ++DeferredDeletionQueue::submittedFrameCount;
+}
+
+// Called once the frame slot's fence or timeline value has been waited on.
+void MarkFrameCompleted(uint32_t frameIndex) {
+    DeferredDeletionQueue::completedFrameCount = std::max(DeferredDeletionQueue::completedFrameCount, DeferredDeletionQueue::frameNumbers[frameIndex]);
+}
+
+void ProcessDeferredDeletions() {
+
+    std::deque<DeferredDeletion>& pendingDeletions = DeferredDeletionQueue::pendingDeletions;
+
+    while (!pendingDeletions.empty() && pendingDeletions.front().lastFrameUsingIt <= DeferredDeletionQueue::completedFrameCount) {
+        pendingDeletions.front().destroy();
+        pendingDeletions.pop_front();
+    }
+}
+
+// The device has to be idle.
+void FlushDeferredDeletions() {
+
+    DeferredDeletionQueue::completedFrameCount = DeferredDeletionQueue::submittedFrameCount;
+    ProcessDeferredDeletions();
+}
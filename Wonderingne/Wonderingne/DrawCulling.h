@@ -0,0 +1,116 @@
+#pragma once
+
+#include "DependencyIncludes.h"
+#include "StandardIncludes.h"
+
+#include "EngineConstants.h"
+
+#include <deque>
+
+// Push constants of the culling compute shader, frustum planes are ax + by + cz + d >= 0 for points inside. Instances
+// [0, instanceCount) are culled.
+struct DrawCullingPushConstantData {
+	glm::vec4 frustumPlanes[6];
+	uint32_t instanceCount;
+};
+
+// One per GPU culled scene mesh, laid out as std430 (128 bytes, the struct is 16 byte aligned). model takes the mesh to its model's
+// space, position dequantization included, and the shader puts modelTransforms[modelTransformIndex] in front of it, so a moving
+// model rewrites one matrix a frame and its instances stay as they are. boundingSphere and positionDequantizationScale are the same
+// as in DrawData. indexCount, firstIndex and vertexOffset become the draw's command, batchIndex picks the batch it is compacted into.
+struct DrawCullingInstance {
+	alignas(16) glm::mat4 model;
+	glm::vec4 boundingSphere;
+	glm::vec4 positionDequantizationScale;
+	uint32_t textureIndex;
+	uint32_t indexCount;
+	uint32_t firstIndex;
+	int32_t vertexOffset;
+	uint32_t batchIndex;
+	uint32_t modelTransformIndex;
+	uint32_t padding[2];
+};
+
+// Instances sharing a material and index type, drawn with one vkCmdDrawIndexedIndirectCount. Its draws are compacted into
+// [firstDrawIndex, firstDrawIndex + instanceCount) of the culled buffers, and its count lands in drawCounts[firstDrawIndex].
+struct DrawCullingBatch {
+	int materialIndex = -1;
+	VkIndexType vk_IndexType = VK_INDEX_TYPE_UINT32;
+	uint32_t instanceCount = 0;
+	uint32_t firstDrawIndex = 0;
+};
+
+// A scene mesh waiting for its upload batch before it becomes an instance.
+struct DrawCullingPendingInstance {
+	uint32_t modelIndex = 0;
+	uint32_t meshIndex = 0;
+};
+
+// GPU driven culling of the scene. Every scene mesh is an instance in a persistent, device local buffer that is only written when
+// the instance changes, the CPU keeps a copy and queues the changed ones for upload. Every frame the compute pass tests all instances
+// against the frustum, builds the draw command and draw data of the visible ones and appends them to their batch's range in the
+// culled buffers. The per batch count feeds vkCmdDrawIndexedIndirectCount, so the CPU only touches models and batches each frame.
+struct DrawCulling {
+
+public:
+
+	// Shared by every frame in flight. The visibility is one uint per instance, used by the occlusion culling to remember whether it
+	// was drawn last frame. Both grow together with instanceCapacity, copied over on the GPU, and every frame rebinds them once it sees
+	// a new instanceBufferGeneration.
+	inline static VkBuffer vk_InstanceBuffer = VK_NULL_HANDLE;
+	inline static VmaAllocation vma_InstanceBufferAllocation = VK_NULL_HANDLE;
+	inline static VkBuffer vk_VisibilityBuffer = VK_NULL_HANDLE;
+	inline static VmaAllocation vma_VisibilityBufferAllocation = VK_NULL_HANDLE;
+	inline static uint32_t instanceCapacity = 0;
+	inline static uint32_t instanceBufferGeneration = 0;
+
+	// CPU copy of the instance buffer, indexed by Mesh::drawCullingInstanceIndex. Instances past uploadedInstanceCount have never
+	// reached the GPU and are left out of the culling pass.
+	inline static std::vector<DrawCullingInstance> instances = {};
+	inline static std::vector<bool> instanceUploadQueued = {};
+	inline static std::deque<uint32_t> queuedInstanceUploads = {};
+	inline static uint32_t uploadedInstanceCount = 0;
+
+	inline static std::deque<DrawCullingPendingInstance> pendingInstances = {};
+	inline static std::vector<DrawCullingBatch> batches = {};
+
+	// Per frame in flight and host visible, this frame's instance uploads, the transform of every model and the first draw index of
+	// every batch.
+	inline static std::array<VkBuffer, MAX_FRAMES_IN_FLIGHT> vk_InstanceUploadBuffers = {};
+	inline static std::array<VmaAllocation, MAX_FRAMES_IN_FLIGHT> vma_InstanceUploadBufferAllocations = {};
+	inline static std::array<DrawCullingInstance*, MAX_FRAMES_IN_FLIGHT> mappedInstanceUploads = {};
+
+	inline static std::array<VkBuffer, MAX_FRAMES_IN_FLIGHT> vk_ModelTransformBuffers = {};
+	inline static std::array<VmaAllocation, MAX_FRAMES_IN_FLIGHT> vma_ModelTransformBufferAllocations = {};
+	inline static std::array<glm::mat4*, MAX_FRAMES_IN_FLIGHT> mappedModelTransforms = {};
+
+	inline static std::array<VkBuffer, MAX_FRAMES_IN_FLIGHT> vk_BatchFirstDrawIndexBuffers = {};
+	inline static std::array<VmaAllocation, MAX_FRAMES_IN_FLIGHT> vma_BatchFirstDrawIndexBufferAllocations = {};
+	inline static std::array<uint32_t*, MAX_FRAMES_IN_FLIGHT> mappedBatchFirstDrawIndices = {};
+
+	// Per frame in flight and device local, written by the culling pass. Room for every instance, twice over with occlusion culling.
+	inline static std::array<VkBuffer, MAX_FRAMES_IN_FLIGHT> vk_CulledCommandBuffers = {};
+	inline static std::array<VmaAllocation, MAX_FRAMES_IN_FLIGHT> vma_CulledCommandBufferAllocations = {};
+
+	inline static std::array<VkBuffer, MAX_FRAMES_IN_FLIGHT> vk_CulledDrawDataBuffers = {};
+	inline static std::array<VmaAllocation, MAX_FRAMES_IN_FLIGHT> vma_CulledDrawDataBufferAllocations = {};
+
+	inline static std::array<VkBuffer, MAX_FRAMES_IN_FLIGHT> vk_DrawCountBuffers = {};
+	inline static std::array<VmaAllocation, MAX_FRAMES_IN_FLIGHT> vma_DrawCountBufferAllocations = {};
+
+	// What each frame's buffers and descriptor sets were last sized and written for, a frame grows its own once it falls behind.
+	inline static std::array<uint32_t, MAX_FRAMES_IN_FLIGHT> frameInstanceCapacities = {};
+	inline static std::array<uint32_t, MAX_FRAMES_IN_FLIGHT> frameModelCapacities = {};
+	inline static std::array<uint32_t, MAX_FRAMES_IN_FLIGHT> frameBatchCapacities = {};
+	inline static std::array<uint32_t, MAX_FRAMES_IN_FLIGHT> frameInstanceBufferGenerations = {};
+
+	inline static VkDescriptorSetLayout vk_CullDescriptorSetLayout = VK_NULL_HANDLE;
+	inline static int cullDescriptorSetIndex = -1;
+
+	// Same layout as the draw data set of IndirectDrawBuffers, pointing at the compacted draw data instead.
+	inline static int culledDrawDataDescriptorSetIndex = -1;
+
+	inline static VkPipelineLayout vk_CullPipelineLayout = VK_NULL_HANDLE;
+	inline static VkPipeline vk_CullPipeline = VK_NULL_HANDLE;
+
+};
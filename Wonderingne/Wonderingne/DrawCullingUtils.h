@@ -0,0 +1,543 @@
+#pragma once
+
+#include "DrawCulling.h"
+#include "IndirectDraw.h"
+#include "Model.h"
+
+#include "VulkanCreateUtils.h"
+#include "FrustumCullingUtils.h"
+#include "PipelineCacheUtils.h"
+#include "IndirectDrawUtils.h"
+#include "BindlessTexturesUtils.h"
+#include "VertexFormatUtils.h"
+#include "DeferredDeletionUtils.h"
+
+#include <filesystem>
+
+// Only true when everything the culling pass needs is there, draws go through the unculled indirect path otherwise.
+bool IsGPUDrawCullingActive() {
+    return DrawCulling::vk_CullPipeline != VK_NULL_HANDLE;
+}
+
+void CreateDescriptorSetLayoutForDrawCulling() {
+
+    // Instances, model transforms, batch first draw indices, culled commands, culled draw data, draw counts, visibility.
+    std::array<VkDescriptorSetLayoutBinding, 7> bindings = {};
+    for (uint32_t i = 0; i < bindings.size(); i++)
+    {
+        bindings[i].binding = i;
+        bindings[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        bindings[i].descriptorCount = 1;
+        bindings[i].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    }
+
+    VkDescriptorSetLayoutCreateInfo layoutInfo{};
+    layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    layoutInfo.bindingCount = static_cast<uint32_t>(bindings.size());
+    layoutInfo.pBindings = bindings.data();
+
+    if (vkCreateDescriptorSetLayout(vk_LogicalDevice, &layoutInfo, nullptr, &DrawCulling::vk_CullDescriptorSetLayout) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create draw culling descriptor set layout!");
+    }
+}
+
+// Replaces the shared instance and visibility buffers, whoever grows them copies the old contents over and retires the old ones.
+void CreateDrawCullingInstanceBuffers_VMA(uint32_t instanceCapacity) {
+
+    CreateBuffer_VMA(sizeof(DrawCullingInstance) * static_cast<VkDeviceSize>(instanceCapacity), 0, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, DrawCulling::vk_InstanceBuffer, DrawCulling::vma_InstanceBufferAllocation);
+    vmaSetAllocationName(vma_Allocator, DrawCulling::vma_InstanceBufferAllocation, "Draw Culling Instances");
+
+    CreateBuffer_VMA(sizeof(uint32_t) * static_cast<VkDeviceSize>(instanceCapacity), 0, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, DrawCulling::vk_VisibilityBuffer, DrawCulling::vma_VisibilityBufferAllocation);
+    vmaSetAllocationName(vma_Allocator, DrawCulling::vma_VisibilityBufferAllocation, "Draw Culling Visibility");
+
+    DrawCulling::instanceCapacity = instanceCapacity;
+    DrawCulling::instanceBufferGeneration++;
+}
+
+void CreateDrawCullingInstanceUploadBuffers_VMA() {
+
+    for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+
+        CreateBuffer_VMA(sizeof(DrawCullingInstance) * MAX_DRAW_CULLING_INSTANCE_UPLOADS_PER_FRAME, VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT | VMA_ALLOCATION_CREATE_MAPPED_BIT, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, DrawCulling::vk_InstanceUploadBuffers[i], DrawCulling::vma_InstanceUploadBufferAllocations[i]);
+        vmaSetAllocationName(vma_Allocator, DrawCulling::vma_InstanceUploadBufferAllocations[i], "Draw Culling Instance Uploads");
+
+        VmaAllocationInfo allocationInfo;
+        vmaGetAllocationInfo(vma_Allocator, DrawCulling::vma_InstanceUploadBufferAllocations[i], &allocationInfo);
+        DrawCulling::mappedInstanceUploads[i] = static_cast<DrawCullingInstance*>(allocationInfo.pMappedData);
+    }
+}
+
+void CreateDrawCullingFrameBuffers_VMA(size_t frameIndex, uint32_t instanceCapacity, uint32_t modelCapacity, uint32_t batchCapacity) {
+
+    VmaAllocationInfo allocationInfo;
+
+    CreateBuffer_VMA(sizeof(glm::mat4) * modelCapacity, VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT | VMA_ALLOCATION_CREATE_MAPPED_BIT, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, DrawCulling::vk_ModelTransformBuffers[frameIndex], DrawCulling::vma_ModelTransformBufferAllocations[frameIndex]);
+    vmaSetAllocationName(vma_Allocator, DrawCulling::vma_ModelTransformBufferAllocations[frameIndex], "Draw Culling Model Transforms");
+
+    vmaGetAllocationInfo(vma_Allocator, DrawCulling::vma_ModelTransformBufferAllocations[frameIndex], &allocationInfo);
+    DrawCulling::mappedModelTransforms[frameIndex] = static_cast<glm::mat4*>(allocationInfo.pMappedData);
+
+    CreateBuffer_VMA(sizeof(uint32_t) * batchCapacity, VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT | VMA_ALLOCATION_CREATE_MAPPED_BIT, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, DrawCulling::vk_BatchFirstDrawIndexBuffers[frameIndex], DrawCulling::vma_BatchFirstDrawIndexBufferAllocations[frameIndex]);
+    vmaSetAllocationName(vma_Allocator, DrawCulling::vma_BatchFirstDrawIndexBufferAllocations[frameIndex], "Draw Culling Batch First Draw Indices");
+
+    vmaGetAllocationInfo(vma_Allocator, DrawCulling::vma_BatchFirstDrawIndexBufferAllocations[frameIndex], &allocationInfo);
+    DrawCulling::mappedBatchFirstDrawIndices[frameIndex] = static_cast<uint32_t*>(allocationInfo.pMappedData);
+
+    // The late phase of the occlusion culling writes its draws and counts instanceCapacity draws after the early phase's.
+    VkDeviceSize culledDrawCount = USE_OCCLUSION_CULLING ? 2 * static_cast<VkDeviceSize>(instanceCapacity) : instanceCapacity;
+
+    CreateBuffer_VMA(sizeof(VkDrawIndexedIndirectCommand) * culledDrawCount, 0, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, DrawCulling::vk_CulledCommandBuffers[frameIndex], DrawCulling::vma_CulledCommandBufferAllocations[frameIndex]);
+    vmaSetAllocationName(vma_Allocator, DrawCulling::vma_CulledCommandBufferAllocations[frameIndex], "Culled Indirect Draw Commands");
+
+    CreateBuffer_VMA(sizeof(DrawData) * culledDrawCount, 0, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, DrawCulling::vk_CulledDrawDataBuffers[frameIndex], DrawCulling::vma_CulledDrawDataBufferAllocations[frameIndex]);
+    vmaSetAllocationName(vma_Allocator, DrawCulling::vma_CulledDrawDataBufferAllocations[frameIndex], "Culled Indirect Draw Data");
+
+    CreateBuffer_VMA(sizeof(uint32_t) * culledDrawCount, 0, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, DrawCulling::vk_DrawCountBuffers[frameIndex], DrawCulling::vma_DrawCountBufferAllocations[frameIndex]);
+    vmaSetAllocationName(vma_Allocator, DrawCulling::vma_DrawCountBufferAllocations[frameIndex], "Indirect Draw Counts");
+
+    DrawCulling::frameInstanceCapacities[frameIndex] = instanceCapacity;
+    DrawCulling::frameModelCapacities[frameIndex] = modelCapacity;
+    DrawCulling::frameBatchCapacities[frameIndex] = batchCapacity;
+}
+
+void DestroyDrawCullingFrameBuffers(size_t frameIndex) {
+    vmaDestroyBuffer(vma_Allocator, DrawCulling::vk_ModelTransformBuffers[frameIndex], DrawCulling::vma_ModelTransformBufferAllocations[frameIndex]);
+    vmaDestroyBuffer(vma_Allocator, DrawCulling::vk_BatchFirstDrawIndexBuffers[frameIndex], DrawCulling::vma_BatchFirstDrawIndexBufferAllocations[frameIndex]);
+    vmaDestroyBuffer(vma_Allocator, DrawCulling::vk_CulledCommandBuffers[frameIndex], DrawCulling::vma_CulledCommandBufferAllocations[frameIndex]);
+    vmaDestroyBuffer(vma_Allocator, DrawCulling::vk_CulledDrawDataBuffers[frameIndex], DrawCulling::vma_CulledDrawDataBufferAllocations[frameIndex]);
+    vmaDestroyBuffer(vma_Allocator, DrawCulling::vk_DrawCountBuffers[frameIndex], DrawCulling::vma_DrawCountBufferAllocations[frameIndex]);
+}
+
+void AllocateDescriptorSetsForDrawCulling() {
+
+    DrawCulling::cullDescriptorSetIndex = static_cast<int>(vk_DescriptorSetsForEachFlightFrame.size());
+    vk_DescriptorSetsForEachFlightFrame.push_back(std::array<VkDescriptorSet, MAX_FRAMES_IN_FLIGHT>());
+
+    DrawCulling::culledDrawDataDescriptorSetIndex = static_cast<int>(vk_DescriptorSetsForEachFlightFrame.size());
+    vk_DescriptorSetsForEachFlightFrame.push_back(std::array<VkDescriptorSet, MAX_FRAMES_IN_FLIGHT>());
+
+    std::vector<VkDescriptorSetLayout> cullLayouts(MAX_FRAMES_IN_FLIGHT, DrawCulling::vk_CullDescriptorSetLayout);
+    VkDescriptorSetAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    allocInfo.descriptorPool = vk_DescriptorPool;
+    allocInfo.descriptorSetCount = static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT);
+    allocInfo.pSetLayouts = cullLayouts.data();
+
+    if (vkAllocateDescriptorSets(vk_LogicalDevice, &allocInfo, vk_DescriptorSetsForEachFlightFrame[DrawCulling::cullDescriptorSetIndex].data()) != VK_SUCCESS) {
+        throw std::runtime_error("failed to allocate draw culling descriptor sets!");
+    }
+
+    std::vector<VkDescriptorSetLayout> drawDataLayouts(MAX_FRAMES_IN_FLIGHT, IndirectDrawBuffers::vk_DrawDataDescriptorSetLayout);
+    allocInfo.pSetLayouts = drawDataLayouts.data();
+
+    if (vkAllocateDescriptorSets(vk_LogicalDevice, &allocInfo, vk_DescriptorSetsForEachFlightFrame[DrawCulling::culledDrawDataDescriptorSetIndex].data()) != VK_SUCCESS) {
+        throw std::runtime_error("failed to allocate culled draw data descriptor sets!");
+    }
+}
+
+// Only while no submitted command buffer of the frame is pending, so at creation or once its fence has been waited on.
+void WriteDrawCullingDescriptorSets(size_t frameIndex) {
+
+    std::array<VkBuffer, 7> cullBuffers = {
+        DrawCulling::vk_InstanceBuffer,
+        DrawCulling::vk_ModelTransformBuffers[frameIndex],
+        DrawCulling::vk_BatchFirstDrawIndexBuffers[frameIndex],
+        DrawCulling::vk_CulledCommandBuffers[frameIndex],
+        DrawCulling::vk_CulledDrawDataBuffers[frameIndex],
+        DrawCulling::vk_DrawCountBuffers[frameIndex],
+        DrawCulling::vk_VisibilityBuffer
+    };
+
+    std::array<VkDescriptorBufferInfo, 8> bufferInfos{};
+    std::array<VkWriteDescriptorSet, 8> descriptorWrites{};
+
+    for (uint32_t binding = 0; binding < cullBuffers.size(); binding++)
+    {
+        bufferInfos[binding].buffer = cullBuffers[binding];
+        bufferInfos[binding].offset = 0;
+        bufferInfos[binding].range = VK_WHOLE_SIZE;
+
+        descriptorWrites[binding].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        descriptorWrites[binding].dstSet = vk_DescriptorSetsForEachFlightFrame[DrawCulling::cullDescriptorSetIndex][frameIndex];
+        descriptorWrites[binding].dstBinding = binding;
+        descriptorWrites[binding].dstArrayElement = 0;
+        descriptorWrites[binding].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        descriptorWrites[binding].descriptorCount = 1;
+        descriptorWrites[binding].pBufferInfo = &bufferInfos[binding];
+    }
+
+    bufferInfos[7].buffer = DrawCulling::vk_CulledDrawDataBuffers[frameIndex];
+    bufferInfos[7].offset = 0;
+    bufferInfos[7].range = VK_WHOLE_SIZE;
+
+    descriptorWrites[7].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    descriptorWrites[7].dstSet = vk_DescriptorSetsForEachFlightFrame[DrawCulling::culledDrawDataDescriptorSetIndex][frameIndex];
+    descriptorWrites[7].dstBinding = DRAW_DATA_SSBO_BINDING_LOCATION;
+    descriptorWrites[7].dstArrayElement = 0;
+    descriptorWrites[7].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    descriptorWrites[7].descriptorCount = 1;
+    descriptorWrites[7].pBufferInfo = &bufferInfos[7];
+
+    vkUpdateDescriptorSets(vk_LogicalDevice, static_cast<uint32_t>(descriptorWrites.size()), descriptorWrites.data(), 0, nullptr);
+
+    DrawCulling::frameInstanceBufferGenerations[frameIndex] = DrawCulling::instanceBufferGeneration;
+}
+
+void CreateDrawCullingPipeline() {
+
+    VkPushConstantRange pushConstantRange = {};
+    pushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    pushConstantRange.offset = 0;
+    pushConstantRange.size = sizeof(DrawCullingPushConstantData);
+
+    VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+    pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    pipelineLayoutInfo.setLayoutCount = 1;
+    pipelineLayoutInfo.pSetLayouts = &DrawCulling::vk_CullDescriptorSetLayout;
+    pipelineLayoutInfo.pushConstantRangeCount = 1;
+    pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+
+    if (vkCreatePipelineLayout(vk_LogicalDevice, &pipelineLayoutInfo, nullptr, &DrawCulling::vk_CullPipelineLayout) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create draw culling pipeline layout!");
+    }
+
+    VkShaderModule computeShaderModule = CreateShaderModule(DRAW_CULLING_COMPUTE_SHADER_FILE_PATH);
+
+    VkComputePipelineCreateInfo pipelineInfo{};
+    pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+    pipelineInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    pipelineInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+    pipelineInfo.stage.module = computeShaderModule;
+    pipelineInfo.stage.pName = "main";
+    pipelineInfo.layout = DrawCulling::vk_CullPipelineLayout;
+
+    if (vkCreateComputePipelines(vk_LogicalDevice, PipelineCache::vk_PipelineCache, 1, &pipelineInfo, nullptr, &DrawCulling::vk_CullPipeline) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create draw culling pipeline!");
+    }
+
+    vkDestroyShaderModule(vk_LogicalDevice, computeShaderModule, nullptr);
+}
+
+// Needs the draw data descriptor set layout. Leaves culling off when the scene is not drawn indirectly with frustum culling, or when
+// the device or the shaders are missing.
+void CreateDrawCulling() {
+
+    if (!USE_GPU_DRAW_CULLING || !USE_INDIRECT_DRAWS || !USE_FRUSTUM_CULLING || vk_IndirectGraphicsPipeline == VK_NULL_HANDLE) {
+        return;
+    }
+
+    // The culled count of a batch is only known on the GPU, so every batch has to be a multi draw with a GPU side count.
+    if (!drawIndirectCountEnabled || !multiDrawIndirectEnabled) {
+        std::cout << "Device lacks drawIndirectCount or multiDrawIndirect, GPU draw culling is disabled." << std::endl;
+        return;
+    }
+
+    if (!std::filesystem::exists(DRAW_CULLING_COMPUTE_SHADER_FILE_PATH)) {
+        std::cout << "Draw culling shader not found, GPU draw culling is disabled := " << DRAW_CULLING_COMPUTE_SHADER_FILE_PATH << std::endl;
+        return;
+    }
+
+    CreateDescriptorSetLayoutForDrawCulling();
+
+    // Zeroed, so the first frame draws nothing early and everything visible late.
+    CreateDrawCullingInstanceBuffers_VMA(INITIAL_DRAW_CULLING_INSTANCE_CAPACITY);
+    VkCommandBuffer commandBuffer = BeginSingleTimeCommands();
+    vkCmdFillBuffer(commandBuffer, DrawCulling::vk_VisibilityBuffer, 0, VK_WHOLE_SIZE, 0);
+    EndSingleTimeCommands(commandBuffer);
+
+    CreateDrawCullingInstanceUploadBuffers_VMA();
+    AllocateDescriptorSetsForDrawCulling();
+
+    for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+        CreateDrawCullingFrameBuffers_VMA(i, INITIAL_INDIRECT_DRAWS_PER_FRAME, INITIAL_DRAW_CULLING_MODEL_CAPACITY, INITIAL_DRAW_CULLING_BATCH_CAPACITY);
+        WriteDrawCullingDescriptorSets(i);
+    }
+
+    CreateDrawCullingPipeline();
+}
+
+void DestroyDrawCulling() {
+
+    if (!IsGPUDrawCullingActive()) {
+        return;
+    }
+
+    vkDestroyPipeline(vk_LogicalDevice, DrawCulling::vk_CullPipeline, nullptr);
+    vkDestroyPipelineLayout(vk_LogicalDevice, DrawCulling::vk_CullPipelineLayout, nullptr);
+    vkDestroyDescriptorSetLayout(vk_LogicalDevice, DrawCulling::vk_CullDescriptorSetLayout, nullptr);
+
+    for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+        DestroyDrawCullingFrameBuffers(i);
+        vmaDestroyBuffer(vma_Allocator, DrawCulling::vk_InstanceUploadBuffers[i], DrawCulling::vma_InstanceUploadBufferAllocations[i]);
+    }
+
+    vmaDestroyBuffer(vma_Allocator, DrawCulling::vk_InstanceBuffer, DrawCulling::vma_InstanceBufferAllocation);
+    vmaDestroyBuffer(vma_Allocator, DrawCulling::vk_VisibilityBuffer, DrawCulling::vma_VisibilityBufferAllocation);
+}
+
+// Scene meshes become instances once their upload batch is usable, see RegisterUsableDrawCullingInstances.
+void QueueDrawCullingInstances(const std::vector<Model>& models, size_t firstModelIndex) {
+
+    if (!IsGPUDrawCullingActive()) {
+        return;
+    }
+
+    for (size_t i = firstModelIndex; i < models.size(); i++)
+    {
+        for (size_t j = 0; j < models[i].meshes.size(); j++)
+        {
+            DrawCullingPendingInstance pendingInstance{};
+            pendingInstance.modelIndex = static_cast<uint32_t>(i);
+            pendingInstance.meshIndex = static_cast<uint32_t>(j);
+
+            DrawCulling::pendingInstances.push_back(pendingInstance);
+        }
+    }
+}
+
+uint32_t FindOrAddDrawCullingBatch(int materialIndex, VkIndexType indexType) {
+
+    // With bindless textures the material only changes the draw data, batches then only split on the index type.
+    int batchMaterialIndex = IsBindlessTexturesActive() ? -1 : materialIndex;
+
+    for (uint32_t i = 0; i < DrawCulling::batches.size(); i++)
+    {
+        if (DrawCulling::batches[i].materialIndex == batchMaterialIndex && DrawCulling::batches[i].vk_IndexType == indexType) {
+            return i;
+        }
+    }
+
+    DrawCullingBatch batch{};
+    batch.materialIndex = batchMaterialIndex;
+    batch.vk_IndexType = indexType;
+
+    DrawCulling::batches.push_back(batch);
+
+    return static_cast<uint32_t>(DrawCulling::batches.size() - 1);
+}
+
+// The only way an instance changes. Rewrites the CPU copy from the mesh and queues it for upload, a mesh without an instance gets one.
+void UpdateDrawCullingInstance(Mesh& curMesh, uint32_t modelIndex) {
+
+    if (curMesh.drawCullingInstanceIndex == UINT32_MAX) {
+        curMesh.drawCullingInstanceIndex = static_cast<uint32_t>(DrawCulling::instances.size());
+        DrawCulling::instances.push_back({});
+        DrawCulling::instanceUploadQueued.push_back(false);
+    }
+    else {
+        DrawCulling::batches[DrawCulling::instances[curMesh.drawCullingInstanceIndex].batchIndex].instanceCount--;
+    }
+
+    DrawCullingInstance& instance = DrawCulling::instances[curMesh.drawCullingInstanceIndex];
+    instance.model = GetPositionDequantizationMatrix(curMesh);
+    instance.boundingSphere = glm::vec4((curMesh.localBounds.sphereCenter - curMesh.positionDequantizationOffset) / curMesh.positionDequantizationScale, curMesh.localBounds.sphereRadius);
+    instance.positionDequantizationScale = glm::vec4(curMesh.positionDequantizationScale, 1.0f);
+    instance.textureIndex = static_cast<uint32_t>(Material::allLoadedMaterials[curMesh.materialIndex].diffuseTextureIndex);
+    instance.indexCount = static_cast<uint32_t>(curMesh.indices.size());
+    instance.firstIndex = curMesh.firstIndex;
+    instance.vertexOffset = curMesh.vertexOffset;
+    instance.batchIndex = FindOrAddDrawCullingBatch(curMesh.materialIndex, curMesh.vk_IndexType);
+    instance.modelTransformIndex = modelIndex;
+
+    DrawCulling::batches[instance.batchIndex].instanceCount++;
+
+    if (!DrawCulling::instanceUploadQueued[curMesh.drawCullingInstanceIndex]) {
+        DrawCulling::instanceUploadQueued[curMesh.drawCullingInstanceIndex] = true;
+        DrawCulling::queuedInstanceUploads.push_back(curMesh.drawCullingInstanceIndex);
+    }
+}
+
+// Meshes are queued in upload order and upload batches become usable in order, so this stops at the first one still in flight.
+void RegisterUsableDrawCullingInstances(std::vector<Model>& models) {
+
+    while (!DrawCulling::pendingInstances.empty()) {
+
+        const DrawCullingPendingInstance& pendingInstance = DrawCulling::pendingInstances.front();
+        Mesh& curMesh = models[pendingInstance.modelIndex].meshes[pendingInstance.meshIndex];
+
+        if (!IsUploadBatchUsable(curMesh.uploadBatchID)) {
+            break;
+        }
+
+        UpdateDrawCullingInstance(curMesh, pendingInstance.modelIndex);
+        DrawCulling::pendingInstances.pop_front();
+    }
+}
+
+// Grows the shared buffers once there are more instances than they hold. Frames in flight still read the old ones, so the contents
+// are copied over in this frame's command buffer and the old buffers are retired once this frame is done with the copy.
+void RecordDrawCullingInstanceCapacityGrowth(VkCommandBuffer commandBuffer) {
+
+    uint32_t instanceCount = static_cast<uint32_t>(DrawCulling::instances.size());
+    if (instanceCount <= DrawCulling::instanceCapacity) {
+        return;
+    }
+
+    uint32_t oldInstanceCapacity = DrawCulling::instanceCapacity;
+    VkBuffer oldInstanceBuffer = DrawCulling::vk_InstanceBuffer;
+    VmaAllocation oldInstanceBufferAllocation = DrawCulling::vma_InstanceBufferAllocation;
+    VkBuffer oldVisibilityBuffer = DrawCulling::vk_VisibilityBuffer;
+    VmaAllocation oldVisibilityBufferAllocation = DrawCulling::vma_VisibilityBufferAllocation;
+
+    CreateDrawCullingInstanceBuffers_VMA(GetGrownCapacity(oldInstanceCapacity, instanceCount));
+
+    // Earlier frames upload into the instances and the late occlusion phase writes the visibility.
+    VkMemoryBarrier readBarrier{};
+    readBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    readBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+    readBarrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 1, &readBarrier, 0, nullptr, 0, nullptr);
+
+    VkBufferCopy instanceCopyRegion{};
+    instanceCopyRegion.size = sizeof(DrawCullingInstance) * static_cast<VkDeviceSize>(oldInstanceCapacity);
+    vkCmdCopyBuffer(commandBuffer, oldInstanceBuffer, DrawCulling::vk_InstanceBuffer, 1, &instanceCopyRegion);
+
+    VkBufferCopy visibilityCopyRegion{};
+    visibilityCopyRegion.size = sizeof(uint32_t) * static_cast<VkDeviceSize>(oldInstanceCapacity);
+    vkCmdCopyBuffer(commandBuffer, oldVisibilityBuffer, DrawCulling::vk_VisibilityBuffer, 1, &visibilityCopyRegion);
+    vkCmdFillBuffer(commandBuffer, DrawCulling::vk_VisibilityBuffer, visibilityCopyRegion.size, VK_WHOLE_SIZE, 0);
+
+    DeferDeletionAfterCurrentFrame([=]() {
+        vmaDestroyBuffer(vma_Allocator, oldInstanceBuffer, oldInstanceBufferAllocation);
+        vmaDestroyBuffer(vma_Allocator, oldVisibilityBuffer, oldVisibilityBufferAllocation);
+    });
+}
+
+// This frame's fence has been waited on, so its own buffers can be replaced right away. Only its descriptor sets are rewritten, the
+// other frames catch up when their turn comes.
+void EnsureDrawCullingFrameBuffers(uint32_t modelCount) {
+
+    uint32_t instanceCount = static_cast<uint32_t>(DrawCulling::instances.size());
+    uint32_t batchCount = static_cast<uint32_t>(DrawCulling::batches.size());
+
+    uint32_t instanceCapacity = DrawCulling::frameInstanceCapacities[indexOfDataForCurrentFrame];
+    uint32_t modelCapacity = DrawCulling::frameModelCapacities[indexOfDataForCurrentFrame];
+    uint32_t batchCapacity = DrawCulling::frameBatchCapacities[indexOfDataForCurrentFrame];
+
+    bool grow = instanceCount > instanceCapacity || modelCount > modelCapacity || batchCount > batchCapacity;
+
+    if (grow) {
+        DestroyDrawCullingFrameBuffers(indexOfDataForCurrentFrame);
+        CreateDrawCullingFrameBuffers_VMA(indexOfDataForCurrentFrame, GetGrownCapacity(instanceCapacity, instanceCount), GetGrownCapacity(modelCapacity, modelCount), GetGrownCapacity(batchCapacity, batchCount));
+    }
+
+    if (grow || DrawCulling::frameInstanceBufferGenerations[indexOfDataForCurrentFrame] != DrawCulling::instanceBufferGeneration) {
+        WriteDrawCullingDescriptorSets(indexOfDataForCurrentFrame);
+    }
+}
+
+// The only per frame CPU work that scales with the scene, one matrix per model and one index per batch.
+void WriteDrawCullingFrameData(const std::vector<Model>& models) {
+
+    for (size_t i = 0; i < models.size(); i++)
+    {
+        DrawCulling::mappedModelTransforms[indexOfDataForCurrentFrame][i] = models[i].modelToWorld;
+    }
+
+    uint32_t firstDrawIndex = 0;
+    for (size_t i = 0; i < DrawCulling::batches.size(); i++)
+    {
+        DrawCulling::batches[i].firstDrawIndex = firstDrawIndex;
+        DrawCulling::mappedBatchFirstDrawIndices[indexOfDataForCurrentFrame][i] = firstDrawIndex;
+
+        firstDrawIndex += DrawCulling::batches[i].instanceCount;
+    }
+}
+
+// Copies up to MAX_DRAW_CULLING_INSTANCE_UPLOADS_PER_FRAME queued instances into the instance buffer, in the order they were queued.
+// An instance is first queued when it is registered, so the ones uploaded at least once are always [0, uploadedInstanceCount).
+void RecordDrawCullingInstanceUploads(VkCommandBuffer commandBuffer) {
+
+    if (DrawCulling::queuedInstanceUploads.empty()) {
+        return;
+    }
+
+    uint32_t uploadCount = std::min(static_cast<uint32_t>(DrawCulling::queuedInstanceUploads.size()), MAX_DRAW_CULLING_INSTANCE_UPLOADS_PER_FRAME);
+    std::vector<VkBufferCopy> copyRegions(uploadCount);
+
+    for (uint32_t i = 0; i < uploadCount; i++)
+    {
+        uint32_t instanceIndex = DrawCulling::queuedInstanceUploads.front();
+        DrawCulling::queuedInstanceUploads.pop_front();
+        DrawCulling::instanceUploadQueued[instanceIndex] = false;
+
+        DrawCulling::mappedInstanceUploads[indexOfDataForCurrentFrame][i] = DrawCulling::instances[instanceIndex];
+
+        copyRegions[i].srcOffset = sizeof(DrawCullingInstance) * static_cast<VkDeviceSize>(i);
+        copyRegions[i].dstOffset = sizeof(DrawCullingInstance) * static_cast<VkDeviceSize>(instanceIndex);
+        copyRegions[i].size = sizeof(DrawCullingInstance);
+
+        DrawCulling::uploadedInstanceCount = std::max(DrawCulling::uploadedInstanceCount, instanceIndex + 1);
+    }
+
+    // Earlier frames may still be culling with the instances, and a growth copy may have just written them.
+    VkMemoryBarrier uploadBarrier{};
+    uploadBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    uploadBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    uploadBarrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 1, &uploadBarrier, 0, nullptr, 0, nullptr);
+
+    vkCmdCopyBuffer(commandBuffer, DrawCulling::vk_InstanceUploadBuffers[indexOfDataForCurrentFrame], DrawCulling::vk_InstanceBuffer, uploadCount, copyRegions.data());
+}
+
+// Recorded outside the render pass, before the culling pass. Brings the instance buffer up to date with the scene's meshes and hands
+// this frame the model transforms and batch layout. The culling pass makes the uploads visible to the shader.
+void PrepareDrawCullingFrame(VkCommandBuffer commandBuffer, std::vector<Model>& models) {
+
+    RegisterUsableDrawCullingInstances(models);
+    RecordDrawCullingInstanceCapacityGrowth(commandBuffer);
+    EnsureDrawCullingFrameBuffers(static_cast<uint32_t>(models.size()));
+    WriteDrawCullingFrameData(models);
+    RecordDrawCullingInstanceUploads(commandBuffer);
+}
+
+// Offset of the late occlusion phase's draws and counts in this frame's culled buffers.
+uint32_t GetDrawCullingLateDrawOffset() {
+    return DrawCulling::frameInstanceCapacities[indexOfDataForCurrentFrame];
+}
+
+// Recorded outside the render pass. Clears the counts of every batch, culls the uploaded instances into them and makes the results
+// visible to the indirect draws and the vertex shader.
+void RecordDrawCullingPass(VkCommandBuffer commandBuffer, const Frustum& frustum) {
+
+    uint32_t batchedInstanceCount = static_cast<uint32_t>(DrawCulling::instances.size());
+    if (batchedInstanceCount == 0) {
+        return;
+    }
+
+    VkBuffer drawCountBuffer = DrawCulling::vk_DrawCountBuffers[indexOfDataForCurrentFrame];
+    vkCmdFillBuffer(commandBuffer, drawCountBuffer, 0, batchedInstanceCount * sizeof(uint32_t), 0);
+
+    // Batches of instances that are not uploaded yet are still drawn, with the cleared count.
+    VkMemoryBarrier clearBarrier{};
+    clearBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    clearBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    clearBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_INDIRECT_COMMAND_READ_BIT;
+
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT, 0, 1, &clearBarrier, 0, nullptr, 0, nullptr);
+
+    if (DrawCulling::uploadedInstanceCount == 0) {
+        return;
+    }
+
+    DrawCullingPushConstantData pushConstantData = {};
+    std::copy(std::begin(frustum.planes), std::end(frustum.planes), pushConstantData.frustumPlanes);
+    pushConstantData.instanceCount = DrawCulling::uploadedInstanceCount;
+
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, DrawCulling::vk_CullPipeline);
+
+    VkDescriptorSet cullDescriptorSet = vk_DescriptorSetsForEachFlightFrame[DrawCulling::cullDescriptorSetIndex][indexOfDataForCurrentFrame];
+    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, DrawCulling::vk_CullPipelineLayout, 0, 1, &cullDescriptorSet, 0, nullptr);
+    vkCmdPushConstants(commandBuffer, DrawCulling::vk_CullPipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(DrawCullingPushConstantData), &pushConstantData);
+
+    vkCmdDispatch(commandBuffer, (pushConstantData.instanceCount + DRAW_CULLING_WORKGROUP_SIZE - 1) / DRAW_CULLING_WORKGROUP_SIZE, 1, 1);
+
+    VkMemoryBarrier cullBarrier{};
+    cullBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    cullBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+    cullBarrier.dstAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_SHADER_READ_BIT;
+
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT, 0, 1, &cullBarrier, 0, nullptr, 0, nullptr);
+}
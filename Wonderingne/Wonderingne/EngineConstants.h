@@ -1,11 +1,22 @@
 #pragma once
 
-const int MAX_FRAMES_IN_FLIGHT = 2;
+// Frames, uploads and ownership acquires are tracked on a timeline semaphore (GpuTimeline.h) instead of fences when the device
+// supports Vulkan 1.2 timeline semaphores.
+const bool USE_TIMELINE_SEMAPHORES = true;
+
+// Records the frame with VK_KHR_dynamic_rendering straight on the swap chain image views, so no render passes or framebuffers exist and
+// a resize only recreates the images. Devices without it keep the render pass path.
+const bool USE_DYNAMIC_RENDERING = true;
+
+// Upper bound of PresentationPolicy::framesInFlight, every per frame resource is created this many times.
+const int MAX_FRAMES_IN_FLIGHT = 4;
 
 const int CAMERA_UBO_BINDING_LOCATION = 0;
 const int MODEL_UBO_BINDING_LOCATION = 1;
 const int SAMPLER_UBO_BINDING_LOCATION_IN_FRAG_SHADER = 2;
 const int UI_INSTANCE_MODEL_SSBO_BINDING_LOCATION = 3;
+const int DRAW_DATA_SSBO_BINDING_LOCATION = 0;
+const int BINDLESS_TEXTURES_BINDING_LOCATION = 0;
 
 
 const uint32_t WIDTH = 800;
@@ -13,3 +24,88 @@ const uint32_t HEIGHT = 600;
 
 const std::string WINDOW_TITLE = "Vulkan Window";
 const std::string ENGINE_NAME = "Wonderingne";
+
+// Bump whenever the import pipeline or the cache layout changes so stale caches get rebuilt.
+const bool USE_MESH_CACHE = true;
+const uint32_t MESH_CACHE_VERSION = 4;
+const std::string MESH_CACHE_FILE_EXTENSION = ".meshcache";
+
+// Models whose meshes add up to fewer vertices than this are processed on a single thread.
+const uint64_t PARALLEL_MESH_PROCESSING_MIN_VERTICES = 65536;
+
+// Welding, vertex cache, overdraw and vertex fetch passes run on every imported mesh, see MeshOptimizationUtils.h.
+const bool OPTIMIZE_IMPORTED_MESHES = true;
+const bool OPTIMIZE_IMPORTED_MESHES_FOR_OVERDRAW = true;
+
+// How much worse the ACMR may get for the overdraw pass to split a cluster, 1.05 allows 5%.
+const float OVERDRAW_OPTIMIZATION_ACMR_THRESHOLD = 1.05f;
+
+// FIFO size used for the ACMR statistics and the overdraw clustering.
+const uint32_t ACMR_SIMULATION_CACHE_SIZE = 16;
+
+// Meshes with fewer vertices than this are drawn with 16 bit indices, bigger ones get split up to fit when enabled.
+const uint32_t MAX_VERTICES_FOR_16_BIT_INDICES = 65536;
+const bool SPLIT_MESHES_FOR_16_BIT_INDICES = true;
+
+// Size of the shared geometry buffers every mesh is sub-allocated from, see GeometryArena.h.
+const uint64_t GEOMETRY_ARENA_VERTEX_CAPACITY = 4 * 1024 * 1024;
+const uint64_t GEOMETRY_ARENA_INDEX_BUFFER_SIZE = 64 * 1024 * 1024;
+
+// Per frame in flight, holds one aligned ModelUniformBufferObject per draw (16384 draws at a 256 byte alignment).
+const uint64_t MODEL_UNIFORM_RING_SIZE = 4 * 1024 * 1024;
+
+// View depth mapped onto the depth bits of the draw sort keys, should match the far plane.
+const float RENDER_QUEUE_MAX_SORT_DEPTH = 1000.0f;
+
+// The scene pass is drawn with one vkCmdDrawIndexedIndirect per material batch, see IndirectDraw.h. Needs the shaders
+// from Assets/Shaders/IndirectDraw.vert and .frag compiled next to the others.
+// The per frame command and draw data buffers start out this large and grow when a frame writes more draws.
+const bool USE_INDIRECT_DRAWS = true;
+const uint32_t INITIAL_INDIRECT_DRAWS_PER_FRAME = 16384;
+const std::string INDIRECT_DRAW_VERTEX_SHADER_FILE_PATH = "Assets/Shaders/CompiledShaders/indirect_vert.spv";
+const std::string INDIRECT_DRAW_FRAGMENT_SHADER_FILE_PATH = "Assets/Shaders/CompiledShaders/indirect_frag.spv";
+
+// The indirect scene pass samples every texture from one descriptor indexed array, see BindlessTextures.h. Raises the instance to
+// Vulkan 1.2 and needs Assets/Shaders/IndirectDrawBindless.frag compiled, the per material sets are used otherwise.
+const bool USE_BINDLESS_TEXTURES = true;
+const uint32_t MAX_BINDLESS_TEXTURES = 4096;
+const std::string INDIRECT_DRAW_BINDLESS_FRAGMENT_SHADER_FILE_PATH = "Assets/Shaders/CompiledShaders/indirect_bindless_frag.spv";
+
+// Scene draws are rendered depth only first, then shaded with an EQUAL depth test and no depth writes so every pixel is shaded once.
+// Only used with indirect draws and needs Assets/Shaders/IndirectDrawDepth.vert compiled, toggled at runtime with F2.
+const bool USE_DEPTH_PREPASS = true;
+const std::string DEPTH_PREPASS_VERTEX_SHADER_FILE_PATH = "Assets/Shaders/CompiledShaders/indirect_depth_vert.spv";
+
+// Scene meshes outside the camera frustum are skipped. On the GPU when USE_GPU_DRAW_CULLING is set and the device supports it
+// (see DrawCulling.h), otherwise with the SIMD sphere tests of FrustumCullingUtils.h while building the render queue.
+const bool USE_FRUSTUM_CULLING = true;
+const bool USE_GPU_DRAW_CULLING = true;
+const uint32_t DRAW_CULLING_WORKGROUP_SIZE = 64;
+
+// The GPU culled scene lives in a persistent instance buffer, sized for this many meshes up front and grown when more are loaded.
+// Changed instances are copied into it at most MAX_DRAW_CULLING_INSTANCE_UPLOADS_PER_FRAME at a time, the rest follow next frame.
+const uint32_t INITIAL_DRAW_CULLING_INSTANCE_CAPACITY = 131072;
+const uint32_t MAX_DRAW_CULLING_INSTANCE_UPLOADS_PER_FRAME = 16384;
+const uint32_t INITIAL_DRAW_CULLING_MODEL_CAPACITY = 256;
+const uint32_t INITIAL_DRAW_CULLING_BATCH_CAPACITY = 256;
+const std::string DRAW_CULLING_COMPUTE_SHADER_FILE_PATH = "Assets/Shaders/CompiledShaders/draw_culling_comp.spv";
+
+// Two phase Hi-Z occlusion culling on top of the GPU draw culling, see OcclusionCulling.h. Meshes visible last frame are drawn first,
+// a depth pyramid is built from that depth and everything else is tested against it and drawn in a second render pass.
+const bool USE_OCCLUSION_CULLING = true;
+const uint32_t HI_Z_WORKGROUP_SIZE = 8;
+const std::string HI_Z_BUILD_COMPUTE_SHADER_FILE_PATH = "Assets/Shaders/CompiledShaders/hi_z_build_comp.spv";
+const std::string OCCLUSION_CULLING_COMPUTE_SHADER_FILE_PATH = "Assets/Shaders/CompiledShaders/occlusion_culling_comp.spv";
+
+// Draws are recorded into secondary command buffers on the job system, each render queue is split into at most this many jobs and
+// a job gets at least MIN_ITEMS_PER_COMMAND_RECORDING_JOB draws (or indirect batches) when there are enough of them.
+const uint32_t MAX_COMMAND_RECORDING_JOBS_PER_RENDER_QUEUE = 8;
+const uint32_t MIN_ITEMS_PER_COMMAND_RECORDING_JOB = 64;
+
+// Compiled pipelines are kept in a VkPipelineCache that is saved here after new pipelines are built and on shutdown, see PipelineCache.h.
+const bool USE_PIPELINE_CACHE = true;
+const std::string PIPELINE_CACHE_FILE_PATH = "Assets/Shaders/CompiledShaders/pipeline_cache.bin";
+
+// Textures are loaded from a block compressed "<texture>.ktx2" next to the source image when there is one, see Ktx2Utils.h.
+// Run the engine with --convert-textures <directory> to write them.
+const bool PREFER_KTX2_TEXTURES = true;
@@ -0,0 +1,106 @@
+#pragma once
+
+#include "StandardIncludes.h"
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// Read only view of a whole file. Data stays valid until UnmapFile is called.
+struct MappedFile {
+
+    const uint8_t* data = nullptr;
+    uint64_t size = 0;
+
+#ifdef _WIN32
+    HANDLE fileHandle = INVALID_HANDLE_VALUE;
+    HANDLE mappingHandle = nullptr;
+#else
+    int fileDescriptor = -1;
+#endif
+};
+
+void UnmapFile(MappedFile& mappedFile) {
+
+#ifdef _WIN32
+    if (mappedFile.data != nullptr) {
+        UnmapViewOfFile(mappedFile.data);
+    }
+    if (mappedFile.mappingHandle != nullptr) {
+        CloseHandle(mappedFile.mappingHandle);
+    }
+    if (mappedFile.fileHandle != INVALID_HANDLE_VALUE) {
+        CloseHandle(mappedFile.fileHandle);
+    }
+#else
+    if (mappedFile.data != nullptr) {
+        munmap(const_cast<uint8_t*>(mappedFile.data), static_cast<size_t>(mappedFile.size));
+    }
+    if (mappedFile.fileDescriptor >= 0) {
+        close(mappedFile.fileDescriptor);
+    }
+#endif
+
+    mappedFile = MappedFile();
+}
+
+// Returns false (and leaves mappedFile empty) if the file does not exist or cannot be mapped.
+bool MapFileForReading(const std::string& filePath, MappedFile& mappedFile) {
+
+    mappedFile = MappedFile();
+
+#ifdef _WIN32
+    mappedFile.fileHandle = CreateFileA(filePath.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (mappedFile.fileHandle == INVALID_HANDLE_VALUE) {
+        return false;
+    }
+
+    LARGE_INTEGER fileSize{};
+    if (!GetFileSizeEx(mappedFile.fileHandle, &fileSize) || fileSize.QuadPart == 0) {
+        UnmapFile(mappedFile);
+        return false;
+    }
+    mappedFile.size = static_cast<uint64_t>(fileSize.QuadPart);
+
+    mappedFile.mappingHandle = CreateFileMappingA(mappedFile.fileHandle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (mappedFile.mappingHandle == nullptr) {
+        UnmapFile(mappedFile);
+        return false;
+    }
+
+    mappedFile.data = static_cast<const uint8_t*>(MapViewOfFile(mappedFile.mappingHandle, FILE_MAP_READ, 0, 0, 0));
+#else
+    mappedFile.fileDescriptor = open(filePath.c_str(), O_RDONLY);
+    if (mappedFile.fileDescriptor < 0) {
+        return false;
+    }
+
+    struct stat fileStats {};
+    if (fstat(mappedFile.fileDescriptor, &fileStats) != 0 || fileStats.st_size == 0) {
+        UnmapFile(mappedFile);
+        return false;
+    }
+    mappedFile.size = static_cast<uint64_t>(fileStats.st_size);
+
+    void* mappedAddress = mmap(nullptr, static_cast<size_t>(mappedFile.size), PROT_READ, MAP_PRIVATE, mappedFile.fileDescriptor, 0);
+    mappedFile.data = mappedAddress == MAP_FAILED ? nullptr : static_cast<const uint8_t*>(mappedAddress);
+#endif
+
+    if (mappedFile.data == nullptr) {
+        UnmapFile(mappedFile);
+        return false;
+    }
+
+    return true;
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include "DependencyIncludes.h"
+#include "StandardIncludes.h"
+
+#include "Model.h"
+
+// Widest sphere test the build allows, 8 lanes with AVX, 4 with SSE and a plain loop everywhere else.
+#if defined(__AVX__)
+#include <immintrin.h>
+const uint32_t FRUSTUM_CULLING_SIMD_WIDTH = 8;
+#elif defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#include <xmmintrin.h>
+const uint32_t FRUSTUM_CULLING_SIMD_WIDTH = 4;
+#else
+const uint32_t FRUSTUM_CULLING_SIMD_WIDTH = 1;
+#endif
+
+// Planes are ax + by + cz + d >= 0 for points inside, normalized so d is a distance in world units.
+struct Frustum {
+    glm::vec4 planes[6];
+};
+
+// World bounding spheres of the candidate meshes in structure of arrays form, so one SIMD load covers a whole batch of spheres.
+// Kept per render queue and only ever grown.
+struct FrustumCullingList {
+
+    std::vector<const Mesh*> candidateMeshes = {};
+
+    std::vector<float> sphereCenterX = {};
+    std::vector<float> sphereCenterY = {};
+    std::vector<float> sphereCenterZ = {};
+    std::vector<float> sphereRadius = {};
+
+    std::vector<const Mesh*> visibleMeshes = {};
+};
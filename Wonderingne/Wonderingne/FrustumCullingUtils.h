@@ -0,0 +1,136 @@
+#pragma once
+
+#include "FrustumCulling.h"
+
+#include "VulkanCreateUtils.h"
+
+#include <bit>
+
+// Gribb and Hartmann plane extraction, for a projection with a [0, 1] depth range. Normalized so the plane distance is in world units.
+void ExtractFrustumPlanes(const glm::mat4& viewProjection, glm::vec4 (&frustumPlanes)[6]) {
+
+    glm::vec4 row0 = glm::vec4(viewProjection[0][0], viewProjection[1][0], viewProjection[2][0], viewProjection[3][0]);
+    glm::vec4 row1 = glm::vec4(viewProjection[0][1], viewProjection[1][1], viewProjection[2][1], viewProjection[3][1]);
+    glm::vec4 row2 = glm::vec4(viewProjection[0][2], viewProjection[1][2], viewProjection[2][2], viewProjection[3][2]);
+    glm::vec4 row3 = glm::vec4(viewProjection[0][3], viewProjection[1][3], viewProjection[2][3], viewProjection[3][3]);
+
+    frustumPlanes[0] = row3 + row0;
+    frustumPlanes[1] = row3 - row0;
+    frustumPlanes[2] = row3 + row1;
+    frustumPlanes[3] = row3 - row1;
+    frustumPlanes[4] = row2;
+    frustumPlanes[5] = row3 - row2;
+
+    for (glm::vec4& plane : frustumPlanes) {
+        plane /= glm::length(glm::vec3(plane));
+    }
+}
+
+Frustum GetCameraFrustum(const CameraUniformBufferObject& camera_ubo) {
+
+    Frustum frustum;
+    ExtractFrustumPlanes(camera_ubo.proj * camera_ubo.view, frustum.planes);
+
+    return frustum;
+}
+
+bool IsSphereInFrustum(const Frustum& frustum, float centerX, float centerY, float centerZ, float radius) {
+
+    for (const glm::vec4& plane : frustum.planes) {
+        if (plane.x * centerX + plane.y * centerY + plane.z * centerZ + plane.w < -radius) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+// Bit i of the result is set when sphere first + i is inside or touching every plane.
+uint32_t CullSphereBatch(const Frustum& frustum, const FrustumCullingList& cullingList, size_t first) {
+
+#if defined(__AVX__)
+    __m256 centerX = _mm256_loadu_ps(&cullingList.sphereCenterX[first]);
+    __m256 centerY = _mm256_loadu_ps(&cullingList.sphereCenterY[first]);
+    __m256 centerZ = _mm256_loadu_ps(&cullingList.sphereCenterZ[first]);
+    __m256 negativeRadius = _mm256_sub_ps(_mm256_setzero_ps(), _mm256_loadu_ps(&cullingList.sphereRadius[first]));
+
+    __m256 insideMask = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+    for (const glm::vec4& plane : frustum.planes) {
+        __m256 distance = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(centerX, _mm256_set1_ps(plane.x)), _mm256_mul_ps(centerY, _mm256_set1_ps(plane.y))), _mm256_add_ps(_mm256_mul_ps(centerZ, _mm256_set1_ps(plane.z)), _mm256_set1_ps(plane.w)));
+        insideMask = _mm256_and_ps(insideMask, _mm256_cmp_ps(distance, negativeRadius, _CMP_GE_OQ));
+    }
+
+    return static_cast<uint32_t>(_mm256_movemask_ps(insideMask));
+#elif defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+    __m128 centerX = _mm_loadu_ps(&cullingList.sphereCenterX[first]);
+    __m128 centerY = _mm_loadu_ps(&cullingList.sphereCenterY[first]);
+    __m128 centerZ = _mm_loadu_ps(&cullingList.sphereCenterZ[first]);
+    __m128 negativeRadius = _mm_sub_ps(_mm_setzero_ps(), _mm_loadu_ps(&cullingList.sphereRadius[first]));
+
+    __m128 insideMask = _mm_cmpeq_ps(_mm_setzero_ps(), _mm_setzero_ps());
+    for (const glm::vec4& plane : frustum.planes) {
+        __m128 distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(centerX, _mm_set1_ps(plane.x)), _mm_mul_ps(centerY, _mm_set1_ps(plane.y))), _mm_add_ps(_mm_mul_ps(centerZ, _mm_set1_ps(plane.z)), _mm_set1_ps(plane.w)));
+        insideMask = _mm_and_ps(insideMask, _mm_cmpge_ps(distance, negativeRadius));
+    }
+
+    return static_cast<uint32_t>(_mm_movemask_ps(insideMask));
+#else
+    return IsSphereInFrustum(frustum, cullingList.sphereCenterX[first], cullingList.sphereCenterY[first], cullingList.sphereCenterZ[first], cullingList.sphereRadius[first]) ? 1u : 0u;
+#endif
+}
+
+// Candidates are the meshes whose uploads have finished, in model order.
+void GatherFrustumCullingCandidates(FrustumCullingList& cullingList, const std::vector<Model>& models) {
+
+    cullingList.candidateMeshes.clear();
+
+    for (const Model& model : models) {
+        for (const Mesh& curMesh : model.meshes) {
+            if (IsUploadBatchUsable(curMesh.uploadBatchID)) {
+                cullingList.candidateMeshes.push_back(&curMesh);
+            }
+        }
+    }
+}
+
+// Fills visibleMeshes with the candidates whose world bounding sphere touches the frustum, keeping their order.
+void CullFrustumCullingList(FrustumCullingList& cullingList, const Frustum& frustum) {
+
+    size_t candidateCount = cullingList.candidateMeshes.size();
+
+    cullingList.sphereCenterX.resize(candidateCount);
+    cullingList.sphereCenterY.resize(candidateCount);
+    cullingList.sphereCenterZ.resize(candidateCount);
+    cullingList.sphereRadius.resize(candidateCount);
+
+    for (size_t i = 0; i < candidateCount; i++)
+    {
+        const Mesh& curMesh = *cullingList.candidateMeshes[i];
+        cullingList.sphereCenterX[i] = curMesh.worldBoundsCenter.x;
+        cullingList.sphereCenterY[i] = curMesh.worldBoundsCenter.y;
+        cullingList.sphereCenterZ[i] = curMesh.worldBoundsCenter.z;
+        cullingList.sphereRadius[i] = curMesh.worldBoundsRadius;
+    }
+
+    cullingList.visibleMeshes.clear();
+
+    size_t fullBatchEnd = candidateCount - candidateCount % FRUSTUM_CULLING_SIMD_WIDTH;
+
+    for (size_t first = 0; first < fullBatchEnd; first += FRUSTUM_CULLING_SIMD_WIDTH)
+    {
+        uint32_t insideBits = CullSphereBatch(frustum, cullingList, first);
+        while (insideBits != 0) {
+            uint32_t lane = static_cast<uint32_t>(std::countr_zero(insideBits));
+            cullingList.visibleMeshes.push_back(cullingList.candidateMeshes[first + lane]);
+            insideBits &= insideBits - 1;
+        }
+    }
+
+    // The last partial batch would read past the arrays, it goes through the scalar test instead.
+    for (size_t i = fullBatchEnd; i < candidateCount; i++)
+    {
+        if (IsSphereInFrustum(frustum, cullingList.sphereCenterX[i], cullingList.sphereCenterY[i], cullingList.sphereCenterZ[i], cullingList.sphereRadius[i])) {
+            cullingList.visibleMeshes.push_back(cullingList.candidateMeshes[i]);
+        }
+    }
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include "DependencyIncludes.h"
+#include "StandardIncludes.h"
+
+#include "EngineConstants.h"
+
+// One device local vertex buffer and one index buffer shared by every mesh, sub-allocated through VMA virtual blocks (TLSF).
+// Meshes only keep their ranges, so a whole pass binds the geometry once and draws with firstIndex and vertexOffset.
+//
+// The vertex block counts whole vertices, so a range offset is directly the vertexOffset of the draw. With a split position
+// stream the attribute stream lives in its own region after all the positions, indexed by the same vertexOffset.
+struct GeometryArena {
+
+public:
+
+	inline static VkBuffer vk_VertexBuffer = VK_NULL_HANDLE;
+	inline static VmaAllocation vma_VertexBufferAllocation = VK_NULL_HANDLE;
+	inline static VmaVirtualBlock vma_VertexBlock = VK_NULL_HANDLE;
+	inline static VkDeviceSize attributeRegionOffset = 0;
+
+	// Counted in bytes, ranges are aligned to 4 so firstIndex works out for both index types.
+	inline static VkBuffer vk_IndexBuffer = VK_NULL_HANDLE;
+	inline static VmaAllocation vma_IndexBufferAllocation = VK_NULL_HANDLE;
+	inline static VmaVirtualBlock vma_IndexBlock = VK_NULL_HANDLE;
+
+};
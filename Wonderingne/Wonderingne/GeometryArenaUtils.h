@@ -0,0 +1,98 @@
+#pragma once
+
+#include "GeometryArena.h"
+#include "Model.h"
+#include "VertexFormats.h"
+
+#include "VulkanCreateUtils.h"
+
+const VkDeviceSize GEOMETRY_ARENA_INDEX_ALIGNMENT = 4;
+
+void CreateGeometryArena() {
+
+    VkDeviceSize vertexBufferSize = GEOMETRY_ARENA_VERTEX_CAPACITY * GPUVertexFormat::bytesPerVertex;
+    GeometryArena::attributeRegionOffset = GPUVertexFormat::splitPositionStream ? GEOMETRY_ARENA_VERTEX_CAPACITY * GPUVertexFormat::positionStride : 0;
+
+    CreateSharedBuffer_VMA(vertexBufferSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, GeometryArena::vk_VertexBuffer, GeometryArena::vma_VertexBufferAllocation);
+    vmaSetAllocationName(vma_Allocator, GeometryArena::vma_VertexBufferAllocation, "Geometry Arena Vertex Buffer");
+
+    CreateSharedBuffer_VMA(GEOMETRY_ARENA_INDEX_BUFFER_SIZE, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, GeometryArena::vk_IndexBuffer, GeometryArena::vma_IndexBufferAllocation);
+    vmaSetAllocationName(vma_Allocator, GeometryArena::vma_IndexBufferAllocation, "Geometry Arena Index Buffer");
+
+    VmaVirtualBlockCreateInfo vertexBlockInfo = {};
+    vertexBlockInfo.size = GEOMETRY_ARENA_VERTEX_CAPACITY;
+
+    if (vmaCreateVirtualBlock(&vertexBlockInfo, &GeometryArena::vma_VertexBlock) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create geometry arena vertex block!");
+    }
+
+    VmaVirtualBlockCreateInfo indexBlockInfo = {};
+    indexBlockInfo.size = GEOMETRY_ARENA_INDEX_BUFFER_SIZE;
+
+    if (vmaCreateVirtualBlock(&indexBlockInfo, &GeometryArena::vma_IndexBlock) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create geometry arena index block!");
+    }
+}
+
+// Every range has to be freed with FreeGeometryArenaRanges first.
+void DestroyGeometryArena() {
+
+    vmaDestroyVirtualBlock(GeometryArena::vma_VertexBlock);
+    vmaDestroyVirtualBlock(GeometryArena::vma_IndexBlock);
+
+    vmaDestroyBuffer(vma_Allocator, GeometryArena::vk_VertexBuffer, GeometryArena::vma_VertexBufferAllocation);
+    vmaDestroyBuffer(vma_Allocator, GeometryArena::vk_IndexBuffer, GeometryArena::vma_IndexBufferAllocation);
+}
+
+// Virtual blocks are not thread safe, ranges are only handed out while uploading on the main thread.
+void AllocateGeometryArenaRanges(Mesh& currentMesh, const std::string& meshName) {
+
+    VmaVirtualAllocationCreateInfo vertexRangeInfo = {};
+    vertexRangeInfo.size = currentMesh.vertices.size();
+
+    VkDeviceSize vertexOffset = 0;
+    if (vmaVirtualAllocate(GeometryArena::vma_VertexBlock, &vertexRangeInfo, &currentMesh.vma_VertexRange, &vertexOffset) != VK_SUCCESS) {
+        throw std::runtime_error("geometry arena is out of vertex space, raise GEOMETRY_ARENA_VERTEX_CAPACITY! mesh := " + meshName);
+    }
+
+    VkDeviceSize indexSize = currentMesh.vk_IndexType == VK_INDEX_TYPE_UINT16 ? sizeof(uint16_t) : sizeof(uint32_t);
+
+    VmaVirtualAllocationCreateInfo indexRangeInfo = {};
+    indexRangeInfo.size = indexSize * currentMesh.indices.size();
+    indexRangeInfo.alignment = GEOMETRY_ARENA_INDEX_ALIGNMENT;
+
+    VkDeviceSize indexByteOffset = 0;
+    if (vmaVirtualAllocate(GeometryArena::vma_IndexBlock, &indexRangeInfo, &currentMesh.vma_IndexRange, &indexByteOffset) != VK_SUCCESS) {
+        throw std::runtime_error("geometry arena is out of index space, raise GEOMETRY_ARENA_INDEX_BUFFER_SIZE! mesh := " + meshName);
+    }
+
+    currentMesh.vertexOffset = static_cast<int32_t>(vertexOffset);
+    currentMesh.firstIndex = static_cast<uint32_t>(indexByteOffset / indexSize);
+}
+
+// Only call once the GPU is done with the mesh, the ranges are handed out again straight away.
+void FreeGeometryArenaRanges(Mesh& currentMesh) {
+
+    if (currentMesh.vma_VertexRange != VK_NULL_HANDLE) {
+        vmaVirtualFree(GeometryArena::vma_VertexBlock, currentMesh.vma_VertexRange);
+        currentMesh.vma_VertexRange = VK_NULL_HANDLE;
+    }
+
+    if (currentMesh.vma_IndexRange != VK_NULL_HANDLE) {
+        vmaVirtualFree(GeometryArena::vma_IndexBlock, currentMesh.vma_IndexRange);
+        currentMesh.vma_IndexRange = VK_NULL_HANDLE;
+    }
+}
+
+VkDeviceSize GetGeometryArenaIndexByteOffset(const Mesh& currentMesh) {
+    return static_cast<VkDeviceSize>(currentMesh.firstIndex) * (currentMesh.vk_IndexType == VK_INDEX_TYPE_UINT16 ? sizeof(uint16_t) : sizeof(uint32_t));
+}
+
+// Binds the shared vertex streams once for everything drawn after it.
+void BindGeometryArenaVertexBuffers(VkCommandBuffer commandBuffer) {
+
+    VkBuffer vertexBuffers[] = { GeometryArena::vk_VertexBuffer, GeometryArena::vk_VertexBuffer };
+    VkDeviceSize offsets[] = { 0, GeometryArena::attributeRegionOffset };
+
+    vkCmdBindVertexBuffers(commandBuffer, 0, GPUVertexFormat::bindingCount, vertexBuffers, offsets);
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+#include "DependencyIncludes.h"
+#include "StandardIncludes.h"
+
+#include "EngineConstants.h"
+
+// A timeline semaphore and the last value a submission was told to signal on it. Values only grow, a point in time on the GPU is
+// (semaphore, value) and is reached once the counter is at least that value.
+struct TimelineSemaphore {
+
+    VkSemaphore vk_Semaphore = VK_NULL_HANDLE;
+    uint64_t lastSubmittedValue = 0;
+};
+
+// The GPU timeline every subsystem waits on or polls instead of allocating fences. Frames, ownership acquires and anything else on
+// the graphics queue signal the graphics timeline in submission order. A dedicated transfer queue gets its own timeline, signals of
+// two queues can not be ordered on one, and uploads are tracked on the graphics timeline otherwise.
+struct GpuTimeline {
+
+public:
+
+	inline static TimelineSemaphore graphics = {};
+	inline static TimelineSemaphore transfer = {};
+
+	// Value the last submission of each frame in flight signals on the graphics timeline, the frame's resources are free once it is reached.
+	inline static std::array<uint64_t, MAX_FRAMES_IN_FLIGHT> frameTimelineValues = {};
+
+};
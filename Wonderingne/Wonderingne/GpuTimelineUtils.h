@@ -0,0 +1,92 @@
+#pragma once
+
+#include "GpuTimeline.h"
+
+#include "VulkanInitUtils.h"
+
+// Only true on devices with timeline semaphores, frames and uploads are tracked with fences otherwise.
+bool IsGpuTimelineActive() {
+    return GpuTimeline::graphics.vk_Semaphore != VK_NULL_HANDLE;
+}
+
+VkSemaphore CreateTimelineSemaphore() {
+
+    VkSemaphoreTypeCreateInfo semaphoreTypeInfo{};
+    semaphoreTypeInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+    semaphoreTypeInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+    semaphoreTypeInfo.initialValue = 0;
+
+    VkSemaphoreCreateInfo semaphoreInfo{};
+    semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+    semaphoreInfo.pNext = &semaphoreTypeInfo;
+
+    VkSemaphore semaphore;
+    if (vkCreateSemaphore(vk_LogicalDevice, &semaphoreInfo, nullptr, &semaphore) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create timeline semaphore!");
+    }
+
+    return semaphore;
+}
+
+void CreateGpuTimeline() {
+
+    if (!timelineSemaphoresEnabled) {
+        return;
+    }
+
+    GpuTimeline::graphics.vk_Semaphore = CreateTimelineSemaphore();
+
+    if (transferQueueFamilyIndex != graphicsQueueFamilyIndex) {
+        GpuTimeline::transfer.vk_Semaphore = CreateTimelineSemaphore();
+    }
+}
+
+void DestroyGpuTimeline() {
+
+    if (!IsGpuTimelineActive()) {
+        return;
+    }
+
+    vkDestroySemaphore(vk_LogicalDevice, GpuTimeline::graphics.vk_Semaphore, nullptr);
+    vkDestroySemaphore(vk_LogicalDevice, GpuTimeline::transfer.vk_Semaphore, nullptr);
+
+    GpuTimeline::graphics = {};
+    GpuTimeline::transfer = {};
+}
+
+// Submissions on the transfer queue signal this one.
+TimelineSemaphore& GetTransferQueueTimeline() {
+    return GpuTimeline::transfer.vk_Semaphore != VK_NULL_HANDLE ? GpuTimeline::transfer : GpuTimeline::graphics;
+}
+
+// Hands out the value the next submission on the timeline's queue signals. Must be called in the order the submissions are made.
+uint64_t AdvanceTimeline(TimelineSemaphore& timeline) {
+    return ++timeline.lastSubmittedValue;
+}
+
+uint64_t GetCompletedTimelineValue(const TimelineSemaphore& timeline) {
+
+    uint64_t completedValue = 0;
+    if (vkGetSemaphoreCounterValue(vk_LogicalDevice, timeline.vk_Semaphore, &completedValue) != VK_SUCCESS) {
+        throw std::runtime_error("failed to read timeline semaphore value!");
+    }
+
+    return completedValue;
+}
+
+bool IsTimelineValueReached(const TimelineSemaphore& timeline, uint64_t value) {
+    return GetCompletedTimelineValue(timeline) >= value;
+}
+
+void WaitForTimelineValue(const TimelineSemaphore& timeline, uint64_t value) {
+
+    VkSemaphoreWaitInfo waitInfo{};
+    waitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+    waitInfo.semaphoreCount = 1;
+    waitInfo.pSemaphores = &timeline.vk_Semaphore;
+    waitInfo.pValues = &value;
+
+    if (vkWaitSemaphores(vk_LogicalDevice, &waitInfo, UINT64_MAX) != VK_SUCCESS) {
+        throw std::runtime_error("failed to wait for timeline semaphore!");
+    }
+}
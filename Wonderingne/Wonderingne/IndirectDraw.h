@@ -0,0 +1,44 @@
+#pragma once
+
+#include "DependencyIncludes.h"
+#include "StandardIncludes.h"
+
+#include "EngineConstants.h"
+
+// Per draw data read by the indirect vertex shader through gl_DrawID, laid out as std430 (112 bytes, the struct is 16 byte aligned).
+// textureIndex is the element of the bindless texture array, unused when the material sets are bound instead. instanceIndex is the
+// mesh's slot in the draw culling instance buffer, only filled in for GPU culled draws.
+//
+// boundingSphere is the mesh's local sphere (radius in w) in the space model transforms, so normalized when the vertex format
+// quantizes positions. The culling shaders divide positionDequantizationScale out of model's axes to scale the radius to world space.
+struct DrawData {
+	alignas(16) glm::mat4 model;
+	glm::vec4 boundingSphere;
+	glm::vec4 positionDequantizationScale;
+	uint32_t textureIndex;
+	uint32_t instanceIndex;
+};
+
+// Rebuilt every frame from the sorted render queue when the draws are not culled on the GPU. Each frame in flight has its own
+// persistently mapped command and draw data buffers, draw i of the frame uses commands[i] and draws[i]. They start out with
+// INITIAL_INDIRECT_DRAWS_PER_FRAME draws and a frame that needs more grows its own buffers.
+struct IndirectDrawBuffers {
+
+public:
+
+	inline static std::array<VkBuffer, MAX_FRAMES_IN_FLIGHT> vk_CommandBuffers = {};
+	inline static std::array<VmaAllocation, MAX_FRAMES_IN_FLIGHT> vma_CommandBufferAllocations = {};
+	inline static std::array<VkDrawIndexedIndirectCommand*, MAX_FRAMES_IN_FLIGHT> mappedCommands = {};
+
+	inline static std::array<VkBuffer, MAX_FRAMES_IN_FLIGHT> vk_DrawDataBuffers = {};
+	inline static std::array<VmaAllocation, MAX_FRAMES_IN_FLIGHT> vma_DrawDataBufferAllocations = {};
+	inline static std::array<DrawData*, MAX_FRAMES_IN_FLIGHT> mappedDrawData = {};
+
+	inline static std::array<uint32_t, MAX_FRAMES_IN_FLIGHT> drawCapacities = {};
+
+	inline static VkDescriptorSetLayout vk_DrawDataDescriptorSetLayout;
+	inline static int drawDataDescriptorSetIndex = -1;
+
+	inline static uint32_t drawCount = 0;
+
+};
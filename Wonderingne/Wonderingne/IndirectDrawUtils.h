@@ -0,0 +1,160 @@
+#pragma once
+
+#include "IndirectDraw.h"
+
+#include "VulkanCreateUtils.h"
+
+void CreateDescriptorSetLayoutForDrawData() {
+
+    VkDescriptorSetLayoutBinding drawDataLayoutBinding{};
+    drawDataLayoutBinding.binding = DRAW_DATA_SSBO_BINDING_LOCATION;
+    drawDataLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    drawDataLayoutBinding.descriptorCount = 1;
+    drawDataLayoutBinding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+
+    std::array<VkDescriptorSetLayoutBinding, 1> bindings = { drawDataLayoutBinding };
+
+    VkDescriptorSetLayoutCreateInfo layoutInfo{};
+    layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    layoutInfo.bindingCount = static_cast<uint32_t>(bindings.size());
+    layoutInfo.pBindings = bindings.data();
+
+    if (vkCreateDescriptorSetLayout(vk_LogicalDevice, &layoutInfo, nullptr, &IndirectDrawBuffers::vk_DrawDataDescriptorSetLayout) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create draw data descriptor set layout!");
+    }
+}
+
+// Doubles until requiredCount fits, shared by every buffer that grows instead of running out.
+uint32_t GetGrownCapacity(uint32_t capacity, uint32_t requiredCount) {
+
+    uint64_t grownCapacity = std::max(capacity, 1u);
+    while (grownCapacity < requiredCount) {
+        grownCapacity *= 2;
+    }
+
+    return static_cast<uint32_t>(std::min<uint64_t>(grownCapacity, UINT32_MAX));
+}
+
+void CreateIndirectDrawBuffersForFrame_VMA(size_t frameIndex, uint32_t drawCapacity) {
+
+    VmaAllocationInfo allocationInfo;
+
+    CreateBuffer_VMA(sizeof(VkDrawIndexedIndirectCommand) * drawCapacity, VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT | VMA_ALLOCATION_CREATE_MAPPED_BIT, VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, IndirectDrawBuffers::vk_CommandBuffers[frameIndex], IndirectDrawBuffers::vma_CommandBufferAllocations[frameIndex]);
+    vmaSetAllocationName(vma_Allocator, IndirectDrawBuffers::vma_CommandBufferAllocations[frameIndex], "Indirect Draw Commands");
+
+    vmaGetAllocationInfo(vma_Allocator, IndirectDrawBuffers::vma_CommandBufferAllocations[frameIndex], &allocationInfo);
+    IndirectDrawBuffers::mappedCommands[frameIndex] = static_cast<VkDrawIndexedIndirectCommand*>(allocationInfo.pMappedData);
+
+    CreateBuffer_VMA(sizeof(DrawData) * drawCapacity, VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT | VMA_ALLOCATION_CREATE_MAPPED_BIT, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, IndirectDrawBuffers::vk_DrawDataBuffers[frameIndex], IndirectDrawBuffers::vma_DrawDataBufferAllocations[frameIndex]);
+    vmaSetAllocationName(vma_Allocator, IndirectDrawBuffers::vma_DrawDataBufferAllocations[frameIndex], "Indirect Draw Data");
+
+    vmaGetAllocationInfo(vma_Allocator, IndirectDrawBuffers::vma_DrawDataBufferAllocations[frameIndex], &allocationInfo);
+    IndirectDrawBuffers::mappedDrawData[frameIndex] = static_cast<DrawData*>(allocationInfo.pMappedData);
+
+    IndirectDrawBuffers::drawCapacities[frameIndex] = drawCapacity;
+}
+
+void DestroyIndirectDrawBuffersForFrame(size_t frameIndex) {
+    vmaDestroyBuffer(vma_Allocator, IndirectDrawBuffers::vk_CommandBuffers[frameIndex], IndirectDrawBuffers::vma_CommandBufferAllocations[frameIndex]);
+    vmaDestroyBuffer(vma_Allocator, IndirectDrawBuffers::vk_DrawDataBuffers[frameIndex], IndirectDrawBuffers::vma_DrawDataBufferAllocations[frameIndex]);
+}
+
+void CreateIndirectDrawBuffers_VMA() {
+
+    for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+        CreateIndirectDrawBuffersForFrame_VMA(i, INITIAL_INDIRECT_DRAWS_PER_FRAME);
+    }
+}
+
+void WriteDrawDataDescriptorSet(size_t frameIndex) {
+
+    VkDescriptorBufferInfo bufferInfo{};
+    bufferInfo.buffer = IndirectDrawBuffers::vk_DrawDataBuffers[frameIndex];
+    bufferInfo.offset = 0;
+    bufferInfo.range = VK_WHOLE_SIZE;
+
+    std::array<VkWriteDescriptorSet, 1> descriptorWrites{};
+
+    descriptorWrites[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    descriptorWrites[0].dstSet = vk_DescriptorSetsForEachFlightFrame[IndirectDrawBuffers::drawDataDescriptorSetIndex][frameIndex];
+    descriptorWrites[0].dstBinding = DRAW_DATA_SSBO_BINDING_LOCATION;
+    descriptorWrites[0].dstArrayElement = 0;
+    descriptorWrites[0].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    descriptorWrites[0].descriptorCount = 1;
+    descriptorWrites[0].pBufferInfo = &bufferInfo;
+
+    vkUpdateDescriptorSets(vk_LogicalDevice, static_cast<uint32_t>(descriptorWrites.size()), descriptorWrites.data(), 0, nullptr);
+}
+
+void CreateDescriptorSetsForDrawData() {
+
+    IndirectDrawBuffers::drawDataDescriptorSetIndex = static_cast<int>(vk_DescriptorSetsForEachFlightFrame.size());
+    vk_DescriptorSetsForEachFlightFrame.push_back(std::array<VkDescriptorSet, MAX_FRAMES_IN_FLIGHT>());
+
+    std::vector<VkDescriptorSetLayout> layouts(MAX_FRAMES_IN_FLIGHT, IndirectDrawBuffers::vk_DrawDataDescriptorSetLayout);
+    VkDescriptorSetAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    allocInfo.descriptorPool = vk_DescriptorPool;
+    allocInfo.descriptorSetCount = static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT);
+    allocInfo.pSetLayouts = layouts.data();
+
+    if (vkAllocateDescriptorSets(vk_LogicalDevice, &allocInfo, vk_DescriptorSetsForEachFlightFrame[IndirectDrawBuffers::drawDataDescriptorSetIndex].data()) != VK_SUCCESS) {
+        throw std::runtime_error("failed to allocate draw data descriptor sets!");
+    }
+
+    for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+        WriteDrawDataDescriptorSet(i);
+    }
+}
+
+void DestroyIndirectDrawBuffers() {
+
+    for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+        DestroyIndirectDrawBuffersForFrame(i);
+    }
+
+    vkDestroyDescriptorSetLayout(vk_LogicalDevice, IndirectDrawBuffers::vk_DrawDataDescriptorSetLayout, nullptr);
+}
+
+// Only once the frame's in flight fence has been waited on.
+void ResetIndirectDrawBuffers() {
+    IndirectDrawBuffers::drawCount = 0;
+}
+
+// Grows this frame's buffers to at least requiredDrawCount draws, keeping the draws already written. Only this frame's command buffers
+// use them and its fence has been waited on, so the old buffers go right away and only this frame's draw data set is rewritten.
+void EnsureIndirectDrawCapacity(uint32_t requiredDrawCount, uint32_t indexOfDataForCurrentFrame) {
+
+    uint32_t drawCapacity = IndirectDrawBuffers::drawCapacities[indexOfDataForCurrentFrame];
+    if (requiredDrawCount <= drawCapacity) {
+        return;
+    }
+
+    VkBuffer oldCommandBuffer = IndirectDrawBuffers::vk_CommandBuffers[indexOfDataForCurrentFrame];
+    VmaAllocation oldCommandBufferAllocation = IndirectDrawBuffers::vma_CommandBufferAllocations[indexOfDataForCurrentFrame];
+    VkDrawIndexedIndirectCommand* oldMappedCommands = IndirectDrawBuffers::mappedCommands[indexOfDataForCurrentFrame];
+    VkBuffer oldDrawDataBuffer = IndirectDrawBuffers::vk_DrawDataBuffers[indexOfDataForCurrentFrame];
+    VmaAllocation oldDrawDataBufferAllocation = IndirectDrawBuffers::vma_DrawDataBufferAllocations[indexOfDataForCurrentFrame];
+    DrawData* oldMappedDrawData = IndirectDrawBuffers::mappedDrawData[indexOfDataForCurrentFrame];
+
+    CreateIndirectDrawBuffersForFrame_VMA(indexOfDataForCurrentFrame, GetGrownCapacity(drawCapacity, requiredDrawCount));
+
+    std::copy(oldMappedCommands, oldMappedCommands + IndirectDrawBuffers::drawCount, IndirectDrawBuffers::mappedCommands[indexOfDataForCurrentFrame]);
+    std::copy(oldMappedDrawData, oldMappedDrawData + IndirectDrawBuffers::drawCount, IndirectDrawBuffers::mappedDrawData[indexOfDataForCurrentFrame]);
+
+    vmaDestroyBuffer(vma_Allocator, oldCommandBuffer, oldCommandBufferAllocation);
+    vmaDestroyBuffer(vma_Allocator, oldDrawDataBuffer, oldDrawDataBufferAllocation);
+
+    WriteDrawDataDescriptorSet(indexOfDataForCurrentFrame);
+}
+
+// Returns the index of the draw in this frame's command and draw data buffers. EnsureIndirectDrawCapacity has to have made room for it.
+uint32_t WriteIndirectDraw(const VkDrawIndexedIndirectCommand& command, const DrawData& drawData, uint32_t indexOfDataForCurrentFrame) {
+
+    uint32_t drawIndex = IndirectDrawBuffers::drawCount++;
+
+    IndirectDrawBuffers::mappedCommands[indexOfDataForCurrentFrame][drawIndex] = command;
+    IndirectDrawBuffers::mappedDrawData[indexOfDataForCurrentFrame][drawIndex] = drawData;
+
+    return drawIndex;
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include "StandardIncludes.h"
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <deque>
+#include <atomic>
+#include <memory>
+
+struct JobSystem {
+
+public:
+
+	inline static std::vector<std::thread> workerThreads = {};
+
+	inline static std::deque<std::function<void()>> pendingJobs = {};
+	inline static std::mutex pendingJobsMutex;
+	inline static std::condition_variable pendingJobsAvailable;
+
+	inline static bool shuttingDown = false;
+};
+
+// Shared between the thread calling ParallelFor and the helper jobs it hands out.
+struct ParallelForState {
+
+	std::atomic<uint32_t> nextIndex = 0;
+	std::atomic<uint32_t> completedCount = 0;
+	uint32_t count = 0;
+
+	std::mutex completionMutex;
+	std::condition_variable allCompleted;
+
+	std::mutex exceptionMutex;
+	std::exception_ptr firstException = nullptr;
+};
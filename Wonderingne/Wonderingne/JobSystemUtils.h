@@ -0,0 +1,135 @@
+#pragma once
+
+#include "JobSystem.h"
+
+void WorkerThreadLoop() {
+
+    while (true) {
+
+        std::function<void()> job;
+
+        {
+            std::unique_lock<std::mutex> lock(JobSystem::pendingJobsMutex);
+            JobSystem::pendingJobsAvailable.wait(lock, [] { return JobSystem::shuttingDown || !JobSystem::pendingJobs.empty(); });
+
+            if (JobSystem::pendingJobs.empty()) {
+                return;
+            }
+
+            job = std::move(JobSystem::pendingJobs.front());
+            JobSystem::pendingJobs.pop_front();
+        }
+
+        job();
+    }
+}
+
+void InitJobSystem() {
+
+    uint32_t hardwareThreadCount = std::thread::hardware_concurrency();
+    uint32_t workerCount = hardwareThreadCount > 1 ? hardwareThreadCount - 1 : 1;
+
+    JobSystem::shuttingDown = false;
+
+    for (uint32_t i = 0; i < workerCount; i++)
+    {
+        JobSystem::workerThreads.emplace_back(WorkerThreadLoop);
+    }
+
+    std::cout << "Started job system with " << workerCount << " worker threads." << std::endl;
+}
+
+// Safe to call more than once, VulkanCleanup and JobSystemShutdownGuard both do.
+void ShutdownJobSystem() {
+
+    if (JobSystem::workerThreads.empty()) {
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(JobSystem::pendingJobsMutex);
+        JobSystem::shuttingDown = true;
+    }
+    JobSystem::pendingJobsAvailable.notify_all();
+
+    for (std::thread& workerThread : JobSystem::workerThreads) {
+        workerThread.join();
+    }
+
+    JobSystem::workerThreads.clear();
+}
+
+// Joins the workers when the owning scope is left, also when an exception skips VulkanCleanup. Joinable threads left for static
+// destruction would otherwise end the process in std::terminate.
+struct JobSystemShutdownGuard {
+
+    ~JobSystemShutdownGuard() {
+        ShutdownJobSystem();
+    }
+};
+
+void RunParallelForIterations(ParallelForState& state, const std::function<void(uint32_t)>& iterationFunction) {
+
+    uint32_t index;
+    while ((index = state.nextIndex.fetch_add(1)) < state.count) {
+
+        try {
+            iterationFunction(index);
+        }
+        catch (...) {
+            std::lock_guard<std::mutex> lock(state.exceptionMutex);
+            if (!state.firstException) {
+                state.firstException = std::current_exception();
+            }
+        }
+
+        if (state.completedCount.fetch_add(1) + 1 == state.count) {
+            std::lock_guard<std::mutex> lock(state.completionMutex);
+            state.allCompleted.notify_all();
+        }
+    }
+}
+
+// Runs iterationFunction(0 .. count - 1) across the worker threads and blocks until every iteration is done.
+// The calling thread works through iterations too, so nested ParallelFor calls from inside a job cannot deadlock
+// even when every worker is busy. The first exception thrown by any iteration is rethrown here.
+void ParallelFor(uint32_t count, const std::function<void(uint32_t)>& iterationFunction) {
+
+    if (count == 0) {
+        return;
+    }
+
+    if (count == 1 || JobSystem::workerThreads.empty()) {
+        for (uint32_t i = 0; i < count; i++)
+        {
+            iterationFunction(i);
+        }
+        return;
+    }
+
+    std::shared_ptr<ParallelForState> state = std::make_shared<ParallelForState>();
+    state->count = count;
+
+    uint32_t helperJobCount = std::min(count - 1, static_cast<uint32_t>(JobSystem::workerThreads.size()));
+
+    {
+        std::lock_guard<std::mutex> lock(JobSystem::pendingJobsMutex);
+        for (uint32_t i = 0; i < helperJobCount; i++)
+        {
+            // Helpers that only get scheduled after every index is taken exit straight away without touching iterationFunction.
+            JobSystem::pendingJobs.push_back([state, &iterationFunction] { RunParallelForIterations(*state, iterationFunction); });
+        }
+    }
+    JobSystem::pendingJobsAvailable.notify_all();
+
+    RunParallelForIterations(*state, iterationFunction);
+
+    {
+        std::unique_lock<std::mutex> lock(state->completionMutex);
+        state->allCompleted.wait(lock, [&] { return state->completedCount.load() == state->count; });
+    }
+
+    if (state->firstException) {
+        std::rethrow_exception(state->firstException);
+    }
+}
@@ -0,0 +1,87 @@
+#pragma once
+
+#include "DependencyIncludes.h"
+#include "StandardIncludes.h"
+
+// KTX 2.0 container layout (https://registry.khronos.org/KTX/specs/2.0/ktxspec.v2.html), everything little endian:
+//  identifier[12]
+//  Ktx2Header
+//  Ktx2Index
+//  Ktx2LevelIndexEntry[max(1, levelCount)]   level 0 is the base level
+//  data format descriptor, key/value data, supercompression global data
+//  mip level data, stored smallest level first
+
+const std::array<uint8_t, 12> KTX2_IDENTIFIER = { 0xAB, 0x4B, 0x54, 0x58, 0x20, 0x32, 0x30, 0xBB, 0x0D, 0x0A, 0x1A, 0x0A };
+
+const uint32_t KTX2_SUPERCOMPRESSION_NONE = 0;
+const uint32_t KTX2_SUPERCOMPRESSION_BASIS_LZ = 1;
+const uint32_t KTX2_SUPERCOMPRESSION_ZSTD = 2;
+
+const std::string KTX2_FILE_EXTENSION = ".ktx2";
+
+struct Ktx2Header {
+
+    uint32_t vkFormat;
+    uint32_t typeSize;
+    uint32_t pixelWidth;
+    uint32_t pixelHeight;
+    uint32_t pixelDepth;
+    uint32_t layerCount;
+    uint32_t faceCount;
+    uint32_t levelCount;
+    uint32_t supercompressionScheme;
+};
+
+struct Ktx2Index {
+
+    uint32_t dfdByteOffset;
+    uint32_t dfdByteLength;
+    uint32_t kvdByteOffset;
+    uint32_t kvdByteLength;
+    uint64_t sgdByteOffset;
+    uint64_t sgdByteLength;
+};
+
+struct Ktx2LevelIndexEntry {
+
+    uint64_t byteOffset;
+    uint64_t byteLength;
+    uint64_t uncompressedByteLength;
+};
+
+// Basic data format descriptor block, only what the offline converter writes (Khronos Data Format spec, section 5).
+const uint16_t KHR_DF_VERSION_NUMBER = 2;
+
+const uint8_t KHR_DF_MODEL_RGBSDA = 1;
+const uint8_t KHR_DF_MODEL_BC1A = 128;
+const uint8_t KHR_DF_MODEL_BC3 = 130;
+
+const uint8_t KHR_DF_PRIMARIES_BT709 = 1;
+const uint8_t KHR_DF_TRANSFER_SRGB = 2;
+
+const uint8_t KHR_DF_CHANNEL_BC1A_COLOR = 0;
+const uint8_t KHR_DF_CHANNEL_BC3_COLOR = 0;
+const uint8_t KHR_DF_CHANNEL_BC3_ALPHA = 15;
+
+struct Ktx2DataFormatDescriptorSample {
+
+    uint16_t bitOffset;
+    uint8_t bitLength;          // Stored minus one.
+    uint8_t channelType;
+    uint8_t samplePosition[4];
+    uint32_t sampleLower;
+    uint32_t sampleUpper;
+};
+
+struct Ktx2DataFormatDescriptorBlockHeader {
+
+    uint32_t vendorIdAndDescriptorType;
+    uint16_t versionNumber;
+    uint16_t descriptorBlockSize;
+    uint8_t colorModel;
+    uint8_t colorPrimaries;
+    uint8_t transferFunction;
+    uint8_t flags;
+    uint8_t texelBlockDimension[4];     // Stored minus one.
+    uint8_t bytesPlane[8];
+};
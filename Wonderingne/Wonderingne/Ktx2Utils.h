@@ -0,0 +1,280 @@
+#pragma once
+
+#include "Ktx2.h"
+#include "FileMappingUtils.h"
+#include "MipmapUtils.h"
+#include "VulkanInitUtils.h"
+
+#include <filesystem>
+#include <mutex>
+
+// Build with WONDERINGNE_USE_BASIS_UNIVERSAL and the Basis Universal transcoder sources to load BasisLZ/ETC1S and UASTC textures.
+#ifdef WONDERINGNE_USE_BASIS_UNIVERSAL
+#include "basisu/transcoder/basisu_transcoder.h"
+#endif
+
+// A texture read from a .ktx2 file, ready to be queued for upload. levelData either points into the mapped file
+// or into transcodedData, offsets are relative to levelData and ordered base level first.
+struct Ktx2TextureData {
+
+    VkFormat format = VK_FORMAT_UNDEFINED;
+    uint32_t width = 0;
+    uint32_t height = 0;
+    uint32_t mipLevels = 0;
+
+    const uint8_t* levelData = nullptr;
+    VkDeviceSize levelDataSize = 0;
+    std::vector<VkDeviceSize> mipLevelDataOffsets = {};
+
+    MappedFile mappedFile;
+    std::vector<uint8_t> transcodedData = {};
+};
+
+void ReleaseKtx2TextureData(Ktx2TextureData& textureData) {
+
+    UnmapFile(textureData.mappedFile);
+    textureData.transcodedData.clear();
+    textureData.transcodedData.shrink_to_fit();
+    textureData.levelData = nullptr;
+}
+
+bool IsBlockCompressedFormat(VkFormat format) {
+    return format >= VK_FORMAT_BC1_RGB_UNORM_BLOCK && format <= VK_FORMAT_BC7_SRGB_BLOCK;
+}
+
+bool IsKtx2FormatHandled(VkFormat format) {
+
+    switch (format) {
+    case VK_FORMAT_BC1_RGB_UNORM_BLOCK:
+    case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+    case VK_FORMAT_BC1_RGBA_UNORM_BLOCK:
+    case VK_FORMAT_BC1_RGBA_SRGB_BLOCK:
+    case VK_FORMAT_BC3_UNORM_BLOCK:
+    case VK_FORMAT_BC3_SRGB_BLOCK:
+    case VK_FORMAT_BC5_UNORM_BLOCK:
+    case VK_FORMAT_BC5_SNORM_BLOCK:
+    case VK_FORMAT_BC7_UNORM_BLOCK:
+    case VK_FORMAT_BC7_SRGB_BLOCK:
+    case VK_FORMAT_R8G8B8A8_UNORM:
+    case VK_FORMAT_R8G8B8A8_SRGB:
+        return true;
+    default:
+        return false;
+    }
+}
+
+// Bytes a level of a handled format needs, block compressed levels are padded to whole 4x4 blocks.
+uint64_t GetKtx2LevelByteSize(VkFormat format, uint32_t width, uint32_t height) {
+
+    if (!IsBlockCompressedFormat(format)) {
+        return static_cast<uint64_t>(width) * height * 4;
+    }
+
+    bool eightByteBlocks = format >= VK_FORMAT_BC1_RGB_UNORM_BLOCK && format <= VK_FORMAT_BC1_RGBA_SRGB_BLOCK;
+    uint64_t blockCount = static_cast<uint64_t>((width + 3) / 4) * ((height + 3) / 4);
+
+    return blockCount * (eightByteBlocks ? 8 : 16);
+}
+
+bool IsFormatSampleable(VkFormat format) {
+
+    if (IsBlockCompressedFormat(format) && !textureCompressionBCEnabled) {
+        return false;
+    }
+
+    VkFormatProperties formatProperties;
+    vkGetPhysicalDeviceFormatProperties(vk_PhysicalDevice, format, &formatProperties);
+
+    return (formatProperties.optimalTilingFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT) != 0;
+}
+
+// The offline converter writes "<texture without extension>.ktx2" next to the source image.
+std::string GetKtx2PathForTexture(const std::string& texturePath) {
+    return std::filesystem::path(texturePath).replace_extension(KTX2_FILE_EXTENSION).string();
+}
+
+#ifdef WONDERINGNE_USE_BASIS_UNIVERSAL
+// Transcodes to the best format the device can sample, BC7 then BC3 (BC1 without alpha) and uncompressed RGBA as the last resort.
+bool TranscodeKtx2WithBasisUniversal(Ktx2TextureData& textureData, const std::string& ktx2Path) {
+
+    static std::once_flag basisTranscoderInitFlag;
+    std::call_once(basisTranscoderInitFlag, [] { basist::basisu_transcoder_init(); });
+
+    basist::ktx2_transcoder transcoder;
+    if (!transcoder.init(textureData.mappedFile.data, static_cast<uint32_t>(textureData.mappedFile.size)) || !transcoder.start_transcoding()) {
+        std::cout << "Failed to start Basis Universal transcoding for := " << ktx2Path << std::endl;
+        return false;
+    }
+
+    bool isSRGB = transcoder.get_dfd_transfer_func() == KHR_DF_TRANSFER_SRGB;
+
+    basist::transcoder_texture_format transcodeFormat = basist::transcoder_texture_format::cTFRGBA32;
+    textureData.format = isSRGB ? VK_FORMAT_R8G8B8A8_SRGB : VK_FORMAT_R8G8B8A8_UNORM;
+
+    if (IsFormatSampleable(isSRGB ? VK_FORMAT_BC7_SRGB_BLOCK : VK_FORMAT_BC7_UNORM_BLOCK)) {
+        transcodeFormat = basist::transcoder_texture_format::cTFBC7_RGBA;
+        textureData.format = isSRGB ? VK_FORMAT_BC7_SRGB_BLOCK : VK_FORMAT_BC7_UNORM_BLOCK;
+    }
+    else if (!transcoder.get_has_alpha() && IsFormatSampleable(isSRGB ? VK_FORMAT_BC1_RGB_SRGB_BLOCK : VK_FORMAT_BC1_RGB_UNORM_BLOCK)) {
+        transcodeFormat = basist::transcoder_texture_format::cTFBC1_RGB;
+        textureData.format = isSRGB ? VK_FORMAT_BC1_RGB_SRGB_BLOCK : VK_FORMAT_BC1_RGB_UNORM_BLOCK;
+    }
+    else if (IsFormatSampleable(isSRGB ? VK_FORMAT_BC3_SRGB_BLOCK : VK_FORMAT_BC3_UNORM_BLOCK)) {
+        transcodeFormat = basist::transcoder_texture_format::cTFBC3_RGBA;
+        textureData.format = isSRGB ? VK_FORMAT_BC3_SRGB_BLOCK : VK_FORMAT_BC3_UNORM_BLOCK;
+    }
+
+    uint32_t bytesPerBlockOrPixel = basist::basis_get_bytes_per_block_or_pixel(transcodeFormat);
+    bool isUncompressed = basist::basis_transcoder_format_is_uncompressed(transcodeFormat);
+
+    textureData.width = transcoder.get_width();
+    textureData.height = transcoder.get_height();
+    textureData.mipLevels = transcoder.get_levels();
+    textureData.mipLevelDataOffsets.resize(textureData.mipLevels);
+
+    for (uint32_t level = 0; level < textureData.mipLevels; level++)
+    {
+        basist::ktx2_image_level_info levelInfo;
+        if (!transcoder.get_image_level_info(levelInfo, level, 0, 0)) {
+            return false;
+        }
+
+        uint32_t blocksOrPixels = isUncompressed ? levelInfo.m_orig_width * levelInfo.m_orig_height : levelInfo.m_total_blocks;
+
+        // Level sizes are multiples of the block size, so every level stays aligned for the buffer to image copy.
+        textureData.mipLevelDataOffsets[level] = textureData.transcodedData.size();
+        textureData.transcodedData.resize(textureData.transcodedData.size() + static_cast<size_t>(blocksOrPixels) * bytesPerBlockOrPixel);
+
+        if (!transcoder.transcode_image_level(level, 0, 0, textureData.transcodedData.data() + textureData.mipLevelDataOffsets[level], blocksOrPixels, transcodeFormat)) {
+            std::cout << "Failed to transcode level " << level << " of := " << ktx2Path << std::endl;
+            return false;
+        }
+    }
+
+    // The compressed source is no longer needed once everything is transcoded.
+    UnmapFile(textureData.mappedFile);
+
+    textureData.levelData = textureData.transcodedData.data();
+    textureData.levelDataSize = textureData.transcodedData.size();
+
+    return true;
+}
+#endif
+
+// Returns false for anything this loader can not turn into a 2D texture the device can sample, the caller falls back to the source image.
+bool LoadKtx2Texture(const std::string& ktx2Path, Ktx2TextureData& textureData) {
+
+    if (!MapFileForReading(ktx2Path, textureData.mappedFile)) {
+        return false;
+    }
+
+    const uint8_t* fileData = textureData.mappedFile.data;
+    uint64_t fileSize = textureData.mappedFile.size;
+
+    uint64_t headerEnd = KTX2_IDENTIFIER.size() + sizeof(Ktx2Header) + sizeof(Ktx2Index);
+    if (fileSize < headerEnd || memcmp(fileData, KTX2_IDENTIFIER.data(), KTX2_IDENTIFIER.size()) != 0) {
+        std::cout << "Not a KTX2 file := " << ktx2Path << std::endl;
+        ReleaseKtx2TextureData(textureData);
+        return false;
+    }
+
+    Ktx2Header header;
+    memcpy(&header, fileData + KTX2_IDENTIFIER.size(), sizeof(header));
+
+    if (header.pixelDepth > 1 || header.layerCount > 1 || header.faceCount != 1 || header.pixelWidth == 0 || header.pixelHeight == 0) {
+        std::cout << "Only 2D KTX2 textures are supported := " << ktx2Path << std::endl;
+        ReleaseKtx2TextureData(textureData);
+        return false;
+    }
+
+    // A level count of 0 asks the loader to generate mips, which it does not do for compressed formats, the source image path does.
+    if (header.levelCount == 0) {
+        std::cout << "KTX2 texture without stored mip levels := " << ktx2Path << std::endl;
+        ReleaseKtx2TextureData(textureData);
+        return false;
+    }
+
+    uint32_t storedLevelCount = header.levelCount;
+
+    if (storedLevelCount > GetMipLevelCount(header.pixelWidth, header.pixelHeight)) {
+        std::cout << "KTX2 texture has more levels than its size allows := " << ktx2Path << std::endl;
+        ReleaseKtx2TextureData(textureData);
+        return false;
+    }
+
+    if (fileSize < headerEnd + storedLevelCount * sizeof(Ktx2LevelIndexEntry)) {
+        ReleaseKtx2TextureData(textureData);
+        return false;
+    }
+
+    std::vector<Ktx2LevelIndexEntry> levelIndex(storedLevelCount);
+    memcpy(levelIndex.data(), fileData + headerEnd, storedLevelCount * sizeof(Ktx2LevelIndexEntry));
+
+    for (const Ktx2LevelIndexEntry& levelEntry : levelIndex) {
+        if (levelEntry.byteLength > fileSize || levelEntry.byteOffset > fileSize - levelEntry.byteLength) {
+            std::cout << "Truncated KTX2 file := " << ktx2Path << std::endl;
+            ReleaseKtx2TextureData(textureData);
+            return false;
+        }
+    }
+
+    VkFormat fileFormat = static_cast<VkFormat>(header.vkFormat);
+    bool needsBasisTranscoding = header.supercompressionScheme == KTX2_SUPERCOMPRESSION_BASIS_LZ || fileFormat == VK_FORMAT_UNDEFINED;
+
+    if (needsBasisTranscoding) {
+#ifdef WONDERINGNE_USE_BASIS_UNIVERSAL
+        if (!TranscodeKtx2WithBasisUniversal(textureData, ktx2Path)) {
+            ReleaseKtx2TextureData(textureData);
+            return false;
+        }
+        return true;
+#else
+        std::cout << "KTX2 texture needs Basis Universal transcoding, build with WONDERINGNE_USE_BASIS_UNIVERSAL := " << ktx2Path << std::endl;
+        ReleaseKtx2TextureData(textureData);
+        return false;
+#endif
+    }
+
+    if (header.supercompressionScheme != KTX2_SUPERCOMPRESSION_NONE || !IsKtx2FormatHandled(fileFormat) || !IsFormatSampleable(fileFormat)) {
+        std::cout << "Unsupported KTX2 format " << header.vkFormat << " or supercompression " << header.supercompressionScheme << " := " << ktx2Path << std::endl;
+        ReleaseKtx2TextureData(textureData);
+        return false;
+    }
+
+    // A short level would make the buffer to image copy read past the staging data.
+    for (uint32_t level = 0; level < storedLevelCount; level++)
+    {
+        uint32_t levelWidth = std::max(header.pixelWidth >> level, 1u);
+        uint32_t levelHeight = std::max(header.pixelHeight >> level, 1u);
+
+        if (levelIndex[level].byteLength < GetKtx2LevelByteSize(fileFormat, levelWidth, levelHeight)) {
+            std::cout << "KTX2 level " << level << " is smaller than its size needs := " << ktx2Path << std::endl;
+            ReleaseKtx2TextureData(textureData);
+            return false;
+        }
+    }
+
+    // Levels are stored smallest first, so the whole chain is one contiguous range that can be copied straight from the mapping.
+    uint64_t levelDataBegin = fileSize;
+    uint64_t levelDataEnd = 0;
+    for (const Ktx2LevelIndexEntry& levelEntry : levelIndex) {
+        levelDataBegin = std::min(levelDataBegin, levelEntry.byteOffset);
+        levelDataEnd = std::max(levelDataEnd, levelEntry.byteOffset + levelEntry.byteLength);
+    }
+
+    textureData.format = fileFormat;
+    textureData.width = header.pixelWidth;
+    textureData.height = header.pixelHeight;
+    textureData.mipLevels = storedLevelCount;
+
+    textureData.levelData = fileData + levelDataBegin;
+    textureData.levelDataSize = levelDataEnd - levelDataBegin;
+
+    textureData.mipLevelDataOffsets.resize(storedLevelCount);
+    for (uint32_t level = 0; level < storedLevelCount; level++)
+    {
+        textureData.mipLevelDataOffsets[level] = levelIndex[level].byteOffset - levelDataBegin;
+    }
+
+    return true;
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include "Model.h"
+
+// AABB of the vertices and a sphere around the AABB center, which is tighter than the half diagonal for most meshes.
+void CalculateMeshBounds(Mesh& curMesh) {
+
+    curMesh.localBounds = MeshBounds{};
+
+    if (curMesh.vertices.empty()) {
+        return;
+    }
+
+    glm::vec3 boundsMin = curMesh.vertices[0].position;
+    glm::vec3 boundsMax = curMesh.vertices[0].position;
+    for (const Vertex& vertex : curMesh.vertices) {
+        boundsMin = glm::min(boundsMin, vertex.position);
+        boundsMax = glm::max(boundsMax, vertex.position);
+    }
+
+    glm::vec3 sphereCenter = (boundsMin + boundsMax) * 0.5f;
+
+    float sphereRadiusSquared = 0.0f;
+    for (const Vertex& vertex : curMesh.vertices) {
+        glm::vec3 toVertex = vertex.position - sphereCenter;
+        sphereRadiusSquared = std::max(sphereRadiusSquared, glm::dot(toVertex, toVertex));
+    }
+
+    curMesh.localBounds.aabbMin = boundsMin;
+    curMesh.localBounds.aabbMax = boundsMax;
+    curMesh.localBounds.sphereCenter = sphereCenter;
+    curMesh.localBounds.sphereRadius = std::sqrt(sphereRadiusSquared);
+}
+
+// meshToWorld is the model transform without the position dequantization. Non uniform scales grow the sphere by the largest axis.
+void UpdateMeshWorldBounds(Mesh& curMesh, const glm::mat4& meshToWorld) {
+
+    float maxAxisScale = std::max(glm::length(glm::vec3(meshToWorld[0])), std::max(glm::length(glm::vec3(meshToWorld[1])), glm::length(glm::vec3(meshToWorld[2]))));
+
+    curMesh.worldBoundsCenter = glm::vec3(meshToWorld * glm::vec4(curMesh.localBounds.sphereCenter, 1.0f));
+    curMesh.worldBoundsRadius = curMesh.localBounds.sphereRadius * maxAxisScale;
+}
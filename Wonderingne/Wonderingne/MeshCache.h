@@ -0,0 +1,64 @@
+#pragma once
+
+#include "StandardIncludes.h"
+
+// On disk layout of a .meshcache file, everything little endian and laid out in this order:
+//  MeshCacheFileHeader
+//  MeshCacheMeshEntry[meshCount]
+//  MeshCacheTextureEntry[textureCount]
+//  Vertex[] (all meshes back to back)
+//  uint32_t[] indices (all meshes back to back)
+//  char[] texture path strings (not null terminated)
+
+const uint32_t MESH_CACHE_MAGIC = 0x43484D57; // "WMHC"
+
+struct MeshCacheFileHeader {
+
+    uint32_t magic;
+    uint32_t version;
+
+    uint32_t vertexStride;
+    uint32_t indexStride;
+    uint32_t importFlags;
+    uint32_t optimizationFlags;
+
+    // Cache key, compared against the source file before the cache is trusted.
+    uint64_t sourceFileSize;
+    int64_t sourceFileModifiedTime;
+    uint64_t sourceContentHash;
+
+    uint32_t meshCount;
+    uint32_t textureCount;
+
+    uint64_t meshTableOffset;
+    uint64_t textureTableOffset;
+    uint64_t vertexDataOffset;
+    uint64_t indexDataOffset;
+    uint64_t stringDataOffset;
+    uint64_t totalFileSize;
+};
+
+struct MeshCacheMeshEntry {
+
+    uint64_t firstVertex;
+    uint64_t firstIndex;
+    uint32_t vertexCount;
+    uint32_t indexCount;
+
+    // Index into the texture table, -1 when the mesh has no diffuse texture.
+    int32_t diffuseTextureTableIndex;
+    uint32_t padding;
+
+    // MeshBounds, written out field by field so the entry layout does not depend on glm.
+    float boundsAABBMin[3];
+    float boundsAABBMax[3];
+    float boundsSphereCenter[3];
+    float boundsSphereRadius;
+};
+
+struct MeshCacheTextureEntry {
+
+    uint64_t pathOffset;
+    uint32_t pathLength;
+    uint32_t padding;
+};
@@ -0,0 +1,297 @@
+#pragma once
+
+#include <filesystem>
+
+#include "EngineConstants.h"
+
+#include "Model.h"
+#include "MeshCache.h"
+#include "FileMappingUtils.h"
+
+struct MeshCacheSourceKey {
+
+    uint64_t fileSize = 0;
+    int64_t modifiedTime = 0;
+    uint64_t contentHash = 0;
+};
+
+uint64_t HashBytesFNV1a(const uint8_t* data, uint64_t size, uint64_t hash = 14695981039346656037ull) {
+
+    for (uint64_t i = 0; i < size; i++)
+    {
+        hash ^= data[i];
+        hash *= 1099511628211ull;
+    }
+
+    return hash;
+}
+
+std::string GetMeshCacheFilePath(const std::string& sourceFilePath) {
+    return sourceFilePath + MESH_CACHE_FILE_EXTENSION;
+}
+
+// Size and modified time are cheap, the content hash needs a full read of the source file so it is only computed when asked for.
+bool GetMeshCacheSourceKey(const std::string& sourceFilePath, bool computeContentHash, MeshCacheSourceKey& sourceKey) {
+
+    std::error_code errorCode;
+
+    sourceKey.fileSize = static_cast<uint64_t>(std::filesystem::file_size(sourceFilePath, errorCode));
+    if (errorCode) {
+        return false;
+    }
+
+    sourceKey.modifiedTime = static_cast<int64_t>(std::filesystem::last_write_time(sourceFilePath, errorCode).time_since_epoch().count());
+    if (errorCode) {
+        return false;
+    }
+
+    if (computeContentHash) {
+        MappedFile sourceFile;
+        if (!MapFileForReading(sourceFilePath, sourceFile)) {
+            return false;
+        }
+
+        sourceKey.contentHash = HashBytesFNV1a(sourceFile.data, sourceFile.size);
+        UnmapFile(sourceFile);
+    }
+
+    return true;
+}
+
+bool IsMeshCacheHeaderValid(const MeshCacheFileHeader& header, uint64_t cacheFileSize, uint32_t importFlags, uint32_t optimizationFlags) {
+
+    if (header.magic != MESH_CACHE_MAGIC || header.version != MESH_CACHE_VERSION) {
+        return false;
+    }
+
+    if (header.vertexStride != sizeof(Vertex) || header.indexStride != sizeof(uint32_t) || header.importFlags != importFlags || header.optimizationFlags != optimizationFlags) {
+        return false;
+    }
+
+    if (header.totalFileSize != cacheFileSize) {
+        return false;
+    }
+
+    // Counts are compared against what fits in the rest of the file, a corrupt count can not wrap a multiplication around then.
+    bool tablesInBounds = header.meshTableOffset <= cacheFileSize
+        && header.meshCount <= (cacheFileSize - header.meshTableOffset) / sizeof(MeshCacheMeshEntry)
+        && header.textureTableOffset <= cacheFileSize
+        && header.textureCount <= (cacheFileSize - header.textureTableOffset) / sizeof(MeshCacheTextureEntry);
+
+    // The section sizes are the differences of consecutive offsets, so they have to come in file order.
+    bool sectionsInOrder = header.vertexDataOffset <= header.indexDataOffset
+        && header.indexDataOffset <= header.stringDataOffset
+        && header.stringDataOffset <= header.totalFileSize;
+
+    return tablesInBounds && sectionsInOrder;
+}
+
+// Fills model.meshes (vertices, indices and diffuseTexturePath) from the cache file next to model.path.
+// Returns false if there is no cache or it is stale, in which case model.meshes is left untouched.
+bool TryLoadModelDataFromMeshCache(Model& model, uint32_t importFlags, uint32_t optimizationFlags) {
+
+    MeshCacheSourceKey sourceKey;
+    if (!GetMeshCacheSourceKey(model.path, false, sourceKey)) {
+        return false;
+    }
+
+    MappedFile cacheFile;
+    if (!MapFileForReading(GetMeshCacheFilePath(model.path), cacheFile)) {
+        return false;
+    }
+
+    if (cacheFile.size < sizeof(MeshCacheFileHeader)) {
+        UnmapFile(cacheFile);
+        return false;
+    }
+
+    MeshCacheFileHeader header;
+    memcpy(&header, cacheFile.data, sizeof(header));
+
+    if (!IsMeshCacheHeaderValid(header, cacheFile.size, importFlags, optimizationFlags) || header.sourceFileSize != sourceKey.fileSize) {
+        UnmapFile(cacheFile);
+        return false;
+    }
+
+    // Touched but unchanged sources (fresh checkouts, copies) still hit the cache through the content hash.
+    if (header.sourceFileModifiedTime != sourceKey.modifiedTime) {
+        if (!GetMeshCacheSourceKey(model.path, true, sourceKey) || header.sourceContentHash != sourceKey.contentHash) {
+            UnmapFile(cacheFile);
+            return false;
+        }
+    }
+
+    const MeshCacheMeshEntry* meshEntries = reinterpret_cast<const MeshCacheMeshEntry*>(cacheFile.data + header.meshTableOffset);
+    const MeshCacheTextureEntry* textureEntries = reinterpret_cast<const MeshCacheTextureEntry*>(cacheFile.data + header.textureTableOffset);
+    const Vertex* allVertices = reinterpret_cast<const Vertex*>(cacheFile.data + header.vertexDataOffset);
+    const uint32_t* allIndices = reinterpret_cast<const uint32_t*>(cacheFile.data + header.indexDataOffset);
+    const char* allStrings = reinterpret_cast<const char*>(cacheFile.data + header.stringDataOffset);
+
+    uint64_t vertexCapacity = (header.indexDataOffset - header.vertexDataOffset) / sizeof(Vertex);
+    uint64_t indexCapacity = (header.stringDataOffset - header.indexDataOffset) / sizeof(uint32_t);
+    uint64_t stringCapacity = header.totalFileSize - header.stringDataOffset;
+
+    std::vector<Mesh> cachedMeshes(header.meshCount);
+
+    for (uint32_t i = 0; i < header.meshCount; i++)
+    {
+        const MeshCacheMeshEntry& meshEntry = meshEntries[i];
+
+        bool meshInBounds = meshEntry.firstVertex <= vertexCapacity && meshEntry.vertexCount <= vertexCapacity - meshEntry.firstVertex
+            && meshEntry.firstIndex <= indexCapacity && meshEntry.indexCount <= indexCapacity - meshEntry.firstIndex
+            && meshEntry.diffuseTextureTableIndex < static_cast<int32_t>(header.textureCount);
+
+        if (!meshInBounds) {
+            UnmapFile(cacheFile);
+            return false;
+        }
+
+        Mesh& curMesh = cachedMeshes[i];
+        curMesh.vertices.assign(allVertices + meshEntry.firstVertex, allVertices + meshEntry.firstVertex + meshEntry.vertexCount);
+        curMesh.indices.assign(allIndices + meshEntry.firstIndex, allIndices + meshEntry.firstIndex + meshEntry.indexCount);
+
+        curMesh.localBounds.aabbMin = glm::vec3(meshEntry.boundsAABBMin[0], meshEntry.boundsAABBMin[1], meshEntry.boundsAABBMin[2]);
+        curMesh.localBounds.aabbMax = glm::vec3(meshEntry.boundsAABBMax[0], meshEntry.boundsAABBMax[1], meshEntry.boundsAABBMax[2]);
+        curMesh.localBounds.sphereCenter = glm::vec3(meshEntry.boundsSphereCenter[0], meshEntry.boundsSphereCenter[1], meshEntry.boundsSphereCenter[2]);
+        curMesh.localBounds.sphereRadius = meshEntry.boundsSphereRadius;
+
+        if (meshEntry.diffuseTextureTableIndex >= 0) {
+            const MeshCacheTextureEntry& textureEntry = textureEntries[meshEntry.diffuseTextureTableIndex];
+            if (textureEntry.pathOffset > stringCapacity || textureEntry.pathLength > stringCapacity - textureEntry.pathOffset) {
+                UnmapFile(cacheFile);
+                return false;
+            }
+
+            curMesh.diffuseTexturePath = std::string(allStrings + textureEntry.pathOffset, textureEntry.pathLength);
+        }
+    }
+
+    UnmapFile(cacheFile);
+
+    model.directory = model.path.substr(0, model.path.find_last_of('/'));
+    model.meshes = std::move(cachedMeshes);
+
+    return true;
+}
+
+template<typename T>
+void WriteMeshCacheBytes(std::ofstream& file, const T* data, uint64_t count) {
+    file.write(reinterpret_cast<const char*>(data), static_cast<std::streamsize>(sizeof(T) * count));
+}
+
+// Writes to a temporary file first and renames it over the old cache so a crash never leaves a half written cache behind.
+void WriteMeshCacheForModel(const Model& model, uint32_t importFlags, uint32_t optimizationFlags) {
+
+    MeshCacheSourceKey sourceKey;
+    if (!GetMeshCacheSourceKey(model.path, true, sourceKey)) {
+        std::cout << "Failed to read source file for mesh cache := " << model.path << std::endl;
+        return;
+    }
+
+    std::vector<MeshCacheMeshEntry> meshEntries(model.meshes.size());
+    std::vector<MeshCacheTextureEntry> textureEntries;
+    std::unordered_map<std::string, int32_t> textureTableIndices;
+    std::string stringData;
+
+    uint64_t totalVertexCount = 0;
+    uint64_t totalIndexCount = 0;
+
+    for (int i = 0; i < model.meshes.size(); i++)
+    {
+        const Mesh& curMesh = model.meshes[i];
+        MeshCacheMeshEntry& meshEntry = meshEntries[i];
+
+        meshEntry.firstVertex = totalVertexCount;
+        meshEntry.firstIndex = totalIndexCount;
+        meshEntry.vertexCount = static_cast<uint32_t>(curMesh.vertices.size());
+        meshEntry.indexCount = static_cast<uint32_t>(curMesh.indices.size());
+        meshEntry.diffuseTextureTableIndex = -1;
+        meshEntry.padding = 0;
+
+        for (int axis = 0; axis < 3; axis++)
+        {
+            meshEntry.boundsAABBMin[axis] = curMesh.localBounds.aabbMin[axis];
+            meshEntry.boundsAABBMax[axis] = curMesh.localBounds.aabbMax[axis];
+            meshEntry.boundsSphereCenter[axis] = curMesh.localBounds.sphereCenter[axis];
+        }
+        meshEntry.boundsSphereRadius = curMesh.localBounds.sphereRadius;
+
+        totalVertexCount += curMesh.vertices.size();
+        totalIndexCount += curMesh.indices.size();
+
+        if (curMesh.diffuseTexturePath.empty()) {
+            continue;
+        }
+
+        if (!textureTableIndices.contains(curMesh.diffuseTexturePath)) {
+            MeshCacheTextureEntry textureEntry{};
+            textureEntry.pathOffset = stringData.size();
+            textureEntry.pathLength = static_cast<uint32_t>(curMesh.diffuseTexturePath.size());
+
+            textureTableIndices[curMesh.diffuseTexturePath] = static_cast<int32_t>(textureEntries.size());
+            textureEntries.push_back(textureEntry);
+            stringData += curMesh.diffuseTexturePath;
+        }
+
+        meshEntry.diffuseTextureTableIndex = textureTableIndices[curMesh.diffuseTexturePath];
+    }
+
+    MeshCacheFileHeader header{};
+    header.magic = MESH_CACHE_MAGIC;
+    header.version = MESH_CACHE_VERSION;
+    header.vertexStride = sizeof(Vertex);
+    header.indexStride = sizeof(uint32_t);
+    header.importFlags = importFlags;
+    header.optimizationFlags = optimizationFlags;
+
+    header.sourceFileSize = sourceKey.fileSize;
+    header.sourceFileModifiedTime = sourceKey.modifiedTime;
+    header.sourceContentHash = sourceKey.contentHash;
+
+    header.meshCount = static_cast<uint32_t>(meshEntries.size());
+    header.textureCount = static_cast<uint32_t>(textureEntries.size());
+
+    header.meshTableOffset = sizeof(MeshCacheFileHeader);
+    header.textureTableOffset = header.meshTableOffset + sizeof(MeshCacheMeshEntry) * meshEntries.size();
+    header.vertexDataOffset = header.textureTableOffset + sizeof(MeshCacheTextureEntry) * textureEntries.size();
+    header.indexDataOffset = header.vertexDataOffset + sizeof(Vertex) * totalVertexCount;
+    header.stringDataOffset = header.indexDataOffset + sizeof(uint32_t) * totalIndexCount;
+    header.totalFileSize = header.stringDataOffset + stringData.size();
+
+    std::string cacheFilePath = GetMeshCacheFilePath(model.path);
+    std::string temporaryFilePath = cacheFilePath + ".tmp";
+
+    {
+        std::ofstream file(temporaryFilePath, std::ios::binary | std::ios::trunc);
+        if (!file.is_open()) {
+            std::cout << "Failed to open mesh cache for writing := " << temporaryFilePath << std::endl;
+            return;
+        }
+
+        WriteMeshCacheBytes(file, &header, 1);
+        WriteMeshCacheBytes(file, meshEntries.data(), meshEntries.size());
+        WriteMeshCacheBytes(file, textureEntries.data(), textureEntries.size());
+
+        for (const Mesh& curMesh : model.meshes) {
+            WriteMeshCacheBytes(file, curMesh.vertices.data(), curMesh.vertices.size());
+        }
+
+        for (const Mesh& curMesh : model.meshes) {
+            WriteMeshCacheBytes(file, curMesh.indices.data(), curMesh.indices.size());
+        }
+
+        WriteMeshCacheBytes(file, stringData.data(), stringData.size());
+
+        if (!file.good()) {
+            std::cout << "Failed to write mesh cache := " << temporaryFilePath << std::endl;
+            return;
+        }
+    }
+
+    std::error_code errorCode;
+    std::filesystem::rename(temporaryFilePath, cacheFilePath, errorCode);
+    if (errorCode) {
+        std::cout << "Failed to replace mesh cache := " << cacheFilePath << " Error := " << errorCode.message() << std::endl;
+        std::filesystem::remove(temporaryFilePath, errorCode);
+    }
+}
@@ -0,0 +1,582 @@
+#pragma once
+
+#include "EngineConstants.h"
+
+#include "Model.h"
+#include "MeshBoundsUtils.h"
+
+// Import time mesh optimization. Runs once per mesh after ProcessMesh, the result is what ends up in the mesh cache.
+//  1. Weld bitwise identical vertices.
+//  2. Reorder triangles for the post transform vertex cache (Forsyth, "Linear-Speed Vertex Cache Optimisation").
+//  3. Optionally reorder clusters of triangles so likely occluders are drawn first (Sander et al., "Fast Triangle Reordering").
+//  4. Reorder vertices in first use order for fetch locality.
+
+const uint32_t MESH_OPTIMIZATION_WELD_VERTICES_BIT = 1 << 0;
+const uint32_t MESH_OPTIMIZATION_VERTEX_CACHE_BIT = 1 << 1;
+const uint32_t MESH_OPTIMIZATION_OVERDRAW_BIT = 1 << 2;
+const uint32_t MESH_OPTIMIZATION_VERTEX_FETCH_BIT = 1 << 3;
+const uint32_t MESH_OPTIMIZATION_SPLIT_FOR_16_BIT_INDICES_BIT = 1 << 4;
+
+const uint32_t FORSYTH_CACHE_SIZE = 32;
+const float FORSYTH_CACHE_DECAY_POWER = 1.5f;
+const float FORSYTH_LAST_TRIANGLE_SCORE = 0.75f;
+const float FORSYTH_VALENCE_BOOST_SCALE = 2.0f;
+const float FORSYTH_VALENCE_BOOST_POWER = 0.5f;
+
+struct MeshOptimizationStats {
+
+    uint32_t vertexCountBefore = 0;
+    uint32_t vertexCountAfter = 0;
+
+    float acmrBefore = 0.0f;
+    float acmrAfter = 0.0f;
+
+    float atvrBefore = 0.0f;
+    float atvrAfter = 0.0f;
+};
+
+// Part of the mesh cache key, so toggling any of the optimizations rebuilds the caches.
+uint32_t GetMeshOptimizationFlags() {
+
+    uint32_t flags = 0;
+    if (SPLIT_MESHES_FOR_16_BIT_INDICES) {
+        flags |= MESH_OPTIMIZATION_SPLIT_FOR_16_BIT_INDICES_BIT;
+    }
+
+    if (!OPTIMIZE_IMPORTED_MESHES) {
+        return flags;
+    }
+
+    flags |= MESH_OPTIMIZATION_WELD_VERTICES_BIT | MESH_OPTIMIZATION_VERTEX_CACHE_BIT | MESH_OPTIMIZATION_VERTEX_FETCH_BIT;
+    if (OPTIMIZE_IMPORTED_MESHES_FOR_OVERDRAW) {
+        flags |= MESH_OPTIMIZATION_OVERDRAW_BIT;
+    }
+
+    return flags;
+}
+
+// Simulated FIFO post transform cache, returns the number of misses for one triangle.
+uint32_t SimulateFIFOCacheForTriangle(const uint32_t* triangle, std::vector<uint32_t>& vertexCacheTimestamps, uint32_t& cacheTimestamp) {
+
+    uint32_t misses = 0;
+    for (uint32_t k = 0; k < 3; k++)
+    {
+        uint32_t vertexIndex = triangle[k];
+        if (cacheTimestamp - vertexCacheTimestamps[vertexIndex] > ACMR_SIMULATION_CACHE_SIZE) {
+            vertexCacheTimestamps[vertexIndex] = cacheTimestamp++;
+            misses++;
+        }
+    }
+
+    return misses;
+}
+
+// Average cache miss ratio, transformed vertices per triangle. 3.0 is the worst case, 0.5 the best a regular grid can reach.
+float CalculateACMR(const std::vector<uint32_t>& indices, size_t vertexCount, float* outATVR = nullptr) {
+
+    size_t triangleCount = indices.size() / 3;
+    if (triangleCount == 0 || vertexCount == 0) {
+        return 0.0f;
+    }
+
+    // Starting the clock past the cache size makes every first use a miss without a separate "never cached" state.
+    std::vector<uint32_t> vertexCacheTimestamps(vertexCount, 0);
+    uint32_t cacheTimestamp = ACMR_SIMULATION_CACHE_SIZE + 1;
+
+    uint64_t misses = 0;
+    for (size_t i = 0; i < triangleCount; i++)
+    {
+        misses += SimulateFIFOCacheForTriangle(&indices[i * 3], vertexCacheTimestamps, cacheTimestamp);
+    }
+
+    if (outATVR != nullptr) {
+        *outATVR = static_cast<float>(misses) / static_cast<float>(vertexCount);
+    }
+
+    return static_cast<float>(misses) / static_cast<float>(triangleCount);
+}
+
+uint64_t HashVertexBytes(const Vertex& vertex) {
+
+    const uint8_t* bytes = reinterpret_cast<const uint8_t*>(&vertex);
+
+    uint64_t hash = 14695981039346656037ull;
+    for (size_t i = 0; i < sizeof(Vertex); i++)
+    {
+        hash ^= bytes[i];
+        hash *= 1099511628211ull;
+    }
+
+    return hash;
+}
+
+// Bitwise welding, vertices only merge when every attribute matches exactly. Unreferenced vertices are left for the fetch pass.
+void WeldMeshVertices(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices) {
+
+    size_t hashTableSize = 1;
+    while (hashTableSize < vertices.size() * 2) {
+        hashTableSize <<= 1;
+    }
+
+    const uint32_t EMPTY_SLOT = UINT32_MAX;
+    std::vector<uint32_t> hashTable(hashTableSize, EMPTY_SLOT);
+
+    std::vector<Vertex> weldedVertices;
+    weldedVertices.reserve(vertices.size());
+
+    std::vector<uint32_t> remap(vertices.size());
+
+    for (size_t i = 0; i < vertices.size(); i++)
+    {
+        size_t slot = HashVertexBytes(vertices[i]) & (hashTableSize - 1);
+
+        while (hashTable[slot] != EMPTY_SLOT && memcmp(&weldedVertices[hashTable[slot]], &vertices[i], sizeof(Vertex)) != 0) {
+            slot = (slot + 1) & (hashTableSize - 1);
+        }
+
+        if (hashTable[slot] == EMPTY_SLOT) {
+            hashTable[slot] = static_cast<uint32_t>(weldedVertices.size());
+            weldedVertices.push_back(vertices[i]);
+        }
+
+        remap[i] = hashTable[slot];
+    }
+
+    for (uint32_t& index : indices) {
+        index = remap[index];
+    }
+
+    vertices = std::move(weldedVertices);
+}
+
+float ForsythVertexScore(int cachePosition, uint32_t remainingTriangles) {
+
+    if (remainingTriangles == 0) {
+        return -1.0f;
+    }
+
+    float score = 0.0f;
+    if (cachePosition >= 0) {
+
+        // The last triangle's vertices get a fixed score so the next triangle does not just reuse the same edge.
+        if (cachePosition < 3) {
+            score = FORSYTH_LAST_TRIANGLE_SCORE;
+        }
+        else {
+            float scaler = 1.0f / (FORSYTH_CACHE_SIZE - 3);
+            score = powf(1.0f - (cachePosition - 3) * scaler, FORSYTH_CACHE_DECAY_POWER);
+        }
+    }
+
+    // Favour vertices with few triangles left so they get finished off instead of leaving lone triangles for later.
+    score += FORSYTH_VALENCE_BOOST_SCALE * powf(static_cast<float>(remainingTriangles), -FORSYTH_VALENCE_BOOST_POWER);
+
+    return score;
+}
+
+void OptimizeVertexCacheOrder(std::vector<uint32_t>& indices, size_t vertexCount) {
+
+    size_t triangleCount = indices.size() / 3;
+    if (triangleCount == 0) {
+        return;
+    }
+
+    // Vertex to triangle adjacency, each vertex owns a slice of adjacentTriangles and the first remainingTriangles entries are still to be emitted.
+    std::vector<uint32_t> remainingTriangles(vertexCount, 0);
+    for (uint32_t index : indices) {
+        remainingTriangles[index]++;
+    }
+
+    std::vector<uint32_t> adjacencyOffsets(vertexCount, 0);
+    uint32_t adjacencyOffset = 0;
+    for (size_t v = 0; v < vertexCount; v++)
+    {
+        adjacencyOffsets[v] = adjacencyOffset;
+        adjacencyOffset += remainingTriangles[v];
+    }
+
+    std::vector<uint32_t> adjacentTriangles(indices.size());
+    std::vector<uint32_t> adjacencyFill(vertexCount, 0);
+    for (size_t t = 0; t < triangleCount; t++)
+    {
+        for (uint32_t k = 0; k < 3; k++)
+        {
+            uint32_t v = indices[t * 3 + k];
+            adjacentTriangles[adjacencyOffsets[v] + adjacencyFill[v]++] = static_cast<uint32_t>(t);
+        }
+    }
+
+    std::vector<int> cachePositions(vertexCount, -1);
+    std::vector<float> vertexScores(vertexCount);
+    for (size_t v = 0; v < vertexCount; v++)
+    {
+        vertexScores[v] = ForsythVertexScore(-1, remainingTriangles[v]);
+    }
+
+    std::vector<float> triangleScores(triangleCount);
+    std::vector<bool> triangleEmitted(triangleCount, false);
+    for (size_t t = 0; t < triangleCount; t++)
+    {
+        triangleScores[t] = vertexScores[indices[t * 3 + 0]] + vertexScores[indices[t * 3 + 1]] + vertexScores[indices[t * 3 + 2]];
+    }
+
+    std::vector<uint32_t> optimizedIndices;
+    optimizedIndices.reserve(indices.size());
+
+    std::vector<uint32_t> cache;
+    std::vector<uint32_t> nextCache;
+    cache.reserve(FORSYTH_CACHE_SIZE + 3);
+    nextCache.reserve(FORSYTH_CACHE_SIZE + 3);
+
+    int64_t bestTriangle = std::max_element(triangleScores.begin(), triangleScores.end()) - triangleScores.begin();
+    size_t deadEndCursor = 0;
+
+    while (bestTriangle >= 0) {
+
+        triangleEmitted[bestTriangle] = true;
+
+        const uint32_t* triangle = &indices[bestTriangle * 3];
+        nextCache.assign(triangle, triangle + 3);
+
+        for (uint32_t k = 0; k < 3; k++)
+        {
+            uint32_t v = triangle[k];
+
+            optimizedIndices.push_back(v);
+
+            uint32_t* vertexTriangles = &adjacentTriangles[adjacencyOffsets[v]];
+            for (uint32_t a = 0; a < remainingTriangles[v]; a++)
+            {
+                if (vertexTriangles[a] == bestTriangle) {
+                    std::swap(vertexTriangles[a], vertexTriangles[remainingTriangles[v] - 1]);
+                    break;
+                }
+            }
+            remainingTriangles[v]--;
+        }
+
+        for (uint32_t cachedVertex : cache) {
+            if (cachedVertex != triangle[0] && cachedVertex != triangle[1] && cachedVertex != triangle[2]) {
+                nextCache.push_back(cachedVertex);
+            }
+        }
+
+        // Rescore everything that moved in the cache, including the vertices that just fell out of it.
+        for (size_t c = 0; c < nextCache.size(); c++)
+        {
+            uint32_t v = nextCache[c];
+            cachePositions[v] = c < FORSYTH_CACHE_SIZE ? static_cast<int>(c) : -1;
+
+            float newScore = ForsythVertexScore(cachePositions[v], remainingTriangles[v]);
+            float scoreDelta = newScore - vertexScores[v];
+            vertexScores[v] = newScore;
+
+            const uint32_t* vertexTriangles = &adjacentTriangles[adjacencyOffsets[v]];
+            for (uint32_t a = 0; a < remainingTriangles[v]; a++)
+            {
+                triangleScores[vertexTriangles[a]] += scoreDelta;
+            }
+        }
+
+        if (nextCache.size() > FORSYTH_CACHE_SIZE) {
+            nextCache.resize(FORSYTH_CACHE_SIZE);
+        }
+        std::swap(cache, nextCache);
+
+        // Only triangles touching the cache can score well, everything else is picked up by the dead end scan below.
+        bestTriangle = -1;
+        float bestScore = -1.0f;
+        for (uint32_t cachedVertex : cache) {
+
+            const uint32_t* vertexTriangles = &adjacentTriangles[adjacencyOffsets[cachedVertex]];
+            for (uint32_t a = 0; a < remainingTriangles[cachedVertex]; a++)
+            {
+                uint32_t t = vertexTriangles[a];
+                if (triangleScores[t] > bestScore) {
+                    bestScore = triangleScores[t];
+                    bestTriangle = t;
+                }
+            }
+        }
+
+        if (bestTriangle < 0) {
+            while (deadEndCursor < triangleCount && triangleEmitted[deadEndCursor]) {
+                deadEndCursor++;
+            }
+            if (deadEndCursor < triangleCount) {
+                bestTriangle = static_cast<int64_t>(deadEndCursor);
+            }
+        }
+    }
+
+    indices = std::move(optimizedIndices);
+}
+
+// Splits the cache optimized order into clusters and sorts them front to back relative to the mesh centre, trading at most
+// OVERDRAW_OPTIMIZATION_ACMR_THRESHOLD worth of cache efficiency for less overdraw.
+void OptimizeOverdrawOrder(std::vector<uint32_t>& indices, const std::vector<Vertex>& vertices) {
+
+    size_t triangleCount = indices.size() / 3;
+    if (triangleCount < 2) {
+        return;
+    }
+
+    std::vector<uint32_t> vertexCacheTimestamps(vertices.size(), 0);
+    uint32_t cacheTimestamp = ACMR_SIMULATION_CACHE_SIZE + 1;
+
+    // Hard boundaries, where the cache order jumped somewhere new and every vertex of the triangle missed.
+    std::vector<size_t> hardClusterStarts;
+    for (size_t t = 0; t < triangleCount; t++)
+    {
+        if (SimulateFIFOCacheForTriangle(&indices[t * 3], vertexCacheTimestamps, cacheTimestamp) == 3) {
+            hardClusterStarts.push_back(t);
+        }
+    }
+    hardClusterStarts.push_back(triangleCount);
+
+    // Soft boundaries, split a hard cluster again whenever restarting the cache there keeps its ACMR under the threshold.
+    std::vector<size_t> clusterStarts;
+    for (size_t h = 0; h + 1 < hardClusterStarts.size(); h++)
+    {
+        size_t hardStart = hardClusterStarts[h];
+        size_t hardEnd = hardClusterStarts[h + 1];
+
+        cacheTimestamp += ACMR_SIMULATION_CACHE_SIZE + 1;
+        uint32_t hardClusterMisses = 0;
+        for (size_t t = hardStart; t < hardEnd; t++)
+        {
+            hardClusterMisses += SimulateFIFOCacheForTriangle(&indices[t * 3], vertexCacheTimestamps, cacheTimestamp);
+        }
+
+        float clusterACMRThreshold = static_cast<float>(hardClusterMisses) / static_cast<float>(hardEnd - hardStart) * OVERDRAW_OPTIMIZATION_ACMR_THRESHOLD;
+
+        size_t softStart = hardStart;
+        uint32_t softClusterMisses = 0;
+        cacheTimestamp += ACMR_SIMULATION_CACHE_SIZE + 1;
+        clusterStarts.push_back(softStart);
+
+        for (size_t t = hardStart; t < hardEnd; t++)
+        {
+            softClusterMisses += SimulateFIFOCacheForTriangle(&indices[t * 3], vertexCacheTimestamps, cacheTimestamp);
+
+            if (t + 1 < hardEnd && static_cast<float>(softClusterMisses) / static_cast<float>(t - softStart + 1) <= clusterACMRThreshold) {
+                softStart = t + 1;
+                softClusterMisses = 0;
+                cacheTimestamp += ACMR_SIMULATION_CACHE_SIZE + 1;
+                clusterStarts.push_back(softStart);
+            }
+        }
+    }
+    clusterStarts.push_back(triangleCount);
+
+    glm::vec3 meshCentroid = glm::vec3(0.0f);
+    float meshArea = 0.0f;
+
+    size_t clusterCount = clusterStarts.size() - 1;
+    std::vector<glm::vec3> clusterCentroids(clusterCount, glm::vec3(0.0f));
+    std::vector<glm::vec3> clusterNormals(clusterCount, glm::vec3(0.0f));
+
+    for (size_t c = 0; c < clusterCount; c++)
+    {
+        float clusterArea = 0.0f;
+
+        for (size_t t = clusterStarts[c]; t < clusterStarts[c + 1]; t++)
+        {
+            const glm::vec3& p0 = vertices[indices[t * 3 + 0]].position;
+            const glm::vec3& p1 = vertices[indices[t * 3 + 1]].position;
+            const glm::vec3& p2 = vertices[indices[t * 3 + 2]].position;
+
+            // Length of the cross product is twice the area, so this normal is already area weighted.
+            glm::vec3 areaNormal = glm::cross(p1 - p0, p2 - p0);
+            float triangleArea = glm::length(areaNormal);
+            glm::vec3 triangleCentroid = (p0 + p1 + p2) / 3.0f;
+
+            clusterNormals[c] += areaNormal;
+            clusterCentroids[c] += triangleCentroid * triangleArea;
+            clusterArea += triangleArea;
+
+            meshCentroid += triangleCentroid * triangleArea;
+            meshArea += triangleArea;
+        }
+
+        clusterCentroids[c] = clusterArea > 0.0f ? clusterCentroids[c] / clusterArea : clusterCentroids[c];
+
+        float normalLength = glm::length(clusterNormals[c]);
+        clusterNormals[c] = normalLength > 0.0f ? clusterNormals[c] / normalLength : clusterNormals[c];
+    }
+
+    meshCentroid = meshArea > 0.0f ? meshCentroid / meshArea : meshCentroid;
+
+    // Clusters facing away from the centre sit on the outside of the mesh, drawing them first lets early depth reject the inside.
+    std::vector<float> clusterSortKeys(clusterCount);
+    std::vector<uint32_t> clusterOrder(clusterCount);
+    for (size_t c = 0; c < clusterCount; c++)
+    {
+        clusterSortKeys[c] = glm::dot(clusterCentroids[c] - meshCentroid, clusterNormals[c]);
+        clusterOrder[c] = static_cast<uint32_t>(c);
+    }
+
+    std::stable_sort(clusterOrder.begin(), clusterOrder.end(), [&](uint32_t a, uint32_t b) { return clusterSortKeys[a] > clusterSortKeys[b]; });
+
+    std::vector<uint32_t> sortedIndices;
+    sortedIndices.reserve(indices.size());
+    for (uint32_t c : clusterOrder) {
+        sortedIndices.insert(sortedIndices.end(), indices.begin() + clusterStarts[c] * 3, indices.begin() + clusterStarts[c + 1] * 3);
+    }
+
+    indices = std::move(sortedIndices);
+}
+
+// Lays vertices out in the order the index buffer first touches them and drops anything unreferenced.
+void OptimizeVertexFetchOrder(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices) {
+
+    std::vector<uint32_t> remap(vertices.size(), UINT32_MAX);
+
+    std::vector<Vertex> reorderedVertices;
+    reorderedVertices.reserve(vertices.size());
+
+    for (uint32_t& index : indices) {
+
+        if (remap[index] == UINT32_MAX) {
+            remap[index] = static_cast<uint32_t>(reorderedVertices.size());
+            reorderedVertices.push_back(vertices[index]);
+        }
+
+        index = remap[index];
+    }
+
+    vertices = std::move(reorderedVertices);
+}
+
+MeshOptimizationStats OptimizeMesh(Mesh& curMesh) {
+
+    MeshOptimizationStats stats{};
+    stats.vertexCountBefore = static_cast<uint32_t>(curMesh.vertices.size());
+    stats.acmrBefore = CalculateACMR(curMesh.indices, curMesh.vertices.size(), &stats.atvrBefore);
+
+    uint32_t optimizationFlags = GetMeshOptimizationFlags();
+
+    if (optimizationFlags & MESH_OPTIMIZATION_WELD_VERTICES_BIT) {
+        WeldMeshVertices(curMesh.vertices, curMesh.indices);
+    }
+
+    if (optimizationFlags & MESH_OPTIMIZATION_VERTEX_CACHE_BIT) {
+        OptimizeVertexCacheOrder(curMesh.indices, curMesh.vertices.size());
+    }
+
+    if (optimizationFlags & MESH_OPTIMIZATION_OVERDRAW_BIT) {
+        OptimizeOverdrawOrder(curMesh.indices, curMesh.vertices);
+    }
+
+    if (optimizationFlags & MESH_OPTIMIZATION_VERTEX_FETCH_BIT) {
+        OptimizeVertexFetchOrder(curMesh.vertices, curMesh.indices);
+    }
+
+    stats.vertexCountAfter = static_cast<uint32_t>(curMesh.vertices.size());
+    stats.acmrAfter = CalculateACMR(curMesh.indices, curMesh.vertices.size(), &stats.atvrAfter);
+
+    return stats;
+}
+
+// Built into one string first since meshes are optimized on worker threads.
+void LogMeshOptimizationStats(const MeshOptimizationStats& stats, const std::string& modelPath, size_t meshIndex) {
+
+    std::ostringstream message;
+    message << std::fixed << std::setprecision(3);
+    message << "Optimized mesh " << meshIndex << " of " << modelPath
+            << " := vertices " << stats.vertexCountBefore << " -> " << stats.vertexCountAfter
+            << ", ACMR " << stats.acmrBefore << " -> " << stats.acmrAfter
+            << ", ATVR " << stats.atvrBefore << " -> " << stats.atvrAfter << "\n";
+
+    std::cout << message.str();
+}
+
+// Cuts a mesh into consecutive runs of triangles that each reference fewer than MAX_VERTICES_FOR_16_BIT_INDICES vertices.
+// Triangles keep their order, so the cache optimized order is mostly preserved and every piece stays spatially coherent.
+void SplitMeshForSixteenBitIndices(const Mesh& curMesh, std::vector<Mesh>& outMeshes) {
+
+    std::vector<uint32_t> remap(curMesh.vertices.size(), UINT32_MAX);
+    std::vector<uint32_t> remappedVertices;
+
+    Mesh piece;
+
+    auto finishPiece = [&]() {
+
+        for (uint32_t originalVertex : remappedVertices) {
+            remap[originalVertex] = UINT32_MAX;
+        }
+        remappedVertices.clear();
+
+        // The bounds of the whole mesh were calculated before the split, every piece needs its own.
+        piece.diffuseTexturePath = curMesh.diffuseTexturePath;
+        CalculateMeshBounds(piece);
+        outMeshes.push_back(std::move(piece));
+        piece = Mesh();
+    };
+
+    for (size_t i = 0; i + 2 < curMesh.indices.size(); i += 3)
+    {
+        uint32_t newVertexCount = 0;
+        for (uint32_t k = 0; k < 3; k++)
+        {
+            newVertexCount += remap[curMesh.indices[i + k]] == UINT32_MAX ? 1 : 0;
+        }
+
+        if (piece.vertices.size() + newVertexCount > MAX_VERTICES_FOR_16_BIT_INDICES - 1) {
+            finishPiece();
+        }
+
+        for (uint32_t k = 0; k < 3; k++)
+        {
+            uint32_t originalVertex = curMesh.indices[i + k];
+
+            if (remap[originalVertex] == UINT32_MAX) {
+                remap[originalVertex] = static_cast<uint32_t>(piece.vertices.size());
+                remappedVertices.push_back(originalVertex);
+                piece.vertices.push_back(curMesh.vertices[originalVertex]);
+            }
+
+            piece.indices.push_back(remap[originalVertex]);
+        }
+    }
+
+    if (!piece.indices.empty()) {
+        finishPiece();
+    }
+}
+
+void SplitModelMeshesForSixteenBitIndices(Model& model) {
+
+    bool anyMeshTooLarge = false;
+    for (const Mesh& curMesh : model.meshes) {
+        anyMeshTooLarge |= curMesh.vertices.size() >= MAX_VERTICES_FOR_16_BIT_INDICES;
+    }
+
+    if (!anyMeshTooLarge) {
+        return;
+    }
+
+    std::vector<Mesh> splitMeshes;
+    splitMeshes.reserve(model.meshes.size());
+
+    for (Mesh& curMesh : model.meshes) {
+
+        if (curMesh.vertices.size() < MAX_VERTICES_FOR_16_BIT_INDICES) {
+            splitMeshes.push_back(std::move(curMesh));
+            continue;
+        }
+
+        size_t firstPieceIndex = splitMeshes.size();
+        SplitMeshForSixteenBitIndices(curMesh, splitMeshes);
+
+        std::ostringstream message;
+        message << "Split mesh with " << curMesh.vertices.size() << " vertices of " << model.path << " into " << splitMeshes.size() - firstPieceIndex << " meshes for 16 bit indices.\n";
+        std::cout << message.str();
+    }
+
+    model.meshes = std::move(splitMeshes);
+}
+
+VkIndexType GetIndexTypeForVertexCount(size_t vertexCount) {
+    return vertexCount < MAX_VERTICES_FOR_16_BIT_INDICES ? VK_INDEX_TYPE_UINT16 : VK_INDEX_TYPE_UINT32;
+}
\ No newline at end of file
@@ -0,0 +1,82 @@
+#pragma once
+
+#include "DependencyIncludes.h"
+#include "StandardIncludes.h"
+
+#include <cmath>
+
+// Full chain down to 1x1.
+uint32_t GetMipLevelCount(uint32_t width, uint32_t height) {
+    return static_cast<uint32_t>(std::floor(std::log2(std::max(width, height)))) + 1;
+}
+
+float SRGBToLinear(float srgb) {
+    return srgb <= 0.04045f ? srgb / 12.92f : powf((srgb + 0.055f) / 1.055f, 2.4f);
+}
+
+float LinearToSRGB(float linear) {
+    return linear <= 0.0031308f ? linear * 12.92f : 1.055f * powf(linear, 1.0f / 2.4f) - 0.055f;
+}
+
+// CPU fallback for formats the device can not blit with linear filtering. Builds the whole chain of an RGBA8 sRGB image with a
+// 2x2 box filter in linear space, levels are packed back to back in mipChain starting with a copy of the base level.
+void GenerateRGBA8SRGBMipChainOnCPU(const uint8_t* basePixels, uint32_t width, uint32_t height, uint32_t mipLevels, std::vector<uint8_t>& mipChain, std::vector<VkDeviceSize>& mipLevelDataOffsets) {
+
+    std::array<float, 256> srgbToLinearTable;
+    for (int i = 0; i < 256; i++)
+    {
+        srgbToLinearTable[i] = SRGBToLinear(i / 255.0f);
+    }
+
+    VkDeviceSize totalSize = 0;
+    mipLevelDataOffsets.resize(mipLevels);
+    for (uint32_t level = 0; level < mipLevels; level++)
+    {
+        mipLevelDataOffsets[level] = totalSize;
+        totalSize += static_cast<VkDeviceSize>(std::max(width >> level, 1u)) * std::max(height >> level, 1u) * 4;
+    }
+
+    mipChain.resize(static_cast<size_t>(totalSize));
+    memcpy(mipChain.data(), basePixels, static_cast<size_t>(width) * height * 4);
+
+    for (uint32_t level = 1; level < mipLevels; level++)
+    {
+        uint32_t srcWidth = std::max(width >> (level - 1), 1u);
+        uint32_t srcHeight = std::max(height >> (level - 1), 1u);
+        uint32_t dstWidth = std::max(width >> level, 1u);
+        uint32_t dstHeight = std::max(height >> level, 1u);
+
+        const uint8_t* src = mipChain.data() + mipLevelDataOffsets[level - 1];
+        uint8_t* dst = mipChain.data() + mipLevelDataOffsets[level];
+
+        for (uint32_t y = 0; y < dstHeight; y++)
+        {
+            // Odd sizes and 1 pixel wide levels just sample the last row or column twice.
+            uint32_t y0 = std::min(y * 2, srcHeight - 1);
+            uint32_t y1 = std::min(y * 2 + 1, srcHeight - 1);
+
+            for (uint32_t x = 0; x < dstWidth; x++)
+            {
+                uint32_t x0 = std::min(x * 2, srcWidth - 1);
+                uint32_t x1 = std::min(x * 2 + 1, srcWidth - 1);
+
+                const uint8_t* texels[4] = { &src[(y0 * srcWidth + x0) * 4], &src[(y0 * srcWidth + x1) * 4], &src[(y1 * srcWidth + x0) * 4], &src[(y1 * srcWidth + x1) * 4] };
+                uint8_t* dstTexel = &dst[(y * dstWidth + x) * 4];
+
+                for (int channel = 0; channel < 3; channel++)
+                {
+                    float linearSum = 0.0f;
+                    for (const uint8_t* texel : texels) {
+                        linearSum += srgbToLinearTable[texel[channel]];
+                    }
+
+                    dstTexel[channel] = static_cast<uint8_t>(std::clamp(LinearToSRGB(linearSum * 0.25f), 0.0f, 1.0f) * 255.0f + 0.5f);
+                }
+
+                // Alpha is stored linearly.
+                uint32_t alphaSum = texels[0][3] + texels[1][3] + texels[2][3] + texels[3][3];
+                dstTexel[3] = static_cast<uint8_t>((alphaSum + 2) / 4);
+            }
+        }
+    }
+}
@@ -31,13 +31,26 @@ struct Texture {
     VmaAllocation vma_TextureImageAllocation;
 
     VkImageView vk_TextureImageView;
+    VkFormat vk_Format = VK_FORMAT_R8G8B8A8_SRGB;
+    uint32_t mipLevels = 1;
 
     bool loaded = false;
+    uint64_t uploadBatchID = 0;
 
     inline static std::unordered_map<std::string, int> allLoadedTexturePathsWithMaterialIndex = {};
     inline static std::vector<Texture> allLoadedTextures = {};
 };
 
+// Object space bounds of the original, unquantized positions.
+struct MeshBounds {
+
+    glm::vec3 aabbMin = glm::vec3(0.0f);
+    glm::vec3 aabbMax = glm::vec3(0.0f);
+
+    glm::vec3 sphereCenter = glm::vec3(0.0f);
+    float sphereRadius = 0.0f;
+};
+
 struct Mesh {
 
 public:
@@ -45,15 +58,41 @@ public:
     std::vector<uint32_t> indices = {};
 
     int materialIndex = -1;
+    std::string diffuseTexturePath = "";
+
+    // Ranges in the GeometryArena, vertexOffset and firstIndex go straight into the draw.
+    VmaVirtualAllocation vma_VertexRange = VK_NULL_HANDLE;
+    VmaVirtualAllocation vma_IndexRange = VK_NULL_HANDLE;
+    int32_t vertexOffset = 0;
+    uint32_t firstIndex = 0;
+
+    // Filled in when the vertices are encoded into GPUVertexFormat, the dequantization is folded into the model matrix.
+    glm::vec3 positionDequantizationScale = glm::vec3(1.0f);
+    glm::vec3 positionDequantizationOffset = glm::vec3(0.0f);
+    VkDeviceSize attributeStreamOffset = 0;
 
-    VkBuffer vk_VertexBuffer;
-    VmaAllocation vma_VertexBufferAllocation;
+    // Indices stay uint32_t on the CPU, they are packed to 16 bits on upload when this is VK_INDEX_TYPE_UINT16.
+    VkIndexType vk_IndexType = VK_INDEX_TYPE_UINT32;
 
-    VkBuffer vk_IndexBuffer;
-    VmaAllocation vma_IndexBufferAllocation;
+    // Vertex and index data are only safe to draw once IsUploadBatchUsable returns true for this.
+    uint64_t uploadBatchID = 0;
 
-    std::vector<VkBuffer> vk_ModelUniformBuffers;
-    std::vector<VmaAllocation> vk_ModelUniformBuffersAllocations;
+    // Where this frame's ModelUniformBufferObject was written in the ModelUniformRing.
+    uint32_t modelUniformDynamicOffset = 0;
+
+    // Computed at import and stored in the mesh cache.
+    MeshBounds localBounds;
+
+    // Bounding sphere after this frame's model transform, used to sort draws by depth and for CPU frustum culling.
+    glm::vec3 worldBoundsCenter = glm::vec3(0.0f);
+    float worldBoundsRadius = 0.0f;
+
+    // This frame's model transform again, indirect draws read it from the DrawData buffer instead of the ring.
+    glm::mat4 modelMatrix = glm::mat4(1.0f);
+
+    // Slot in the draw culling instance buffer, stable across frames unlike the draw index. Only scene meshes get one, once GPU
+    // culling picks them up.
+    uint32_t drawCullingInstanceIndex = UINT32_MAX;
 };
 
 struct Model {
@@ -64,6 +103,11 @@ public:
     std::string directory = "";
     std::vector<Mesh> meshes = {};
 
+    // Set every frame by UpdateModelTransform. Meshes stay in model space and all of them move with this.
+    glm::mat4 modelToWorld = glm::mat4(1.0f);
+
+    bool loadedFromMeshCache = false;
+
     inline static std::vector<Model> allModelsThatNeedToBeLoadedAndRendered = {};
 
 };
\ No newline at end of file
@@ -0,0 +1,22 @@
+#pragma once
+
+#include "DependencyIncludes.h"
+#include "StandardIncludes.h"
+
+#include "EngineConstants.h"
+
+// One persistently mapped uniform buffer per frame in flight. Every draw writes its ModelUniformBufferObject at the next
+// aligned offset and binds it through the dynamic offset of the material set, the ring is rewound once the frame's fence
+// has signalled.
+struct ModelUniformRing {
+
+public:
+
+	inline static std::array<VkBuffer, MAX_FRAMES_IN_FLIGHT> vk_Buffers = {};
+	inline static std::array<VmaAllocation, MAX_FRAMES_IN_FLIGHT> vma_Allocations = {};
+	inline static std::array<uint8_t*, MAX_FRAMES_IN_FLIGHT> mappedData = {};
+
+	inline static VkDeviceSize alignedElementSize = 0;
+	inline static VkDeviceSize writeOffset = 0;
+
+};
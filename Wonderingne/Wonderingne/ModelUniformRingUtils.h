@@ -0,0 +1,53 @@
+#pragma once
+
+#include "ModelUniformRing.h"
+#include "ShaderMemoryVariables.h"
+
+#include "VulkanCreateUtils.h"
+
+void CreateModelUniformRingBuffers_VMA() {
+
+    VkPhysicalDeviceProperties properties{};
+    vkGetPhysicalDeviceProperties(vk_PhysicalDevice, &properties);
+
+    VkDeviceSize alignment = properties.limits.minUniformBufferOffsetAlignment;
+    ModelUniformRing::alignedElementSize = (sizeof(ModelUniformBufferObject) + alignment - 1) & ~(alignment - 1);
+
+    for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+
+        // Host coherent, so writes need no flush before the submit.
+        CreateBuffer_VMA(MODEL_UNIFORM_RING_SIZE, VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT | VMA_ALLOCATION_CREATE_MAPPED_BIT, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, ModelUniformRing::vk_Buffers[i], ModelUniformRing::vma_Allocations[i]);
+        vmaSetAllocationName(vma_Allocator, ModelUniformRing::vma_Allocations[i], "Model Uniform Ring");
+
+        VmaAllocationInfo allocationInfo;
+        vmaGetAllocationInfo(vma_Allocator, ModelUniformRing::vma_Allocations[i], &allocationInfo);
+        ModelUniformRing::mappedData[i] = static_cast<uint8_t*>(allocationInfo.pMappedData);
+    }
+}
+
+void DestroyModelUniformRingBuffers() {
+
+    for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+        vmaDestroyBuffer(vma_Allocator, ModelUniformRing::vk_Buffers[i], ModelUniformRing::vma_Allocations[i]);
+    }
+}
+
+// Only once the frame's in flight fence has been waited on, the GPU may still be reading the ring before that.
+void ResetModelUniformRing() {
+    ModelUniformRing::writeOffset = 0;
+}
+
+// Returns the dynamic offset to bind the written data with.
+uint32_t WriteToModelUniformRing(const ModelUniformBufferObject& modelUBO, uint32_t indexOfDataForCurrentFrame) {
+
+    if (ModelUniformRing::writeOffset + ModelUniformRing::alignedElementSize > MODEL_UNIFORM_RING_SIZE) {
+        throw std::runtime_error("model uniform ring is full, raise MODEL_UNIFORM_RING_SIZE!");
+    }
+
+    uint32_t dynamicOffset = static_cast<uint32_t>(ModelUniformRing::writeOffset);
+    memcpy(ModelUniformRing::mappedData[indexOfDataForCurrentFrame] + dynamicOffset, &modelUBO, sizeof(modelUBO));
+
+    ModelUniformRing::writeOffset += ModelUniformRing::alignedElementSize;
+
+    return dynamicOffset;
+}
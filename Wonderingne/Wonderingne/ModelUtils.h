@@ -3,6 +3,16 @@
 #include "EngineConstants.h"
 
 #include "Model.h"
+#include "MeshCacheUtils.h"
+#include "MeshOptimizationUtils.h"
+#include "MeshBoundsUtils.h"
+#include "VertexFormatUtils.h"
+#include "GeometryArenaUtils.h"
+#include "ModelUniformRingUtils.h"
+#include "MipmapUtils.h"
+#include "Ktx2Utils.h"
+#include "BindlessTexturesUtils.h"
+#include "JobSystemUtils.h"
 #include "VulkanCreateUtils.h"
 
 #define STB_IMAGE_IMPLEMENTATION
@@ -16,7 +26,7 @@ void CreateDescriptorSetLayoutForMaterials() {
 
     VkDescriptorSetLayoutBinding modelUBOLayoutBinding{};
     modelUBOLayoutBinding.binding = MODEL_UBO_BINDING_LOCATION;
-    modelUBOLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+    modelUBOLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
     modelUBOLayoutBinding.descriptorCount = 1;
     modelUBOLayoutBinding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
 
@@ -40,7 +50,33 @@ void CreateDescriptorSetLayoutForMaterials() {
 }
 
 
-void CreateMaterialWithTexturesForMesh(aiMaterial* mat, Mesh& curMesh, Model& model)
+void AssignMaterialForTexturePath(const std::string& curTexturePathNameFull, Mesh& curMesh)
+{
+    if (!Texture::allLoadedTexturePathsWithMaterialIndex.contains(curTexturePathNameFull)) {
+
+        std::cout << "Newly added texture := " << curTexturePathNameFull << " to texture list to be loaded." << std::endl;
+
+        curMesh.materialIndex = static_cast<int>(Material::allLoadedMaterials.size());
+        Material::allLoadedMaterials.push_back(Material());
+
+        Material::allLoadedMaterials[curMesh.materialIndex].diffuseTextureIndex = static_cast<int>(Texture::allLoadedTextures.size());
+        Texture::allLoadedTextures.push_back(Texture());
+        Texture::allLoadedTextures[Material::allLoadedMaterials[curMesh.materialIndex].diffuseTextureIndex].texturePath = curTexturePathNameFull;
+
+        Texture::allLoadedTexturePathsWithMaterialIndex[curTexturePathNameFull] = curMesh.materialIndex;
+
+        //std::cout << "CALL 1 := " << "Added new material and texture.materialIndex : = " << curMesh.materialIndex << " textureIndex := " << Material::allLoadedMaterials[curMesh.materialIndex].diffuseTextureIndex << std::endl;
+    }
+    else {
+
+        std::cout << "Already added texture := " << curTexturePathNameFull << " to texture list to be loaded." << std::endl;
+        curMesh.materialIndex = Texture::allLoadedTexturePathsWithMaterialIndex[curTexturePathNameFull];
+    }
+}
+
+// Only records the texture path on the mesh, the shared material and texture tables are filled in later by ResolveMaterialsForModel
+// so that meshes can be processed on worker threads.
+void GetDiffuseTexturePathForMesh(aiMaterial* mat, Mesh& curMesh, Model& model)
 {
     aiTextureType type = aiTextureType_DIFFUSE;
     for (unsigned int i = 0; i < mat->GetTextureCount(type) && i < 1; i++)
@@ -48,33 +84,25 @@ void CreateMaterialWithTexturesForMesh(aiMaterial* mat, Mesh& curMesh, Model& mo
         aiString str;
         mat->GetTexture(type, i, &str);
 
-        std::string curTexturePathNameFull = model.directory + "/" + std::string(str.C_Str());
-        if (!Texture::allLoadedTexturePathsWithMaterialIndex.contains(curTexturePathNameFull)) {
-
-            std::cout << "Newly added texture := " << curTexturePathNameFull << " to texture list to be loaded." << std::endl;
-
-            curMesh.materialIndex = static_cast<int>(Material::allLoadedMaterials.size());
-            Material::allLoadedMaterials.push_back(Material());
-
-            Material::allLoadedMaterials[curMesh.materialIndex].diffuseTextureIndex = static_cast<int>(Texture::allLoadedTextures.size());
-            Texture::allLoadedTextures.push_back(Texture());
-            Texture::allLoadedTextures[Material::allLoadedMaterials[curMesh.materialIndex].diffuseTextureIndex].texturePath = curTexturePathNameFull;
-
-            Texture::allLoadedTexturePathsWithMaterialIndex[curTexturePathNameFull] = curMesh.materialIndex;
+        curMesh.diffuseTexturePath = model.directory + "/" + std::string(str.C_Str());
+    }
+}
 
-            //std::cout << "CALL 1 := " << "Added new material and texture.materialIndex : = " << curMesh.materialIndex << " textureIndex := " << Material::allLoadedMaterials[curMesh.materialIndex].diffuseTextureIndex << std::endl;
-        }
-        else {
+void ResolveMaterialsForModel(Model& model) {
 
-            std::cout << "Already added texture := " << curTexturePathNameFull << " to texture list to be loaded." << std::endl;
-            curMesh.materialIndex = Texture::allLoadedTexturePathsWithMaterialIndex[curTexturePathNameFull];
+    for (int i = 0; i < model.meshes.size(); i++)
+    {
+        Mesh& curMesh = model.meshes[i];
+        if (!curMesh.diffuseTexturePath.empty()) {
+            AssignMaterialForTexturePath(curMesh.diffuseTexturePath, curMesh);
         }
-
     }
 }
 
 void ProcessMesh(aiMesh* mesh, const aiScene* scene, Mesh& curMesh, Model& model)
 {
+    curMesh.vertices.reserve(mesh->mNumVertices);
+    curMesh.indices.reserve(static_cast<size_t>(mesh->mNumFaces) * 3);
 
     // walk through each of the mesh's vertices
     for (unsigned int i = 0; i < mesh->mNumVertices; i++)
@@ -111,33 +139,69 @@ void ProcessMesh(aiMesh* mesh, const aiScene* scene, Mesh& curMesh, Model& model
         }
     }
 
-    CreateMaterialWithTexturesForMesh(scene->mMaterials[mesh->mMaterialIndex], curMesh, model);
-    //std::cout << "CALL 2 := " << " materialIndex : = " << curMesh.materialIndex << " textureIndex := " << Material::allLoadedMaterials[curMesh.materialIndex].diffuseTextureIndex << std::endl;
+    GetDiffuseTexturePathForMesh(scene->mMaterials[mesh->mMaterialIndex], curMesh, model);
 }
 
-void ProcessNode(aiNode* node, const aiScene* scene, Model& model)
+void CollectNodeMeshes(aiNode* node, const aiScene* scene, std::vector<aiMesh*>& nodeMeshes)
 {
     // process all the node's meshes (if any)
     for (unsigned int i = 0; i < node->mNumMeshes; i++)
     {
         aiMesh* mesh = scene->mMeshes[node->mMeshes[i]];
 
-        // Can be made faster by simply pre calculating the number of meshes and then passing around the index of the mesh in the meshes array to populate with data.
-        Mesh curMesh = {};
-        ProcessMesh(mesh, scene, curMesh, model);
-        model.meshes.push_back(curMesh);
+        // Optimization, the 16 bit split and every draw step through the indices in threes, so point and line meshes are dropped.
+        if (mesh->mPrimitiveTypes != aiPrimitiveType_TRIANGLE) {
+            continue;
+        }
 
-        //std::cout << "Node Meshes := " << node->mNumMeshes << std::endl;
+        nodeMeshes.push_back(mesh);
     }
     for (unsigned int i = 0; i < node->mNumChildren; i++)
     {
-        //std::cout << "Processing children meshes." << std::endl;
-        ProcessNode(node->mChildren[i], scene, model);
+        CollectNodeMeshes(node->mChildren[i], scene, nodeMeshes);
+    }
+}
+
+void ProcessNode(aiNode* node, const aiScene* scene, Model& model)
+{
+    // Meshes keep the depth first node order regardless of which thread processes them.
+    std::vector<aiMesh*> nodeMeshes;
+    CollectNodeMeshes(node, scene, nodeMeshes);
 
-        //std::cout << "Children Meshes := " << node->mNumChildren << std::endl;
+    size_t firstMeshIndex = model.meshes.size();
+    model.meshes.resize(firstMeshIndex + nodeMeshes.size());
+
+    uint64_t totalVertexCount = 0;
+    for (aiMesh* mesh : nodeMeshes) {
+        totalVertexCount += mesh->mNumVertices;
+    }
+
+    auto processMeshAtIndex = [&](uint32_t i) {
+        Mesh& curMesh = model.meshes[firstMeshIndex + i];
+        ProcessMesh(nodeMeshes[i], scene, curMesh, model);
+
+        if (OPTIMIZE_IMPORTED_MESHES) {
+            MeshOptimizationStats stats = OptimizeMesh(curMesh);
+            LogMeshOptimizationStats(stats, model.path, firstMeshIndex + i);
+        }
+
+        CalculateMeshBounds(curMesh);
+    };
+
+    if (totalVertexCount >= PARALLEL_MESH_PROCESSING_MIN_VERTICES) {
+        ParallelFor(static_cast<uint32_t>(nodeMeshes.size()), processMeshAtIndex);
+    }
+    else {
+        for (uint32_t i = 0; i < nodeMeshes.size(); i++)
+        {
+            processMeshAtIndex(i);
+        }
     }
 }
 
+// SortByPType splits meshes with mixed primitives, so every mesh holds triangles only or no triangles at all.
+const uint32_t ASSIMP_IMPORT_FLAGS = aiProcess_Triangulate | aiProcess_SortByPType | aiProcess_FlipUVs;
+
 void LoadModelDataWithAssimp(Model& model) {
 
     if (strcmp(model.path.c_str(), "") == 0) {
@@ -145,7 +209,7 @@ void LoadModelDataWithAssimp(Model& model) {
     }
 
     Assimp::Importer importer;
-    const aiScene* scene = importer.ReadFile(model.path, aiProcess_Triangulate | aiProcess_FlipUVs);
+    const aiScene* scene = importer.ReadFile(model.path, ASSIMP_IMPORT_FLAGS);
 
     if (!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode)
     {
@@ -155,60 +219,51 @@ void LoadModelDataWithAssimp(Model& model) {
     model.directory = model.path.substr(0, model.path.find_last_of('/'));
 
     ProcessNode(scene->mRootNode, scene, model);
-}
-
-
-void CreateVertexBuffer_VMA(Mesh& currentMesh) {
 
-    VkDeviceSize bufferSize = sizeof(currentMesh.vertices[0]) * currentMesh.vertices.size();
-
-    VkBuffer stagingBuffer;
-    VmaAllocation vma_StagingBufferAllocation;
-    CreateBuffer_VMA(bufferSize, VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, stagingBuffer, vma_StagingBufferAllocation);
-
-    if (vmaCopyMemoryToAllocation(vma_Allocator, currentMesh.vertices.data(), vma_StagingBufferAllocation, 0, bufferSize) != VK_SUCCESS) {
-        throw std::runtime_error("failed to copy vertex data to staging buffer!");
+    if (SPLIT_MESHES_FOR_16_BIT_INDICES) {
+        SplitModelMeshesForSixteenBitIndices(model);
     }
+}
 
-    CreateBuffer_VMA(bufferSize, 0, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, currentMesh.vk_VertexBuffer, currentMesh.vma_VertexBufferAllocation);
 
-    CopyBuffer(stagingBuffer, currentMesh.vk_VertexBuffer, bufferSize);
-    vmaDestroyBuffer(vma_Allocator, stagingBuffer, vma_StagingBufferAllocation);
-}
+void QueueMeshVertexUpload(Mesh& currentMesh, const std::string& meshName, UploadBatch& uploadBatch) {
 
-void CreateIndexBuffer_VMA(Mesh& currentMesh) {
+    // Kept alive by the callback until the batch has copied it into the staging buffer.
+    std::shared_ptr<std::vector<uint8_t>> encodedVertices = std::make_shared<std::vector<uint8_t>>();
+    EncodeMeshVerticesForGPU<GPUVertexFormat>(currentMesh, meshName, *encodedVertices);
 
-    VkDeviceSize bufferSize = sizeof(currentMesh.indices[0]) * currentMesh.indices.size();
+    VkDeviceSize vertexCount = currentMesh.vertices.size();
+    VkDeviceSize positionStreamOffset = static_cast<VkDeviceSize>(currentMesh.vertexOffset) * GPUVertexFormat::positionStride;
 
-    VkBuffer stagingBuffer;
-    VmaAllocation vma_StagingBufferAllocation;
-    CreateBuffer_VMA(bufferSize, VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, stagingBuffer, vma_StagingBufferAllocation);
+    if (GPUVertexFormat::splitPositionStream) {
+        VkDeviceSize attributeStreamOffset = GeometryArena::attributeRegionOffset + static_cast<VkDeviceSize>(currentMesh.vertexOffset) * GPUVertexFormat::attributeStride;
 
-    //if (vmaCopyMemoryToAllocation(vma_Allocator, indices.data(), vma_StagingBufferAllocation, 0, bufferSize) != VK_SUCCESS) {
-    if (vmaCopyMemoryToAllocation(vma_Allocator, currentMesh.indices.data(), vma_StagingBufferAllocation, 0, bufferSize) != VK_SUCCESS) {
-        throw std::runtime_error("failed to copy vertex data to staging buffer!");
+        QueueBufferUpload(uploadBatch, encodedVertices->data(), vertexCount * GPUVertexFormat::positionStride, GeometryArena::vk_VertexBuffer, positionStreamOffset, false);
+        QueueBufferUpload(uploadBatch, encodedVertices->data() + currentMesh.attributeStreamOffset, vertexCount * GPUVertexFormat::attributeStride, GeometryArena::vk_VertexBuffer, attributeStreamOffset, false);
+    }
+    else {
+        QueueBufferUpload(uploadBatch, encodedVertices->data(), encodedVertices->size(), GeometryArena::vk_VertexBuffer, positionStreamOffset, false);
     }
 
-    CreateBuffer_VMA(bufferSize, 0, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, currentMesh.vk_IndexBuffer, currentMesh.vma_IndexBufferAllocation);
-
-    CopyBuffer(stagingBuffer, currentMesh.vk_IndexBuffer, bufferSize);
-    vmaDestroyBuffer(vma_Allocator, stagingBuffer, vma_StagingBufferAllocation);
+    uploadBatch.releaseSourceDataCallbacks.push_back([encodedVertices] { encodedVertices->clear(); });
+    currentMesh.uploadBatchID = GetUploadBatchID(uploadBatch);
 }
 
-void CreateModelUniformBuffers_VMA(Mesh& currentMesh) {
+void QueueMeshIndexUpload(Mesh& currentMesh, UploadBatch& uploadBatch) {
 
-    VkDeviceSize bufferSize = sizeof(ModelUniformBufferObject);
+    VkDeviceSize indexByteOffset = GetGeometryArenaIndexByteOffset(currentMesh);
 
-    currentMesh.vk_ModelUniformBuffers.resize(MAX_FRAMES_IN_FLIGHT);
-    currentMesh.vk_ModelUniformBuffersAllocations.resize(MAX_FRAMES_IN_FLIGHT);
+    if (currentMesh.vk_IndexType == VK_INDEX_TYPE_UINT16) {
 
-    for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
-        CreateBuffer_VMA(bufferSize, VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, currentMesh.vk_ModelUniformBuffers[i], currentMesh.vk_ModelUniformBuffersAllocations[i]);
+        // Kept alive by the callback until the batch has copied it into the staging buffer.
+        std::shared_ptr<std::vector<uint16_t>> packedIndices = std::make_shared<std::vector<uint16_t>>(currentMesh.indices.begin(), currentMesh.indices.end());
 
-        if (vmaCopyMemoryToAllocation(vma_Allocator, currentMesh.vk_ModelUniformBuffers.data(), currentMesh.vk_ModelUniformBuffersAllocations[i], 0, bufferSize) != VK_SUCCESS) {
-            throw std::runtime_error("failed to copy model buffer data to buffer!");
-        }
+        QueueBufferUpload(uploadBatch, packedIndices->data(), sizeof(uint16_t) * packedIndices->size(), GeometryArena::vk_IndexBuffer, indexByteOffset, false);
+        uploadBatch.releaseSourceDataCallbacks.push_back([packedIndices] { packedIndices->clear(); });
+        return;
     }
+
+    QueueBufferUpload(uploadBatch, currentMesh.indices.data(), sizeof(currentMesh.indices[0]) * currentMesh.indices.size(), GeometryArena::vk_IndexBuffer, indexByteOffset, false);
 }
 
 void CreateMaterialDescriptorSetsForMesh(Mesh& curMesh) {
@@ -217,7 +272,7 @@ void CreateMaterialDescriptorSetsForMesh(Mesh& curMesh) {
     if (curMaterial.descriptorSetIndex < 0) {
 
         curMaterial.descriptorSetIndex = static_cast<int>(vk_DescriptorSetsForEachFlightFrame.size());
-        vk_DescriptorSetsForEachFlightFrame.push_back(std::array<VkDescriptorSet, 2>());
+        vk_DescriptorSetsForEachFlightFrame.push_back(std::array<VkDescriptorSet, MAX_FRAMES_IN_FLIGHT>());
 
         std::vector<VkDescriptorSetLayout> layouts(MAX_FRAMES_IN_FLIGHT, Material::vk_DescriptorSetLayout);
         VkDescriptorSetAllocateInfo allocInfo{};
@@ -232,8 +287,9 @@ void CreateMaterialDescriptorSetsForMesh(Mesh& curMesh) {
 
         for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
 
+            // Every mesh using the material binds its own slice of the ring through the dynamic offset.
             VkDescriptorBufferInfo bufferInfo{};
-            bufferInfo.buffer = curMesh.vk_ModelUniformBuffers[i];
+            bufferInfo.buffer = ModelUniformRing::vk_Buffers[i];
             bufferInfo.offset = 0;
             bufferInfo.range = sizeof(ModelUniformBufferObject);
 
@@ -248,7 +304,7 @@ void CreateMaterialDescriptorSetsForMesh(Mesh& curMesh) {
             descriptorWrites[0].dstSet = vk_DescriptorSetsForEachFlightFrame[curMaterial.descriptorSetIndex][i];
             descriptorWrites[0].dstBinding = MODEL_UBO_BINDING_LOCATION;
             descriptorWrites[0].dstArrayElement = 0;
-            descriptorWrites[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+            descriptorWrites[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
             descriptorWrites[0].descriptorCount = 1;
             descriptorWrites[0].pBufferInfo = &bufferInfo;
 
@@ -269,108 +325,190 @@ void CreateMaterialDescriptorSetsForMesh(Mesh& curMesh) {
 
 void CreateTextureImageViewForTexture(Texture& curTexture) {
 
-    curTexture.vk_TextureImageView = CreateImageView(curTexture.vk_TextureImage, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_ASPECT_COLOR_BIT);
+    curTexture.vk_TextureImageView = CreateImageView(curTexture.vk_TextureImage, curTexture.vk_Format, VK_IMAGE_ASPECT_COLOR_BIT, curTexture.mipLevels);
 }
 
-void CreateTextureImageAndViewOnGPU() {
+void AllocateTextureImage(Texture& curTexture, uint32_t width, uint32_t height, VkImageUsageFlags usage) {
 
-    for (int i = 0; i < Texture::allLoadedTextures.size(); i++)
-    {
-        Texture& curTexture = Texture::allLoadedTextures[i];
+    CreateImage_VMA(width, height, curTexture.vk_Format, VK_IMAGE_TILING_OPTIMAL, usage, 0, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, curTexture.vk_TextureImage, curTexture.vma_TextureImageAllocation, curTexture.mipLevels);
 
-        if (curTexture.loaded == false) {
-            std::string curTexturePath = curTexture.texturePath;
+    std::cout << "Allocated Image Texture := " << curTexture.texturePath << std::endl;
 
-            int texWidth, texHeight, texChannels;
-            stbi_uc* pixels = stbi_load(curTexturePath.c_str(), &texWidth, &texHeight, &texChannels, STBI_rgb_alpha);
-            if (!pixels) {
-                throw std::runtime_error("failed to load texture image! path := " + curTexturePath);
-            }
+    std::string allocName = curTexture.texturePath + std::string(" = (Texture For Mesh Allocation)");
+    vmaSetAllocationName(vma_Allocator, curTexture.vma_TextureImageAllocation, allocName.c_str());
+}
 
-            uint64_t imageDataSize = texWidth * texHeight * 4;
+// Block compressed textures come with their whole mip chain, the levels are copied straight out of the mapped file.
+bool QueueKtx2TextureUpload(Texture& curTexture, UploadBatch& uploadBatch) {
 
-            VkBuffer stagingBuffer;
-            VmaAllocation vma_StagingBufferAllocation;
+    std::shared_ptr<Ktx2TextureData> textureData = std::make_shared<Ktx2TextureData>();
+    if (!LoadKtx2Texture(GetKtx2PathForTexture(curTexture.texturePath), *textureData)) {
+        return false;
+    }
 
-            CreateBuffer_VMA(imageDataSize, VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, stagingBuffer, vma_StagingBufferAllocation);
+    curTexture.vk_Format = textureData->format;
+    curTexture.mipLevels = textureData->mipLevels;
 
-            if (vmaCopyMemoryToAllocation(vma_Allocator, pixels, vma_StagingBufferAllocation, 0, imageDataSize) != VK_SUCCESS) {
-                throw std::runtime_error("failed to copy texture data to staging buffer!");
-            }
+    AllocateTextureImage(curTexture, textureData->width, textureData->height, VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT);
 
-            stbi_image_free(pixels);
+    QueueImageUpload(uploadBatch, textureData->levelData, textureData->levelDataSize, curTexture.vk_TextureImage, textureData->width, textureData->height, textureData->mipLevels, textureData->mipLevelDataOffsets, false);
+    uploadBatch.releaseSourceDataCallbacks.push_back([textureData] { ReleaseKtx2TextureData(*textureData); });
 
-            CreateImage_VMA(texWidth, texHeight, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, 0, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, curTexture.vk_TextureImage, curTexture.vma_TextureImageAllocation);
+    return true;
+}
 
-            std::cout << "Allocated Image Texture := " << curTexture.texturePath << std::endl;
+void QueueSourceImageTextureUpload(Texture& curTexture, UploadBatch& uploadBatch, bool generateMipmapsOnGPU) {
 
-            std::string allocName = curTexture.texturePath + std::string(" = (Texture For Mesh Allocation)");
-            vmaSetAllocationName(vma_Allocator, curTexture.vma_TextureImageAllocation, allocName.c_str());
+    std::string curTexturePath = curTexture.texturePath;
 
+    int texWidth, texHeight, texChannels;
+    stbi_uc* pixels = stbi_load(curTexturePath.c_str(), &texWidth, &texHeight, &texChannels, STBI_rgb_alpha);
+    if (!pixels) {
+        throw std::runtime_error("failed to load texture image! path := " + curTexturePath);
+    }
 
-            TransitionImageLayout(curTexture.vk_TextureImage, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
-            CopyBufferToImage(stagingBuffer, curTexture.vk_TextureImage, static_cast<uint32_t>(texWidth), static_cast<uint32_t>(texHeight));
-            TransitionImageLayout(curTexture.vk_TextureImage, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+    uint64_t imageDataSize = static_cast<uint64_t>(texWidth) * texHeight * 4;
+    curTexture.vk_Format = VK_FORMAT_R8G8B8A8_SRGB;
+    curTexture.mipLevels = GetMipLevelCount(static_cast<uint32_t>(texWidth), static_cast<uint32_t>(texHeight));
 
-            vmaDestroyBuffer(vma_Allocator, stagingBuffer, vma_StagingBufferAllocation);
+    // Blitting reads back from the image itself, so it also has to be a transfer source.
+    AllocateTextureImage(curTexture, static_cast<uint32_t>(texWidth), static_cast<uint32_t>(texHeight), VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT);
+
+    if (generateMipmapsOnGPU) {
+        QueueImageUpload(uploadBatch, pixels, imageDataSize, curTexture.vk_TextureImage, static_cast<uint32_t>(texWidth), static_cast<uint32_t>(texHeight), curTexture.mipLevels, { 0 }, true);
+        uploadBatch.releaseSourceDataCallbacks.push_back([pixels] { stbi_image_free(pixels); });
+    }
+    else {
+        std::shared_ptr<std::vector<uint8_t>> mipChain = std::make_shared<std::vector<uint8_t>>();
+        std::vector<VkDeviceSize> mipLevelDataOffsets;
+        GenerateRGBA8SRGBMipChainOnCPU(pixels, static_cast<uint32_t>(texWidth), static_cast<uint32_t>(texHeight), curTexture.mipLevels, *mipChain, mipLevelDataOffsets);
+        stbi_image_free(pixels);
+
+        QueueImageUpload(uploadBatch, mipChain->data(), mipChain->size(), curTexture.vk_TextureImage, static_cast<uint32_t>(texWidth), static_cast<uint32_t>(texHeight), curTexture.mipLevels, mipLevelDataOffsets, false);
+        uploadBatch.releaseSourceDataCallbacks.push_back([mipChain] { mipChain->clear(); });
+    }
+}
+
+void CreateTextureImageAndViewOnGPU(UploadBatch& uploadBatch) {
+
+    bool generateMipmapsOnGPU = SupportsLinearBlitForFormat(VK_FORMAT_R8G8B8A8_SRGB);
+
+    for (int i = 0; i < Texture::allLoadedTextures.size(); i++)
+    {
+        Texture& curTexture = Texture::allLoadedTextures[i];
+
+        if (curTexture.loaded == false) {
+
+            if (!PREFER_KTX2_TEXTURES || !QueueKtx2TextureUpload(curTexture, uploadBatch)) {
+                QueueSourceImageTextureUpload(curTexture, uploadBatch, generateMipmapsOnGPU);
+            }
+            curTexture.uploadBatchID = GetUploadBatchID(uploadBatch);
 
             CreateTextureImageViewForTexture(curTexture);
+            WriteBindlessTexture(static_cast<uint32_t>(i), curTexture.vk_TextureImageView);
             curTexture.loaded = true;
         }
     }
 }
 
-void UpdateModelUniformBuffer(Mesh& currentMesh, uint32_t indexOfDataForCurrentFrame) {
+void UpdateModelTransform(Model& currentModel) {
     static auto startTime = std::chrono::high_resolution_clock::now();
 
     auto currentTime = std::chrono::high_resolution_clock::now();
     float time = std::chrono::duration<float, std::chrono::seconds::period>(currentTime - startTime).count();
 
+    glm::mat4 modelToWorld = glm::mat4(1.0);
+    modelToWorld = glm::rotate(modelToWorld, glm::radians(90.0f), glm::vec3(1.0f, 0.0f, 0.0f));
+    modelToWorld = glm::rotate(modelToWorld, time * glm::radians(90.0f) * -1.0f, glm::vec3(0.0f, 1.0f, 0.0f));
+
+    currentModel.modelToWorld = modelToWorld;
+}
+
+// Only for meshes drawn from the CPU built render queue, GPU culled meshes get their transform from the draw culling instance buffer.
+void UpdateModelUniformBuffer(Mesh& currentMesh, const glm::mat4& modelToWorld, uint32_t indexOfDataForCurrentFrame) {
+
     ModelUniformBufferObject model_ubo{};
 
-    model_ubo.model = glm::mat4(1.0);
-    model_ubo.model = glm::rotate(model_ubo.model, glm::radians(90.0f), glm::vec3(1.0f, 0.0f, 0.0f));
-    model_ubo.model = glm::rotate(model_ubo.model, time * glm::radians(90.0f) * -1.0f, glm::vec3(0.0f, 1.0f, 0.0f));
+    UpdateMeshWorldBounds(currentMesh, modelToWorld);
 
-    vmaCopyMemoryToAllocation(vma_Allocator, &model_ubo, currentMesh.vk_ModelUniformBuffersAllocations[indexOfDataForCurrentFrame], 0, sizeof(model_ubo));
+    model_ubo.model = modelToWorld * GetPositionDequantizationMatrix(currentMesh);
+
+    currentMesh.modelMatrix = model_ubo.model;
+    currentMesh.modelUniformDynamicOffset = WriteToModelUniformRing(model_ubo, indexOfDataForCurrentFrame);
 }
 
 
+// Only touches _currentModel so it is safe to run for several models at once on worker threads.
+void LoadSingleModelMeshDataToCPU(Model& _currentModel) {
+
+    if (USE_MESH_CACHE && TryLoadModelDataFromMeshCache(_currentModel, ASSIMP_IMPORT_FLAGS, GetMeshOptimizationFlags())) {
+        _currentModel.loadedFromMeshCache = true;
+    }
+    else {
+        LoadModelDataWithAssimp(_currentModel);
+
+        if (USE_MESH_CACHE && !_currentModel.meshes.empty()) {
+            WriteMeshCacheForModel(_currentModel, ASSIMP_IMPORT_FLAGS, GetMeshOptimizationFlags());
+        }
+    }
+
+    for (Mesh& curMesh : _currentModel.meshes) {
+        curMesh.vk_IndexType = GetIndexTypeForVertexCount(curMesh.vertices.size());
+    }
+}
+
 void LoadSingleModelDataToCPU(Model& _currentModel) {
 
-    LoadModelDataWithAssimp(_currentModel);
+    LoadSingleModelMeshDataToCPU(_currentModel);
+    ResolveMaterialsForModel(_currentModel);
 }
 
 void LoadAllModelsDataToCPU(const std::vector<std::string>& allModelPaths, std::vector<Model>& allModels) {
 
+    size_t firstNewModelIndex = allModels.size();
+
     for (int i = 0; i < allModelPaths.size(); i++)
     {
         allModels.push_back(Model(allModelPaths[i]));
-        LoadSingleModelDataToCPU(allModels.back());
+    }
+
+    ParallelFor(static_cast<uint32_t>(allModelPaths.size()), [&](uint32_t i) {
+        LoadSingleModelMeshDataToCPU(allModels[firstNewModelIndex + i]);
+    });
+
+    // Merged in path order on this thread, so material and texture indices come out exactly as a serial load would give them.
+    for (size_t i = firstNewModelIndex; i < allModels.size(); i++)
+    {
+        if (allModels[i].loadedFromMeshCache) {
+            std::cout << "Loaded model from mesh cache := " << allModels[i].path << std::endl;
+        }
+
+        ResolveMaterialsForModel(allModels[i]);
     }
 }
 
-void UploadSingleModelToGPU(Model& _currentModel) {
+void UploadSingleModelToGPU(Model& _currentModel, UploadBatch& uploadBatch) {
 
     for (int i = 0; i < _currentModel.meshes.size(); i++)
     {
-        CreateVertexBuffer_VMA(_currentModel.meshes[i]);
-        CreateIndexBuffer_VMA(_currentModel.meshes[i]);
+        std::string meshName = _currentModel.path + " mesh " + std::to_string(i);
 
-        //TODO : Need to create separate buffers for each object or somehow increase the sizee of one and index into it in the shader or something.
-        CreateModelUniformBuffers_VMA(_currentModel.meshes[i]);
+        AllocateGeometryArenaRanges(_currentModel.meshes[i], meshName);
+        QueueMeshVertexUpload(_currentModel.meshes[i], meshName, uploadBatch);
+        QueueMeshIndexUpload(_currentModel.meshes[i], uploadBatch);
 
         CreateMaterialDescriptorSetsForMesh(_currentModel.meshes[i]);
     }
 }
 
-void UploadAllModelsAndMaterialDataToGPU(std::vector<Model>& allModels) {
+// Only creates the GPU resources and queues their data, nothing is on the GPU until the batch is submitted.
+void UploadAllModelsAndMaterialDataToGPU(std::vector<Model>& allModels, UploadBatch& uploadBatch) {
 
-    CreateTextureImageAndViewOnGPU();
+    CreateTextureImageAndViewOnGPU(uploadBatch);
 
     for (int i = 0; i < allModels.size(); i++)
     {
-        UploadSingleModelToGPU(allModels[i]);
+        UploadSingleModelToGPU(allModels[i], uploadBatch);
     }
 }
 
@@ -380,12 +518,6 @@ void CleanUpModelData(Model& currentModel) {
     {
         Mesh& curMesh = currentModel.meshes[i];
 
-        vmaDestroyBuffer(vma_Allocator, curMesh.vk_VertexBuffer, curMesh.vma_VertexBufferAllocation);
-        vmaDestroyBuffer(vma_Allocator, curMesh.vk_IndexBuffer, curMesh.vma_IndexBufferAllocation);
-
-        for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
-            vmaDestroyBuffer(vma_Allocator, curMesh.vk_ModelUniformBuffers[i], curMesh.vk_ModelUniformBuffersAllocations[i]);
-        }
-
+        FreeGeometryArenaRanges(curMesh);
     }
 }
\ No newline at end of file
@@ -0,0 +1,62 @@
+#pragma once
+
+#include "DependencyIncludes.h"
+#include "StandardIncludes.h"
+
+#include "EngineConstants.h"
+
+const uint32_t OCCLUSION_CULLING_PHASE_EARLY = 0;
+const uint32_t OCCLUSION_CULLING_PHASE_LATE = 1;
+
+// Push constants of the Hi-Z build, one dispatch per mip reading the level above (the depth buffer for mip 0).
+struct HiZPushConstantData {
+	glm::uvec2 inputSize;
+	glm::uvec2 outputSize;
+};
+
+// Push constants of the occlusion culling shader, frustum planes as in DrawCullingPushConstantData. Late phase survivors land
+// lateOutputOffset draws after the early ones in the culled buffers, along with their counts.
+struct OcclusionCullingPushConstantData {
+	glm::vec4 frustumPlanes[6];
+	uint32_t instanceCount;
+	uint32_t occlusionPhase;
+	uint32_t lateOutputOffset;
+};
+
+// Two phase occlusion culling of the GPU culled scene instances. The early phase draws what was visible last frame, the Hi-Z pyramid
+// (max depth per texel, down to 1x1) is built from that depth, and the late phase tests every instance in the frustum against it.
+// Instances that pass and were not drawn early are drawn in a second render pass, and the test result lands in DrawCulling's
+// visibility buffer for next frame.
+struct OcclusionCulling {
+
+public:
+
+	inline static VkImage vk_HiZImage = VK_NULL_HANDLE;
+	inline static VmaAllocation vma_HiZImageAllocation = VK_NULL_HANDLE;
+	inline static VkImageView vk_HiZImageView = VK_NULL_HANDLE;
+	inline static std::vector<VkImageView> vk_HiZMipImageViews = {};
+	inline static VkExtent2D hiZExtent = {};
+	inline static uint32_t hiZMipLevels = 0;
+	inline static VkSampler vk_HiZSampler = VK_NULL_HANDLE;
+
+	// Every set below points at the pyramid or the depth buffer, so they all come from this pool. A new pool comes with every swap chain
+	// and the old one is retired with the old pyramid.
+	inline static VkDescriptorPool vk_DescriptorPool = VK_NULL_HANDLE;
+
+	inline static VkDescriptorSetLayout vk_HiZBuildDescriptorSetLayout = VK_NULL_HANDLE;
+	inline static std::vector<VkDescriptorSet> vk_HiZBuildDescriptorSets = {};
+	inline static VkPipelineLayout vk_HiZBuildPipelineLayout = VK_NULL_HANDLE;
+	inline static VkPipeline vk_HiZBuildPipeline = VK_NULL_HANDLE;
+
+	inline static VkDescriptorSetLayout vk_OcclusionDescriptorSetLayout = VK_NULL_HANDLE;
+	inline static VkDescriptorSet vk_OcclusionDescriptorSet = VK_NULL_HANDLE;
+
+	inline static VkPipelineLayout vk_CullPipelineLayout = VK_NULL_HANDLE;
+	inline static VkPipeline vk_CullPipeline = VK_NULL_HANDLE;
+
+	// Compatible with vk_RenderPass, the early pass keeps its attachments for the late one which loads them and presents. Not created
+	// with dynamic rendering.
+	inline static VkRenderPass vk_EarlyRenderPass = VK_NULL_HANDLE;
+	inline static VkRenderPass vk_LateRenderPass = VK_NULL_HANDLE;
+
+};
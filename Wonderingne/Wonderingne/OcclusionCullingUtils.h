@@ -0,0 +1,508 @@
+#pragma once
+
+#include "OcclusionCulling.h"
+#include "DrawCulling.h"
+#include "Camera.h"
+
+#include "VulkanCreateUtils.h"
+#include "VulkanSwapChianUtils.h"
+#include "DrawCullingUtils.h"
+#include "MipmapUtils.h"
+#include "PipelineCacheUtils.h"
+
+#include <filesystem>
+
+// Only true when everything both phases need is there, GPU culled draws are frustum culled only otherwise.
+bool IsOcclusionCullingActive() {
+    return OcclusionCulling::vk_CullPipeline != VK_NULL_HANDLE;
+}
+
+void CreateDescriptorSetLayoutsForOcclusionCulling() {
+
+    // Input, the depth buffer or the mip above. Output, the mip being built.
+    std::array<VkDescriptorSetLayoutBinding, 2> hiZBuildBindings = {};
+    hiZBuildBindings[0].binding = 0;
+    hiZBuildBindings[0].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    hiZBuildBindings[0].descriptorCount = 1;
+    hiZBuildBindings[0].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    hiZBuildBindings[1].binding = 1;
+    hiZBuildBindings[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+    hiZBuildBindings[1].descriptorCount = 1;
+    hiZBuildBindings[1].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+
+    VkDescriptorSetLayoutCreateInfo layoutInfo{};
+    layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    layoutInfo.bindingCount = static_cast<uint32_t>(hiZBuildBindings.size());
+    layoutInfo.pBindings = hiZBuildBindings.data();
+
+    if (vkCreateDescriptorSetLayout(vk_LogicalDevice, &layoutInfo, nullptr, &OcclusionCulling::vk_HiZBuildDescriptorSetLayout) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create Hi-Z build descriptor set layout!");
+    }
+
+    // The whole pyramid, the visibility buffer is in the draw culling set.
+    std::array<VkDescriptorSetLayoutBinding, 1> occlusionBindings = {};
+    occlusionBindings[0].binding = 0;
+    occlusionBindings[0].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    occlusionBindings[0].descriptorCount = 1;
+    occlusionBindings[0].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+
+    layoutInfo.bindingCount = static_cast<uint32_t>(occlusionBindings.size());
+    layoutInfo.pBindings = occlusionBindings.data();
+
+    if (vkCreateDescriptorSetLayout(vk_LogicalDevice, &layoutInfo, nullptr, &OcclusionCulling::vk_OcclusionDescriptorSetLayout) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create occlusion culling descriptor set layout!");
+    }
+}
+
+void CreateOcclusionCullingDescriptorPool() {
+
+    // A set per mip of the largest pyramid an image can have, plus the occlusion set.
+    uint32_t maxSets = 32 + 1;
+
+    std::array<VkDescriptorPoolSize, 2> poolSizes{};
+    poolSizes[0].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    poolSizes[0].descriptorCount = maxSets;
+    poolSizes[1].type = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+    poolSizes[1].descriptorCount = maxSets;
+
+    VkDescriptorPoolCreateInfo poolInfo{};
+    poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    poolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
+    poolInfo.pPoolSizes = poolSizes.data();
+    poolInfo.maxSets = maxSets;
+
+    if (vkCreateDescriptorPool(vk_LogicalDevice, &poolInfo, nullptr, &OcclusionCulling::vk_DescriptorPool) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create occlusion culling descriptor pool!");
+    }
+}
+
+void CreateHiZSampler() {
+
+    // Both shaders only texelFetch, the sampler is just what a combined image sampler needs.
+    VkSamplerCreateInfo samplerInfo{};
+    samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+    samplerInfo.magFilter = VK_FILTER_NEAREST;
+    samplerInfo.minFilter = VK_FILTER_NEAREST;
+    samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+    samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    samplerInfo.minLod = 0.0f;
+    samplerInfo.maxLod = VK_LOD_CLAMP_NONE;
+
+    if (vkCreateSampler(vk_LogicalDevice, &samplerInfo, nullptr, &OcclusionCulling::vk_HiZSampler) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create Hi-Z sampler!");
+    }
+}
+
+VkPipeline CreateOcclusionComputePipeline(const std::string& shaderPath, VkPipelineLayout pipelineLayout) {
+
+    VkShaderModule computeShaderModule = CreateShaderModule(shaderPath);
+
+    VkComputePipelineCreateInfo pipelineInfo{};
+    pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+    pipelineInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    pipelineInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+    pipelineInfo.stage.module = computeShaderModule;
+    pipelineInfo.stage.pName = "main";
+    pipelineInfo.layout = pipelineLayout;
+
+    VkPipeline pipeline;
+    if (vkCreateComputePipelines(vk_LogicalDevice, PipelineCache::vk_PipelineCache, 1, &pipelineInfo, nullptr, &pipeline) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create occlusion culling compute pipeline!");
+    }
+
+    vkDestroyShaderModule(vk_LogicalDevice, computeShaderModule, nullptr);
+
+    return pipeline;
+}
+
+void CreateOcclusionCullingPipelines() {
+
+    VkPushConstantRange pushConstantRange = {};
+    pushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    pushConstantRange.offset = 0;
+    pushConstantRange.size = sizeof(HiZPushConstantData);
+
+    VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+    pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    pipelineLayoutInfo.setLayoutCount = 1;
+    pipelineLayoutInfo.pSetLayouts = &OcclusionCulling::vk_HiZBuildDescriptorSetLayout;
+    pipelineLayoutInfo.pushConstantRangeCount = 1;
+    pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+
+    if (vkCreatePipelineLayout(vk_LogicalDevice, &pipelineLayoutInfo, nullptr, &OcclusionCulling::vk_HiZBuildPipelineLayout) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create Hi-Z build pipeline layout!");
+    }
+
+    OcclusionCulling::vk_HiZBuildPipeline = CreateOcclusionComputePipeline(HI_Z_BUILD_COMPUTE_SHADER_FILE_PATH, OcclusionCulling::vk_HiZBuildPipelineLayout);
+
+    // The draw culling buffers and visibility, the pyramid, and the camera for projecting the bounds.
+    std::array<VkDescriptorSetLayout, 3> cullSetLayouts = { DrawCulling::vk_CullDescriptorSetLayout, OcclusionCulling::vk_OcclusionDescriptorSetLayout, Camera::vk_CameraUBODescriptorSetLayout };
+
+    pushConstantRange.size = sizeof(OcclusionCullingPushConstantData);
+    pipelineLayoutInfo.setLayoutCount = static_cast<uint32_t>(cullSetLayouts.size());
+    pipelineLayoutInfo.pSetLayouts = cullSetLayouts.data();
+
+    if (vkCreatePipelineLayout(vk_LogicalDevice, &pipelineLayoutInfo, nullptr, &OcclusionCulling::vk_CullPipelineLayout) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create occlusion culling pipeline layout!");
+    }
+
+    OcclusionCulling::vk_CullPipeline = CreateOcclusionComputePipeline(OCCLUSION_CULLING_COMPUTE_SHADER_FILE_PATH, OcclusionCulling::vk_CullPipelineLayout);
+}
+
+// Sized like the swap chain, so it is created with it and again after every RecreateSwapChain.
+void CreateHiZResources() {
+
+    if (!IsOcclusionCullingActive()) {
+        return;
+    }
+
+    CreateOcclusionCullingDescriptorPool();
+
+    OcclusionCulling::hiZExtent = vk_SwapChainExtent;
+    OcclusionCulling::hiZMipLevels = GetMipLevelCount(vk_SwapChainExtent.width, vk_SwapChainExtent.height);
+
+    CreateImage_VMA(vk_SwapChainExtent.width, vk_SwapChainExtent.height, VK_FORMAT_R32_SFLOAT, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, 0, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, OcclusionCulling::vk_HiZImage, OcclusionCulling::vma_HiZImageAllocation, OcclusionCulling::hiZMipLevels);
+    vmaSetAllocationName(vma_Allocator, OcclusionCulling::vma_HiZImageAllocation, "Hi-Z Pyramid");
+
+    OcclusionCulling::vk_HiZImageView = CreateImageView(OcclusionCulling::vk_HiZImage, VK_FORMAT_R32_SFLOAT, VK_IMAGE_ASPECT_COLOR_BIT, OcclusionCulling::hiZMipLevels);
+
+    OcclusionCulling::vk_HiZMipImageViews.resize(OcclusionCulling::hiZMipLevels);
+    for (uint32_t mip = 0; mip < OcclusionCulling::hiZMipLevels; mip++)
+    {
+        VkImageViewCreateInfo viewInfo{};
+        viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+        viewInfo.image = OcclusionCulling::vk_HiZImage;
+        viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+        viewInfo.format = VK_FORMAT_R32_SFLOAT;
+        viewInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        viewInfo.subresourceRange.baseMipLevel = mip;
+        viewInfo.subresourceRange.levelCount = 1;
+        viewInfo.subresourceRange.baseArrayLayer = 0;
+        viewInfo.subresourceRange.layerCount = 1;
+
+        if (vkCreateImageView(vk_LogicalDevice, &viewInfo, nullptr, &OcclusionCulling::vk_HiZMipImageViews[mip]) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create Hi-Z mip image view!");
+        }
+    }
+
+    OcclusionCulling::vk_HiZBuildDescriptorSets.resize(OcclusionCulling::hiZMipLevels);
+    std::vector<VkDescriptorSetLayout> hiZBuildLayouts(OcclusionCulling::hiZMipLevels, OcclusionCulling::vk_HiZBuildDescriptorSetLayout);
+
+    VkDescriptorSetAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    allocInfo.descriptorPool = OcclusionCulling::vk_DescriptorPool;
+    allocInfo.descriptorSetCount = OcclusionCulling::hiZMipLevels;
+    allocInfo.pSetLayouts = hiZBuildLayouts.data();
+
+    if (vkAllocateDescriptorSets(vk_LogicalDevice, &allocInfo, OcclusionCulling::vk_HiZBuildDescriptorSets.data()) != VK_SUCCESS) {
+        throw std::runtime_error("failed to allocate Hi-Z build descriptor sets!");
+    }
+
+    allocInfo.descriptorSetCount = 1;
+    allocInfo.pSetLayouts = &OcclusionCulling::vk_OcclusionDescriptorSetLayout;
+
+    if (vkAllocateDescriptorSets(vk_LogicalDevice, &allocInfo, &OcclusionCulling::vk_OcclusionDescriptorSet) != VK_SUCCESS) {
+        throw std::runtime_error("failed to allocate occlusion culling descriptor set!");
+    }
+
+    for (uint32_t mip = 0; mip < OcclusionCulling::hiZMipLevels; mip++)
+    {
+        VkDescriptorImageInfo inputImageInfo{};
+        inputImageInfo.sampler = OcclusionCulling::vk_HiZSampler;
+        inputImageInfo.imageView = mip == 0 ? vk_DepthImageView : OcclusionCulling::vk_HiZMipImageViews[mip - 1];
+        inputImageInfo.imageLayout = mip == 0 ? VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL : VK_IMAGE_LAYOUT_GENERAL;
+
+        VkDescriptorImageInfo outputImageInfo{};
+        outputImageInfo.imageView = OcclusionCulling::vk_HiZMipImageViews[mip];
+        outputImageInfo.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+
+        std::array<VkWriteDescriptorSet, 2> descriptorWrites{};
+        descriptorWrites[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        descriptorWrites[0].dstSet = OcclusionCulling::vk_HiZBuildDescriptorSets[mip];
+        descriptorWrites[0].dstBinding = 0;
+        descriptorWrites[0].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+        descriptorWrites[0].descriptorCount = 1;
+        descriptorWrites[0].pImageInfo = &inputImageInfo;
+
+        descriptorWrites[1].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        descriptorWrites[1].dstSet = OcclusionCulling::vk_HiZBuildDescriptorSets[mip];
+        descriptorWrites[1].dstBinding = 1;
+        descriptorWrites[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+        descriptorWrites[1].descriptorCount = 1;
+        descriptorWrites[1].pImageInfo = &outputImageInfo;
+
+        vkUpdateDescriptorSets(vk_LogicalDevice, static_cast<uint32_t>(descriptorWrites.size()), descriptorWrites.data(), 0, nullptr);
+    }
+
+    VkDescriptorImageInfo hiZImageInfo{};
+    hiZImageInfo.sampler = OcclusionCulling::vk_HiZSampler;
+    hiZImageInfo.imageView = OcclusionCulling::vk_HiZImageView;
+    hiZImageInfo.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+
+    VkWriteDescriptorSet descriptorWrite{};
+    descriptorWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    descriptorWrite.dstSet = OcclusionCulling::vk_OcclusionDescriptorSet;
+    descriptorWrite.dstBinding = 0;
+    descriptorWrite.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    descriptorWrite.descriptorCount = 1;
+    descriptorWrite.pImageInfo = &hiZImageInfo;
+
+    vkUpdateDescriptorSets(vk_LogicalDevice, 1, &descriptorWrite, 0, nullptr);
+}
+
+// The device has to be idle, use RetireHiZResources while frames are in flight.
+void DestroyHiZResources() {
+
+    if (!IsOcclusionCullingActive()) {
+        return;
+    }
+
+    vkDestroyDescriptorPool(vk_LogicalDevice, OcclusionCulling::vk_DescriptorPool, nullptr);
+    OcclusionCulling::vk_DescriptorPool = VK_NULL_HANDLE;
+    OcclusionCulling::vk_HiZBuildDescriptorSets.clear();
+    OcclusionCulling::vk_OcclusionDescriptorSet = VK_NULL_HANDLE;
+
+    for (VkImageView mipImageView : OcclusionCulling::vk_HiZMipImageViews) {
+        vkDestroyImageView(vk_LogicalDevice, mipImageView, nullptr);
+    }
+    OcclusionCulling::vk_HiZMipImageViews.clear();
+
+    vkDestroyImageView(vk_LogicalDevice, OcclusionCulling::vk_HiZImageView, nullptr);
+    vmaDestroyImage(vma_Allocator, OcclusionCulling::vk_HiZImage, OcclusionCulling::vma_HiZImageAllocation);
+}
+
+// Frames in flight may still build or read the old pyramid, so it is destroyed along with the sets pointing at it, and at the old
+// depth buffer, once they are done.
+void RetireHiZResources() {
+
+    if (!IsOcclusionCullingActive()) {
+        return;
+    }
+
+    VkDescriptorPool descriptorPool = OcclusionCulling::vk_DescriptorPool;
+    std::vector<VkImageView> hiZMipImageViews = OcclusionCulling::vk_HiZMipImageViews;
+    VkImageView hiZImageView = OcclusionCulling::vk_HiZImageView;
+    VkImage hiZImage = OcclusionCulling::vk_HiZImage;
+    VmaAllocation hiZImageAllocation = OcclusionCulling::vma_HiZImageAllocation;
+
+    DeferDeletion([=]() {
+
+        vkDestroyDescriptorPool(vk_LogicalDevice, descriptorPool, nullptr);
+
+        for (VkImageView mipImageView : hiZMipImageViews) {
+            vkDestroyImageView(vk_LogicalDevice, mipImageView, nullptr);
+        }
+
+        vkDestroyImageView(vk_LogicalDevice, hiZImageView, nullptr);
+        vmaDestroyImage(vma_Allocator, hiZImage, hiZImageAllocation);
+    });
+
+    OcclusionCulling::vk_DescriptorPool = VK_NULL_HANDLE;
+    OcclusionCulling::vk_HiZBuildDescriptorSets.clear();
+    OcclusionCulling::vk_OcclusionDescriptorSet = VK_NULL_HANDLE;
+    OcclusionCulling::vk_HiZMipImageViews.clear();
+}
+
+void RecreateHiZResources() {
+    RetireHiZResources();
+    CreateHiZResources();
+}
+
+// Needs the draw culling, the camera set layout and the depth buffer. Leaves occlusion culling off when the device or the shaders are missing.
+void CreateOcclusionCulling() {
+
+    if (!USE_OCCLUSION_CULLING || !IsGPUDrawCullingActive()) {
+        return;
+    }
+
+    if (!IsDepthFormatSampleable(FindDepthFormat())) {
+        std::cout << "Depth format can not be sampled, occlusion culling is disabled." << std::endl;
+        return;
+    }
+
+    if (!std::filesystem::exists(HI_Z_BUILD_COMPUTE_SHADER_FILE_PATH) || !std::filesystem::exists(OCCLUSION_CULLING_COMPUTE_SHADER_FILE_PATH)) {
+        std::cout << "Occlusion culling shaders not found, occlusion culling is disabled := " << OCCLUSION_CULLING_COMPUTE_SHADER_FILE_PATH << std::endl;
+        return;
+    }
+
+    CreateDescriptorSetLayoutsForOcclusionCulling();
+    CreateHiZSampler();
+    CreateOcclusionCullingPipelines();
+
+    // Dynamic rendering gets the same load and store ops from BeginFrameRendering.
+    if (!IsDynamicRenderingActive()) {
+        OcclusionCulling::vk_EarlyRenderPass = CreateColorDepthRenderPass(VK_ATTACHMENT_LOAD_OP_CLEAR, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, VK_ATTACHMENT_STORE_OP_STORE);
+        OcclusionCulling::vk_LateRenderPass = CreateColorDepthRenderPass(VK_ATTACHMENT_LOAD_OP_LOAD, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR, VK_ATTACHMENT_STORE_OP_DONT_CARE);
+    }
+
+    CreateHiZResources();
+}
+
+void DestroyOcclusionCulling() {
+
+    if (!IsOcclusionCullingActive()) {
+        return;
+    }
+
+    DestroyHiZResources();
+
+    vkDestroyRenderPass(vk_LogicalDevice, OcclusionCulling::vk_EarlyRenderPass, nullptr);
+    vkDestroyRenderPass(vk_LogicalDevice, OcclusionCulling::vk_LateRenderPass, nullptr);
+
+    vkDestroyPipeline(vk_LogicalDevice, OcclusionCulling::vk_CullPipeline, nullptr);
+    vkDestroyPipelineLayout(vk_LogicalDevice, OcclusionCulling::vk_CullPipelineLayout, nullptr);
+    vkDestroyPipeline(vk_LogicalDevice, OcclusionCulling::vk_HiZBuildPipeline, nullptr);
+    vkDestroyPipelineLayout(vk_LogicalDevice, OcclusionCulling::vk_HiZBuildPipelineLayout, nullptr);
+
+    vkDestroySampler(vk_LogicalDevice, OcclusionCulling::vk_HiZSampler, nullptr);
+    vkDestroyDescriptorSetLayout(vk_LogicalDevice, OcclusionCulling::vk_OcclusionDescriptorSetLayout, nullptr);
+    vkDestroyDescriptorSetLayout(vk_LogicalDevice, OcclusionCulling::vk_HiZBuildDescriptorSetLayout, nullptr);
+
+    OcclusionCulling::vk_CullPipeline = VK_NULL_HANDLE;
+}
+
+// Recorded outside the render passes, after PrepareDrawCullingFrame. The early phase clears the counts of every batch in both phases
+// and draws what was visible last frame, the late phase draws what the pyramid shows is visible now and was not drawn early, and
+// records that visibility for next frame.
+void RecordOcclusionCullingPass(VkCommandBuffer commandBuffer, const Frustum& frustum, int cameraIndex, uint32_t occlusionPhase) {
+
+    uint32_t batchedInstanceCount = static_cast<uint32_t>(DrawCulling::instances.size());
+    if (batchedInstanceCount == 0) {
+        return;
+    }
+
+    uint32_t lateDrawOffset = GetDrawCullingLateDrawOffset();
+
+    if (occlusionPhase == OCCLUSION_CULLING_PHASE_EARLY) {
+        VkBuffer drawCountBuffer = DrawCulling::vk_DrawCountBuffers[indexOfDataForCurrentFrame];
+        vkCmdFillBuffer(commandBuffer, drawCountBuffer, 0, batchedInstanceCount * sizeof(uint32_t), 0);
+        vkCmdFillBuffer(commandBuffer, drawCountBuffer, lateDrawOffset * sizeof(uint32_t), batchedInstanceCount * sizeof(uint32_t), 0);
+
+        // Also orders the read of the visibility against the late phase of the previous frame, and the instance uploads before it.
+        VkMemoryBarrier clearBarrier{};
+        clearBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+        clearBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+        clearBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_INDIRECT_COMMAND_READ_BIT;
+
+        vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT, 0, 1, &clearBarrier, 0, nullptr, 0, nullptr);
+    }
+
+    if (DrawCulling::uploadedInstanceCount == 0) {
+        return;
+    }
+
+    OcclusionCullingPushConstantData pushConstantData = {};
+    std::copy(std::begin(frustum.planes), std::end(frustum.planes), pushConstantData.frustumPlanes);
+    pushConstantData.instanceCount = DrawCulling::uploadedInstanceCount;
+    pushConstantData.occlusionPhase = occlusionPhase;
+    pushConstantData.lateOutputOffset = lateDrawOffset;
+
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, OcclusionCulling::vk_CullPipeline);
+
+    std::array<VkDescriptorSet, 3> descriptorSets = {
+        vk_DescriptorSetsForEachFlightFrame[DrawCulling::cullDescriptorSetIndex][indexOfDataForCurrentFrame],
+        OcclusionCulling::vk_OcclusionDescriptorSet,
+        vk_DescriptorSetsForEachFlightFrame[Camera::allCameraUBODescriptorSetIndices[cameraIndex]][indexOfDataForCurrentFrame]
+    };
+    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, OcclusionCulling::vk_CullPipelineLayout, 0, static_cast<uint32_t>(descriptorSets.size()), descriptorSets.data(), 0, nullptr);
+    vkCmdPushConstants(commandBuffer, OcclusionCulling::vk_CullPipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(OcclusionCullingPushConstantData), &pushConstantData);
+
+    vkCmdDispatch(commandBuffer, (pushConstantData.instanceCount + DRAW_CULLING_WORKGROUP_SIZE - 1) / DRAW_CULLING_WORKGROUP_SIZE, 1, 1);
+
+    VkMemoryBarrier cullBarrier{};
+    cullBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    cullBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+    cullBarrier.dstAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_SHADER_READ_BIT;
+
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &cullBarrier, 0, nullptr, 0, nullptr);
+}
+
+// Recorded between the early and the late render pass. Reduces the depth of the early draws into the pyramid, one dispatch per mip,
+// and hands the depth and color attachments back to the late pass.
+void RecordHiZBuild(VkCommandBuffer commandBuffer) {
+
+    VkImageAspectFlags depthAspectMask = VK_IMAGE_ASPECT_DEPTH_BIT;
+    if (HasStencilComponent(FindDepthFormat())) {
+        depthAspectMask |= VK_IMAGE_ASPECT_STENCIL_BIT;
+    }
+
+    VkImageMemoryBarrier depthBarrier{};
+    depthBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    depthBarrier.srcAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+    depthBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+    depthBarrier.oldLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+    depthBarrier.newLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL;
+    depthBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    depthBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    depthBarrier.image = vk_DepthImage;
+    depthBarrier.subresourceRange.aspectMask = depthAspectMask;
+    depthBarrier.subresourceRange.baseMipLevel = 0;
+    depthBarrier.subresourceRange.levelCount = 1;
+    depthBarrier.subresourceRange.baseArrayLayer = 0;
+    depthBarrier.subresourceRange.layerCount = 1;
+
+    // The pyramid is rebuilt from scratch every frame and lives in GENERAL, written as a storage image and read through the sampler
+    // by the next dispatch. Waits for last frame's late phase, which may still be reading it.
+    VkImageMemoryBarrier hiZBarrier{};
+    hiZBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    hiZBarrier.srcAccessMask = 0;
+    hiZBarrier.dstAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+    hiZBarrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    hiZBarrier.newLayout = VK_IMAGE_LAYOUT_GENERAL;
+    hiZBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    hiZBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    hiZBarrier.image = OcclusionCulling::vk_HiZImage;
+    hiZBarrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    hiZBarrier.subresourceRange.baseMipLevel = 0;
+    hiZBarrier.subresourceRange.levelCount = OcclusionCulling::hiZMipLevels;
+    hiZBarrier.subresourceRange.baseArrayLayer = 0;
+    hiZBarrier.subresourceRange.layerCount = 1;
+
+    std::array<VkImageMemoryBarrier, 2> buildBarriers = { depthBarrier, hiZBarrier };
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 0, nullptr, 0, nullptr, static_cast<uint32_t>(buildBarriers.size()), buildBarriers.data());
+
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, OcclusionCulling::vk_HiZBuildPipeline);
+
+    VkExtent2D inputExtent = OcclusionCulling::hiZExtent;
+
+    for (uint32_t mip = 0; mip < OcclusionCulling::hiZMipLevels; mip++)
+    {
+        VkExtent2D outputExtent = { std::max(OcclusionCulling::hiZExtent.width >> mip, 1u), std::max(OcclusionCulling::hiZExtent.height >> mip, 1u) };
+
+        HiZPushConstantData pushConstantData = {};
+        pushConstantData.inputSize = glm::uvec2(inputExtent.width, inputExtent.height);
+        pushConstantData.outputSize = glm::uvec2(outputExtent.width, outputExtent.height);
+
+        vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, OcclusionCulling::vk_HiZBuildPipelineLayout, 0, 1, &OcclusionCulling::vk_HiZBuildDescriptorSets[mip], 0, nullptr);
+        vkCmdPushConstants(commandBuffer, OcclusionCulling::vk_HiZBuildPipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(HiZPushConstantData), &pushConstantData);
+
+        vkCmdDispatch(commandBuffer, (outputExtent.width + HI_Z_WORKGROUP_SIZE - 1) / HI_Z_WORKGROUP_SIZE, (outputExtent.height + HI_Z_WORKGROUP_SIZE - 1) / HI_Z_WORKGROUP_SIZE, 1);
+
+        // The next mip reads this one, and the late culling reads them all.
+        VkMemoryBarrier mipBarrier{};
+        mipBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+        mipBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+        mipBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+
+        vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &mipBarrier, 0, nullptr, 0, nullptr);
+
+        inputExtent = outputExtent;
+    }
+
+    depthBarrier.srcAccessMask = VK_ACCESS_SHADER_READ_BIT;
+    depthBarrier.dstAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+    depthBarrier.oldLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL;
+    depthBarrier.newLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT, 0, 0, nullptr, 0, nullptr, 1, &depthBarrier);
+
+    // The late pass loads what the early pass stored, its own external dependency does not wait for those writes.
+    VkMemoryBarrier colorBarrier{};
+    colorBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    colorBarrier.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+    colorBarrier.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, 0, 1, &colorBarrier, 0, nullptr, 0, nullptr);
+}
@@ -0,0 +1,19 @@
+#pragma once
+
+#include "DependencyIncludes.h"
+#include "StandardIncludes.h"
+
+#include "EngineConstants.h"
+
+// One VkPipelineCache shared by every pipeline creation, loaded from PIPELINE_CACHE_FILE_PATH at startup and written back once new
+// pipelines were added to it. The blob starts with a VkPipelineCacheHeaderVersionOne, a cache from another GPU or driver is dropped.
+struct PipelineCache {
+
+public:
+
+	inline static VkPipelineCache vk_PipelineCache = VK_NULL_HANDLE;
+
+	// Size of the data last loaded or written, the cache only grows so a bigger size means there is something new to save.
+	inline static size_t savedDataSize = 0;
+
+};
@@ -0,0 +1,128 @@
+#pragma once
+
+#include "PipelineCache.h"
+
+#include "FileMappingUtils.h"
+#include "VulkanEngineVariables.h"
+
+#include <filesystem>
+
+// The driver rejects or silently ignores foreign data, checking the header first makes a stale cache show up in the log.
+bool IsPipelineCacheDataValid(const uint8_t* data, uint64_t size) {
+
+    VkPipelineCacheHeaderVersionOne header;
+    if (size < sizeof(header)) {
+        return false;
+    }
+    memcpy(&header, data, sizeof(header));
+
+    VkPhysicalDeviceProperties deviceProperties;
+    vkGetPhysicalDeviceProperties(vk_PhysicalDevice, &deviceProperties);
+
+    return header.headerSize >= sizeof(header)
+        && header.headerSize <= size
+        && header.headerVersion == VK_PIPELINE_CACHE_HEADER_VERSION_ONE
+        && header.vendorID == deviceProperties.vendorID
+        && header.deviceID == deviceProperties.deviceID
+        && memcmp(header.pipelineCacheUUID, deviceProperties.pipelineCacheUUID, VK_UUID_SIZE) == 0;
+}
+
+// Has to run before the first pipeline is created. Starts with an empty cache when there is no usable file.
+void CreatePipelineCache() {
+
+    if (!USE_PIPELINE_CACHE) {
+        return;
+    }
+
+    MappedFile cacheFile;
+    bool hasCacheFile = MapFileForReading(PIPELINE_CACHE_FILE_PATH, cacheFile);
+
+    if (hasCacheFile && !IsPipelineCacheDataValid(cacheFile.data, cacheFile.size)) {
+        std::cout << "Pipeline cache was written by another device or driver, rebuilding := " << PIPELINE_CACHE_FILE_PATH << std::endl;
+        UnmapFile(cacheFile);
+        hasCacheFile = false;
+    }
+
+    VkPipelineCacheCreateInfo cacheInfo{};
+    cacheInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+    cacheInfo.initialDataSize = hasCacheFile ? static_cast<size_t>(cacheFile.size) : 0;
+    cacheInfo.pInitialData = hasCacheFile ? cacheFile.data : nullptr;
+
+    VkResult result = vkCreatePipelineCache(vk_LogicalDevice, &cacheInfo, nullptr, &PipelineCache::vk_PipelineCache);
+
+    if (result != VK_SUCCESS && hasCacheFile) {
+        std::cout << "Failed to create pipeline cache from := " << PIPELINE_CACHE_FILE_PATH << ", starting empty." << std::endl;
+        cacheInfo.initialDataSize = 0;
+        cacheInfo.pInitialData = nullptr;
+        hasCacheFile = false;
+        result = vkCreatePipelineCache(vk_LogicalDevice, &cacheInfo, nullptr, &PipelineCache::vk_PipelineCache);
+    }
+
+    if (result != VK_SUCCESS) {
+        UnmapFile(cacheFile);
+        throw std::runtime_error("failed to create pipeline cache!");
+    }
+
+    PipelineCache::savedDataSize = cacheInfo.initialDataSize;
+    UnmapFile(cacheFile);
+}
+
+// Writes to a temporary file first and renames it over the old cache so a crash never leaves a half written cache behind.
+void SavePipelineCache() {
+
+    if (PipelineCache::vk_PipelineCache == VK_NULL_HANDLE) {
+        return;
+    }
+
+    size_t dataSize = 0;
+    if (vkGetPipelineCacheData(vk_LogicalDevice, PipelineCache::vk_PipelineCache, &dataSize, nullptr) != VK_SUCCESS || dataSize == 0) {
+        return;
+    }
+
+    if (dataSize == PipelineCache::savedDataSize) {
+        return;
+    }
+
+    std::vector<uint8_t> cacheData(dataSize);
+    if (vkGetPipelineCacheData(vk_LogicalDevice, PipelineCache::vk_PipelineCache, &dataSize, cacheData.data()) != VK_SUCCESS) {
+        std::cout << "Failed to read pipeline cache data." << std::endl;
+        return;
+    }
+
+    std::string temporaryFilePath = PIPELINE_CACHE_FILE_PATH + ".tmp";
+
+    {
+        std::ofstream file(temporaryFilePath, std::ios::binary | std::ios::trunc);
+        if (!file.is_open()) {
+            std::cout << "Failed to open pipeline cache for writing := " << temporaryFilePath << std::endl;
+            return;
+        }
+
+        file.write(reinterpret_cast<const char*>(cacheData.data()), static_cast<std::streamsize>(dataSize));
+
+        if (!file.good()) {
+            std::cout << "Failed to write pipeline cache := " << temporaryFilePath << std::endl;
+            return;
+        }
+    }
+
+    std::error_code errorCode;
+    std::filesystem::rename(temporaryFilePath, PIPELINE_CACHE_FILE_PATH, errorCode);
+    if (errorCode) {
+        std::cout << "Failed to replace pipeline cache := " << PIPELINE_CACHE_FILE_PATH << " Error := " << errorCode.message() << std::endl;
+        std::filesystem::remove(temporaryFilePath, errorCode);
+        return;
+    }
+
+    PipelineCache::savedDataSize = dataSize;
+}
+
+void DestroyPipelineCache() {
+
+    if (PipelineCache::vk_PipelineCache == VK_NULL_HANDLE) {
+        return;
+    }
+
+    SavePipelineCache();
+    vkDestroyPipelineCache(vk_LogicalDevice, PipelineCache::vk_PipelineCache, nullptr);
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include "DependencyIncludes.h"
+#include "StandardIncludes.h"
+
+#include "EngineConstants.h"
+
+#include <mutex>
+#include <unordered_map>
+
+// Which vertex and fragment shader pair a variant is built from.
+const uint32_t PIPELINE_SHADER_PROGRAM_DIRECT = 0;
+const uint32_t PIPELINE_SHADER_PROGRAM_INDIRECT = 1;
+
+// Position only indirect vertex shader without a fragment stage, writes depth and nothing else.
+const uint32_t PIPELINE_SHADER_PROGRAM_INDIRECT_DEPTH_ONLY = 2;
+
+// Shader functions, the world path transforms by the model uniform and the UI path by the per instance matrices.
+const uint32_t SHADER_FUNCTION_WORLD = 0;
+const uint32_t SHADER_FUNCTION_UI_INSTANCE = 1;
+
+// The in-tree shaders read the function as "layout(constant_id = 0) const uint SHADER_FUNCTION_ID", so every variant only keeps
+// its own path. The prebuilt direct vert.spv still reads SimplePushConstantData::shaderFunctionUseID.
+const uint32_t SHADER_FUNCTION_SPECIALIZATION_CONSTANT_ID = 0;
+
+// Everything that makes two graphics pipelines differ. The vertex format is fixed to GPUVertexFormat at build time, so it is not part of it.
+struct PipelineVariantKey {
+
+	uint32_t shaderProgram = PIPELINE_SHADER_PROGRAM_DIRECT;
+	uint32_t shaderFunctionID = SHADER_FUNCTION_WORLD;
+
+	VkBool32 depthTestEnable = VK_TRUE;
+	VkBool32 depthWriteEnable = VK_TRUE;
+	VkCompareOp depthCompareOp = VK_COMPARE_OP_LESS;
+
+	bool operator==(const PipelineVariantKey& other) const = default;
+};
+
+struct PipelineVariantKeyHash {
+
+	size_t operator()(const PipelineVariantKey& key) const {
+
+		uint64_t packedKey = static_cast<uint64_t>(key.shaderProgram)
+			| static_cast<uint64_t>(key.shaderFunctionID) << 8
+			| static_cast<uint64_t>(key.depthTestEnable) << 40
+			| static_cast<uint64_t>(key.depthWriteEnable) << 41
+			| static_cast<uint64_t>(key.depthCompareOp) << 42;
+
+		return std::hash<uint64_t>()(packedKey);
+	}
+};
+
+// Every graphics pipeline the renderer binds, built on first use from the shader pair of the key and specialized on its function.
+// Lookups come from the command recording jobs, so the map is only touched under the mutex.
+struct PipelineVariants {
+
+public:
+
+	inline static std::unordered_map<PipelineVariantKey, VkPipeline, PipelineVariantKeyHash> allPipelines = {};
+	inline static std::mutex pipelinesMutex;
+
+	inline static std::string directVertexShaderPath = "";
+	inline static std::string directFragmentShaderPath = "";
+
+	inline static bool depthPrepassAvailable = false;
+
+};
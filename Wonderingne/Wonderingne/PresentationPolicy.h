@@ -0,0 +1,29 @@
+#pragma once
+
+#include "DependencyIncludes.h"
+#include "StandardIncludes.h"
+
+#include "EngineConstants.h"
+
+// How frames are paced and presented, picked at startup from the command line and switchable at runtime (F3 cycles the presets).
+// Interactive deployments want few frames queued and a latency limiter, throughput deployments want deep queues and no waits.
+struct PresentationPolicy {
+
+    // 1 to MAX_FRAMES_IN_FLIGHT, resources exist for the maximum so changing it never reallocates.
+    uint32_t framesInFlight = 2;
+
+    // 0 asks for one more than the surface minimum, anything else is clamped to what the surface allows.
+    uint32_t swapChainImageCount = 0;
+
+    // Falls back to FIFO, the only mode every surface supports, when the surface lacks it.
+    VkPresentModeKHR presentMode = VK_PRESENT_MODE_MAILBOX_KHR;
+
+    // Waits for the frame's fence before input is polled instead of after, so the input a frame is built from is as fresh as it can be.
+    bool latencyLimiter = false;
+
+    bool operator==(const PresentationPolicy& other) const = default;
+};
+
+const PresentationPolicy INTERACTIVE_PRESENTATION_POLICY = { 1, 0, VK_PRESENT_MODE_MAILBOX_KHR, true };
+const PresentationPolicy BALANCED_PRESENTATION_POLICY = { 2, 0, VK_PRESENT_MODE_MAILBOX_KHR, false };
+const PresentationPolicy THROUGHPUT_PRESENTATION_POLICY = { 3, 4, VK_PRESENT_MODE_FIFO_KHR, false };
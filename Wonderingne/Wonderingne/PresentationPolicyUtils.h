@@ -0,0 +1,138 @@
+#pragma once
+
+#include "PresentationPolicy.h"
+
+#include "VulkanSwapChianUtils.h"
+#include "OcclusionCullingUtils.h"
+
+const char* GetPresentModeName(VkPresentModeKHR presentMode) {
+
+    switch (presentMode) {
+    case VK_PRESENT_MODE_IMMEDIATE_KHR:
+        return "immediate";
+    case VK_PRESENT_MODE_MAILBOX_KHR:
+        return "mailbox";
+    case VK_PRESENT_MODE_FIFO_KHR:
+        return "fifo";
+    case VK_PRESENT_MODE_FIFO_RELAXED_KHR:
+        return "fifo-relaxed";
+    default:
+        return "unknown";
+    }
+}
+
+bool ParsePresentMode(const std::string& name, VkPresentModeKHR& presentMode) {
+
+    for (VkPresentModeKHR candidate : { VK_PRESENT_MODE_IMMEDIATE_KHR, VK_PRESENT_MODE_MAILBOX_KHR, VK_PRESENT_MODE_FIFO_KHR, VK_PRESENT_MODE_FIFO_RELAXED_KHR }) {
+        if (name == GetPresentModeName(candidate)) {
+            presentMode = candidate;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void PrintPresentationPolicy(const PresentationPolicy& policy) {
+    std::cout << "Presentation policy := " << policy.framesInFlight << " frames in flight, " << vk_SwapChainImages.size() << " swap chain images, "
+        << GetPresentModeName(policy.presentMode) << ", latency limiter " << (policy.latencyLimiter ? "on" : "off") << std::endl;
+}
+
+// Reads --presentation-policy <interactive|balanced|throughput> first, then --frames-in-flight <n>, --swap-chain-images <n>,
+// --present-mode <fifo|mailbox|immediate|fifo-relaxed> and --latency-limiter <on|off> on top of it. Unknown values are reported and skipped.
+void ParsePresentationPolicyArguments(int argc, char** argv, PresentationPolicy& policy) {
+
+    for (int i = 1; i + 1 < argc; i++)
+    {
+        if (std::string(argv[i]) != "--presentation-policy") {
+            continue;
+        }
+
+        std::string preset = argv[i + 1];
+        if (preset == "interactive") {
+            policy = INTERACTIVE_PRESENTATION_POLICY;
+        }
+        else if (preset == "balanced") {
+            policy = BALANCED_PRESENTATION_POLICY;
+        }
+        else if (preset == "throughput") {
+            policy = THROUGHPUT_PRESENTATION_POLICY;
+        }
+        else {
+            std::cout << "Unknown presentation policy := " << preset << std::endl;
+        }
+    }
+
+    for (int i = 1; i + 1 < argc; i++)
+    {
+        std::string argument = argv[i];
+        std::string value = argv[i + 1];
+
+        if (argument == "--frames-in-flight") {
+            policy.framesInFlight = static_cast<uint32_t>(std::clamp(std::atoi(value.c_str()), 1, MAX_FRAMES_IN_FLIGHT));
+        }
+        else if (argument == "--swap-chain-images") {
+            policy.swapChainImageCount = static_cast<uint32_t>(std::max(std::atoi(value.c_str()), 0));
+        }
+        else if (argument == "--present-mode") {
+            if (!ParsePresentMode(value, policy.presentMode)) {
+                std::cout << "Unknown present mode := " << value << std::endl;
+            }
+        }
+        else if (argument == "--latency-limiter") {
+            policy.latencyLimiter = value == "on";
+        }
+    }
+}
+
+// Picked up by the next DrawFrame, which is the only place the frame index and the swap chain may change.
+void RequestPresentationPolicy(const PresentationPolicy& policy) {
+    requestedPresentationPolicy = policy;
+    presentationPolicyChangeRequested = true;
+}
+
+// Moves on from the preset matching the current policy, or a change still waiting to be applied. A policy from the command line that
+// matches no preset goes to the first one.
+void CyclePresentationPolicyPresets() {
+
+    const std::array<PresentationPolicy, 3> presets = { INTERACTIVE_PRESENTATION_POLICY, BALANCED_PRESENTATION_POLICY, THROUGHPUT_PRESENTATION_POLICY };
+
+    const PresentationPolicy& currentPolicy = presentationPolicyChangeRequested ? requestedPresentationPolicy : presentationPolicy;
+
+    auto currentPreset = std::find(presets.begin(), presets.end(), currentPolicy);
+    size_t nextPresetIndex = currentPreset == presets.end() ? 0 : (static_cast<size_t>(currentPreset - presets.begin()) + 1) % presets.size();
+
+    RequestPresentationPolicy(presets[nextPresetIndex]);
+}
+
+// Drains the frames in flight, restarts the frame index so no frame is skipped or reused early, and rebuilds the swap chain for the
+// image count and present mode. The per frame resources all exist up to MAX_FRAMES_IN_FLIGHT already.
+void ApplyRequestedPresentationPolicy(GLFWwindow& window) {
+
+    presentationPolicyChangeRequested = false;
+
+    vkDeviceWaitIdle(vk_LogicalDevice);
+    FlushDeferredDeletions();
+
+    presentationPolicy = requestedPresentationPolicy;
+    presentationPolicy.framesInFlight = std::clamp(presentationPolicy.framesInFlight, 1u, static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT));
+    indexOfDataForCurrentFrame = 0;
+
+    RecreateSwapChain(window);
+    RecreateHiZResources();
+
+    PrintPresentationPolicy(presentationPolicy);
+}
+
+// Called before input is polled when the latency limiter is on, DrawFrame's own wait on the same point then returns right away.
+void WaitForCurrentFrameInFlight() {
+
+    if (IsGpuTimelineActive()) {
+        WaitForTimelineValue(GpuTimeline::graphics, GpuTimeline::frameTimelineValues[indexOfDataForCurrentFrame]);
+    }
+    else {
+        vkWaitForFences(vk_LogicalDevice, 1, &inFlightFences[indexOfDataForCurrentFrame], VK_TRUE, UINT64_MAX);
+    }
+
+    MarkFrameCompleted(indexOfDataForCurrentFrame);
+}
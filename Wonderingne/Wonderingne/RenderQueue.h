@@ -0,0 +1,68 @@
+#pragma once
+
+#include "DependencyIncludes.h"
+#include "StandardIncludes.h"
+
+#include "Model.h"
+#include "FrustumCulling.h"
+
+// Draw sort key, most significant bits first so sorting groups draws by the state that is most expensive to change:
+//  63..56  pipeline (shader function of the pass)
+//  55..40  material descriptor set
+//  39..32  geometry, the index type of the arena index buffer binding
+//  31..8   view depth, front to back so early-Z rejects as much as possible
+//   7..0   unused
+const uint32_t DRAW_SORT_KEY_PIPELINE_SHIFT = 56;
+const uint32_t DRAW_SORT_KEY_MATERIAL_SHIFT = 40;
+const uint32_t DRAW_SORT_KEY_GEOMETRY_SHIFT = 32;
+const uint32_t DRAW_SORT_KEY_DEPTH_SHIFT = 8;
+
+const uint64_t DRAW_SORT_KEY_PIPELINE_MASK = 0xFF;
+const uint64_t DRAW_SORT_KEY_MATERIAL_MASK = 0xFFFF;
+const uint64_t DRAW_SORT_KEY_GEOMETRY_MASK = 0xFF;
+const uint64_t DRAW_SORT_KEY_DEPTH_MASK = 0xFFFFFF;
+
+struct RenderQueueDraw {
+
+    uint64_t sortKey = 0;
+    const Mesh* mesh = nullptr;
+};
+
+// A run of sorted draws sharing a material and index type, recorded as one multi draw indirect.
+struct RenderQueueBatch {
+
+    uint32_t firstDrawIndex = 0;
+    uint32_t drawCount = 0;
+    int materialIndex = -1;
+    VkIndexType vk_IndexType = VK_INDEX_TYPE_UINT32;
+};
+
+// One per pass, kept around between frames so the arrays are only ever grown.
+struct RenderQueue {
+
+    std::vector<RenderQueueDraw> draws = {};
+    std::vector<RenderQueueDraw> sortScratch = {};
+
+    FrustumCullingList frustumCulling;
+
+    int cameraIndex = 0;
+    int shaderFunctionIndex = 0;
+    uint32_t instanceCount = 1;
+
+    // Scene draws go through IndirectDrawBuffers with vk_IndirectGraphicsPipeline, everything else is drawn directly.
+    bool useIndirectDraws = false;
+
+    // Filled in by WriteRenderQueueIndirectDraws, the draws of the queue are [firstIndirectDrawIndex, firstIndirectDrawIndex + indirectDrawCount).
+    // GPU culled queues get theirs from BuildRenderQueueFromDrawCulling instead and have no draws of their own, their batches index
+    // the culled buffers of DrawCulling.
+    std::vector<RenderQueueBatch> batches = {};
+    uint32_t firstIndirectDrawIndex = 0;
+    uint32_t indirectDrawCount = 0;
+    bool useGPUCulling = false;
+
+    // Set by PrepareRenderQueue, the queue's batches are then recorded twice, depth only first and shaded with an EQUAL test after.
+    bool useDepthPrepass = false;
+
+    // Set by PrepareRenderQueue for GPU culled queues, the queue's batches are then recorded once per occlusion culling phase.
+    bool useOcclusionCulling = false;
+};
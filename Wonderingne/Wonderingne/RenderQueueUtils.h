@@ -0,0 +1,322 @@
+#pragma once
+
+#include "RenderQueue.h"
+
+#include "ModelUtils.h"
+#include "CameraUtils.h"
+#include "UIUtils.h"
+#include "IndirectDrawUtils.h"
+#include "DrawCullingUtils.h"
+#include "OcclusionCullingUtils.h"
+#include "BindlessTexturesUtils.h"
+#include "FrustumCullingUtils.h"
+
+uint64_t MakeDrawSortKey(uint32_t pipelineID, uint32_t materialID, VkIndexType indexType, float viewDepth) {
+
+    // Anything behind the camera or past RENDER_QUEUE_MAX_SORT_DEPTH just lands in the first or last bucket.
+    float normalizedDepth = std::clamp(viewDepth / RENDER_QUEUE_MAX_SORT_DEPTH, 0.0f, 1.0f);
+    uint64_t depthBits = static_cast<uint64_t>(normalizedDepth * static_cast<float>(DRAW_SORT_KEY_DEPTH_MASK));
+
+    uint64_t geometryID = indexType == VK_INDEX_TYPE_UINT16 ? 0 : 1;
+
+    return (static_cast<uint64_t>(pipelineID) & DRAW_SORT_KEY_PIPELINE_MASK) << DRAW_SORT_KEY_PIPELINE_SHIFT
+        | (static_cast<uint64_t>(materialID) & DRAW_SORT_KEY_MATERIAL_MASK) << DRAW_SORT_KEY_MATERIAL_SHIFT
+        | (geometryID & DRAW_SORT_KEY_GEOMETRY_MASK) << DRAW_SORT_KEY_GEOMETRY_SHIFT
+        | (depthBits & DRAW_SORT_KEY_DEPTH_MASK) << DRAW_SORT_KEY_DEPTH_SHIFT;
+}
+
+// Meshes still streaming in on the transfer queue are left out, textures are always queued before the meshes that use them.
+// With cullOnCPU only meshes whose bounds touch the camera frustum make it into the queue.
+void BuildRenderQueue(RenderQueue& renderQueue, const std::vector<Model>& modelsToRender, int cameraIndex, int shaderFunctionIndex, uint32_t instanceCount, bool cullOnCPU) {
+
+    renderQueue.draws.clear();
+    renderQueue.cameraIndex = cameraIndex;
+    renderQueue.shaderFunctionIndex = shaderFunctionIndex;
+    renderQueue.instanceCount = instanceCount;
+
+    FrustumCullingList& cullingList = renderQueue.frustumCulling;
+    GatherFrustumCullingCandidates(cullingList, modelsToRender);
+
+    if (cullOnCPU) {
+        CullFrustumCullingList(cullingList, GetCameraFrustum(Camera::camera_ubos[cameraIndex]));
+    }
+    else {
+        cullingList.visibleMeshes.assign(cullingList.candidateMeshes.begin(), cullingList.candidateMeshes.end());
+    }
+
+    const glm::mat4& view = Camera::camera_ubos[cameraIndex].view;
+
+    for (const Mesh* visibleMesh : cullingList.visibleMeshes) {
+
+        const Mesh& curMesh = *visibleMesh;
+        const Material& curMaterial = Material::allLoadedMaterials[curMesh.materialIndex];
+
+        // The view looks down -z.
+        float viewDepth = -(view * glm::vec4(curMesh.worldBoundsCenter, 1.0f)).z;
+
+        RenderQueueDraw draw{};
+        draw.sortKey = MakeDrawSortKey(static_cast<uint32_t>(shaderFunctionIndex), static_cast<uint32_t>(curMaterial.descriptorSetIndex), curMesh.vk_IndexType, viewDepth);
+        draw.mesh = &curMesh;
+
+        renderQueue.draws.push_back(draw);
+    }
+}
+
+// LSD radix sort on the 64 bit keys, 8 bits per pass. Passes where every key has the same byte (unused bits, a single
+// pipeline or material) are skipped, so a typical frame only pays for the depth and material bytes.
+void SortRenderQueue(RenderQueue& renderQueue) {
+
+    std::vector<RenderQueueDraw>& draws = renderQueue.draws;
+    std::vector<RenderQueueDraw>& scratch = renderQueue.sortScratch;
+
+    if (draws.size() < 2) {
+        return;
+    }
+
+    scratch.resize(draws.size());
+
+    for (uint32_t shift = 0; shift < 64; shift += 8)
+    {
+        std::array<size_t, 256> bucketOffsets = {};
+        for (const RenderQueueDraw& draw : draws) {
+            bucketOffsets[(draw.sortKey >> shift) & 0xFF]++;
+        }
+
+        if (bucketOffsets[(draws[0].sortKey >> shift) & 0xFF] == draws.size()) {
+            continue;
+        }
+
+        size_t offset = 0;
+        for (size_t& bucketOffset : bucketOffsets) {
+            size_t count = bucketOffset;
+            bucketOffset = offset;
+            offset += count;
+        }
+
+        for (const RenderQueueDraw& draw : draws) {
+            scratch[bucketOffsets[(draw.sortKey >> shift) & 0xFF]++] = draw;
+        }
+
+        draws.swap(scratch);
+    }
+}
+
+// Direct path, one vkCmdDrawIndexed per draw. The model transform comes in through the dynamic offset of the material set,
+// so that set is rebound whenever either changes.
+void RecordRenderQueueDirect(VkCommandBuffer commandBuffer, const RenderQueue& renderQueue, uint32_t firstDraw, uint32_t endDraw) {
+
+    VkIndexType boundIndexType = VK_INDEX_TYPE_MAX_ENUM;
+    VkDescriptorSet boundMaterialDescriptorSet = VK_NULL_HANDLE;
+    uint32_t boundModelUniformOffset = UINT32_MAX;
+
+    for (uint32_t drawIndex = firstDraw; drawIndex < endDraw; drawIndex++) {
+
+        const Mesh& curMesh = *renderQueue.draws[drawIndex].mesh;
+
+        // Everything shares the arena index buffer, it only has to be bound again when the index type changes.
+        if (curMesh.vk_IndexType != boundIndexType) {
+            vkCmdBindIndexBuffer(commandBuffer, GeometryArena::vk_IndexBuffer, 0, curMesh.vk_IndexType);
+            boundIndexType = curMesh.vk_IndexType;
+        }
+
+        VkDescriptorSet materialDescriptorSet = vk_DescriptorSetsForEachFlightFrame[Material::allLoadedMaterials[curMesh.materialIndex].descriptorSetIndex][indexOfDataForCurrentFrame];
+        if (materialDescriptorSet != boundMaterialDescriptorSet || curMesh.modelUniformDynamicOffset != boundModelUniformOffset) {
+            vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, vk_PipelineLayout, 1, 1, &materialDescriptorSet, 1, &curMesh.modelUniformDynamicOffset);
+            boundMaterialDescriptorSet = materialDescriptorSet;
+            boundModelUniformOffset = curMesh.modelUniformDynamicOffset;
+        }
+
+        vkCmdDrawIndexed(commandBuffer, static_cast<uint32_t>(curMesh.indices.size()), renderQueue.instanceCount, curMesh.firstIndex, curMesh.vertexOffset, 0);
+    }
+}
+
+// Writes the sorted draws to this frame's indirect buffers and splits them into batches, every run of draws sharing a material
+// and index type becomes one batch.
+void WriteRenderQueueIndirectDraws(RenderQueue& renderQueue) {
+
+    renderQueue.batches.clear();
+    renderQueue.firstIndirectDrawIndex = IndirectDrawBuffers::drawCount;
+    renderQueue.indirectDrawCount = 0;
+    renderQueue.useGPUCulling = false;
+
+    EnsureIndirectDrawCapacity(IndirectDrawBuffers::drawCount + static_cast<uint32_t>(renderQueue.draws.size()), indexOfDataForCurrentFrame);
+
+    // With bindless textures the material only changes the draw data, batches then only split where the index type changes.
+    bool bindlessTextures = IsBindlessTexturesActive();
+
+    for (const RenderQueueDraw& draw : renderQueue.draws) {
+
+        const Mesh& curMesh = *draw.mesh;
+
+        VkDrawIndexedIndirectCommand command{};
+        command.indexCount = static_cast<uint32_t>(curMesh.indices.size());
+        command.instanceCount = renderQueue.instanceCount;
+        command.firstIndex = curMesh.firstIndex;
+        command.vertexOffset = curMesh.vertexOffset;
+        command.firstInstance = 0;
+
+        DrawData drawData{};
+        drawData.model = curMesh.modelMatrix;
+        drawData.boundingSphere = glm::vec4((curMesh.localBounds.sphereCenter - curMesh.positionDequantizationOffset) / curMesh.positionDequantizationScale, curMesh.localBounds.sphereRadius);
+        drawData.positionDequantizationScale = glm::vec4(curMesh.positionDequantizationScale, 1.0f);
+        drawData.textureIndex = static_cast<uint32_t>(Material::allLoadedMaterials[curMesh.materialIndex].diffuseTextureIndex);
+
+        uint32_t drawIndex = WriteIndirectDraw(command, drawData, indexOfDataForCurrentFrame);
+
+        if (renderQueue.batches.empty() || (!bindlessTextures && renderQueue.batches.back().materialIndex != curMesh.materialIndex) || renderQueue.batches.back().vk_IndexType != curMesh.vk_IndexType) {
+
+            RenderQueueBatch batch{};
+            batch.firstDrawIndex = drawIndex;
+            batch.materialIndex = curMesh.materialIndex;
+            batch.vk_IndexType = curMesh.vk_IndexType;
+
+            renderQueue.batches.push_back(batch);
+        }
+
+        renderQueue.batches.back().drawCount++;
+    }
+
+    renderQueue.indirectDrawCount = IndirectDrawBuffers::drawCount - renderQueue.firstIndirectDrawIndex;
+}
+
+// GPU culled queues take their batches straight from the draw culling, a batch's drawCount is only the most its culled count can be.
+void BuildRenderQueueFromDrawCulling(RenderQueue& renderQueue, int cameraIndex, int shaderFunctionIndex, uint32_t instanceCount) {
+
+    renderQueue.draws.clear();
+    renderQueue.batches.clear();
+    renderQueue.cameraIndex = cameraIndex;
+    renderQueue.shaderFunctionIndex = shaderFunctionIndex;
+    renderQueue.instanceCount = instanceCount;
+    renderQueue.firstIndirectDrawIndex = 0;
+    renderQueue.indirectDrawCount = static_cast<uint32_t>(DrawCulling::instances.size());
+    renderQueue.useGPUCulling = true;
+
+    for (const DrawCullingBatch& drawCullingBatch : DrawCulling::batches) {
+
+        if (drawCullingBatch.instanceCount == 0) {
+            continue;
+        }
+
+        RenderQueueBatch batch{};
+        batch.firstDrawIndex = drawCullingBatch.firstDrawIndex;
+        batch.drawCount = drawCullingBatch.instanceCount;
+        batch.materialIndex = drawCullingBatch.materialIndex;
+        batch.vk_IndexType = drawCullingBatch.vk_IndexType;
+
+        renderQueue.batches.push_back(batch);
+    }
+}
+
+// Indirect path, one vkCmdDrawIndexedIndirect per batch. The shader finds its model matrix at drawDataBaseIndex + gl_DrawID.
+// With GPU culling the batch reads the compacted commands and draw data instead and its draw count comes from the culling pass.
+// The depth pre-pass samples no textures, so it skips the texture binds. The late occlusion phase reads its own half of the culled buffers.
+void RecordRenderQueueIndirect(VkCommandBuffer commandBuffer, const RenderQueue& renderQueue, uint32_t firstBatch, uint32_t endBatch, bool depthPrepass, bool lateOcclusionPhase, SimplePushConstantData& simplePushConstantData) {
+
+    uint32_t culledDrawOffset = lateOcclusionPhase ? GetDrawCullingLateDrawOffset() : 0;
+
+    int drawDataDescriptorSetIndex = renderQueue.useGPUCulling ? DrawCulling::culledDrawDataDescriptorSetIndex : IndirectDrawBuffers::drawDataDescriptorSetIndex;
+    VkDescriptorSet drawDataDescriptorSet = vk_DescriptorSetsForEachFlightFrame[drawDataDescriptorSetIndex][indexOfDataForCurrentFrame];
+    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, vk_PipelineLayout, 3, 1, &drawDataDescriptorSet, 0, nullptr);
+
+    bool bindlessTextures = IsBindlessTexturesActive();
+    if (bindlessTextures && !depthPrepass) {
+        vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, vk_PipelineLayout, 4, 1, &BindlessTextures::vk_DescriptorSet, 0, nullptr);
+    }
+
+    // The material set layout still has the dynamic model uniform binding, the indirect shaders just never read it.
+    uint32_t unusedModelUniformOffset = 0;
+
+    for (uint32_t batchIndex = firstBatch; batchIndex < endBatch; batchIndex++) {
+
+        const RenderQueueBatch& batch = renderQueue.batches[batchIndex];
+
+        vkCmdBindIndexBuffer(commandBuffer, GeometryArena::vk_IndexBuffer, 0, batch.vk_IndexType);
+
+        if (!bindlessTextures && !depthPrepass) {
+            VkDescriptorSet materialDescriptorSet = vk_DescriptorSetsForEachFlightFrame[Material::allLoadedMaterials[batch.materialIndex].descriptorSetIndex][indexOfDataForCurrentFrame];
+            vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, vk_PipelineLayout, 1, 1, &materialDescriptorSet, 1, &unusedModelUniformOffset);
+        }
+
+        VkDeviceSize commandOffset = batch.firstDrawIndex * sizeof(VkDrawIndexedIndirectCommand);
+
+        if (renderQueue.useGPUCulling) {
+            uint32_t culledFirstDrawIndex = culledDrawOffset + batch.firstDrawIndex;
+
+            simplePushConstantData.drawDataBaseIndex = culledFirstDrawIndex;
+            vkCmdPushConstants(commandBuffer, vk_PipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(SimplePushConstantData), &simplePushConstantData);
+
+            pfn_vkCmdDrawIndexedIndirectCount(commandBuffer, DrawCulling::vk_CulledCommandBuffers[indexOfDataForCurrentFrame], culledFirstDrawIndex * sizeof(VkDrawIndexedIndirectCommand), DrawCulling::vk_DrawCountBuffers[indexOfDataForCurrentFrame], culledFirstDrawIndex * sizeof(uint32_t), batch.drawCount, sizeof(VkDrawIndexedIndirectCommand));
+        }
+        else if (multiDrawIndirectEnabled) {
+            simplePushConstantData.drawDataBaseIndex = batch.firstDrawIndex;
+            vkCmdPushConstants(commandBuffer, vk_PipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(SimplePushConstantData), &simplePushConstantData);
+
+            vkCmdDrawIndexedIndirect(commandBuffer, IndirectDrawBuffers::vk_CommandBuffers[indexOfDataForCurrentFrame], commandOffset, batch.drawCount, sizeof(VkDrawIndexedIndirectCommand));
+        }
+        else {
+            // gl_DrawID is always 0 with a draw count of 1, so the base index has to move with every draw.
+            for (uint32_t i = 0; i < batch.drawCount; i++)
+            {
+                simplePushConstantData.drawDataBaseIndex = batch.firstDrawIndex + i;
+                vkCmdPushConstants(commandBuffer, vk_PipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(SimplePushConstantData), &simplePushConstantData);
+
+                vkCmdDrawIndexedIndirect(commandBuffer, IndirectDrawBuffers::vk_CommandBuffers[indexOfDataForCurrentFrame], commandOffset + i * sizeof(VkDrawIndexedIndirectCommand), 1, sizeof(VkDrawIndexedIndirectCommand));
+            }
+        }
+    }
+}
+
+// What RecordRenderQueueRange ranges over, batches with indirect draws and single draws otherwise.
+uint32_t GetRenderQueueRecordItemCount(const RenderQueue& renderQueue) {
+    return static_cast<uint32_t>(renderQueue.useIndirectDraws ? renderQueue.batches.size() : renderQueue.draws.size());
+}
+
+PipelineVariantKey GetRenderQueuePipelineVariantKey(const RenderQueue& renderQueue, bool depthPrepass) {
+
+    PipelineVariantKey variantKey{};
+    variantKey.shaderProgram = renderQueue.useIndirectDraws ? PIPELINE_SHADER_PROGRAM_INDIRECT : PIPELINE_SHADER_PROGRAM_DIRECT;
+    variantKey.shaderFunctionID = static_cast<uint32_t>(renderQueue.shaderFunctionIndex);
+
+    if (depthPrepass) {
+        variantKey.shaderProgram = PIPELINE_SHADER_PROGRAM_INDIRECT_DEPTH_ONLY;
+    }
+    else if (renderQueue.useDepthPrepass) {
+        // Depth is final after the pre-pass, only the closest surface passes and nothing has to be written again.
+        variantKey.depthWriteEnable = VK_FALSE;
+        variantKey.depthCompareOp = VK_COMPARE_OP_EQUAL;
+    }
+
+    return variantKey;
+}
+
+// Records items [firstItem, endItem) of the queue. Only reads the queue and the frame's descriptor sets, so disjoint ranges can be
+// recorded into different command buffers at the same time. Sets that stay the same for the whole range are bound once, the rest
+// only when they differ from the previous draw.
+void RecordRenderQueueRange(VkCommandBuffer commandBuffer, const RenderQueue& renderQueue, uint32_t firstItem, uint32_t endItem, bool depthPrepass, bool lateOcclusionPhase) {
+
+    if (firstItem >= endItem) {
+        return;
+    }
+
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, GetPipelineVariant(GetRenderQueuePipelineVariantKey(renderQueue, depthPrepass)));
+
+    // Still pushed for shaders that branch on it instead of the specialization constant.
+    SimplePushConstantData simplePushConstantData = {};
+    simplePushConstantData.shaderFunctionUseID = renderQueue.shaderFunctionIndex;
+    simplePushConstantData.drawDataBaseIndex = 0;
+    vkCmdPushConstants(commandBuffer, vk_PipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(SimplePushConstantData), &simplePushConstantData);
+
+    VkDescriptorSet cameraDescriptorSet = vk_DescriptorSetsForEachFlightFrame[Camera::allCameraUBODescriptorSetIndices[renderQueue.cameraIndex]][indexOfDataForCurrentFrame];
+    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, vk_PipelineLayout, 0, 1, &cameraDescriptorSet, 0, nullptr);
+
+    VkDescriptorSet uiInstanceDescriptorSet = vk_DescriptorSetsForEachFlightFrame[UI::vk_UI_Instance_Model_SSBO_DescriptorSetIndex][indexOfDataForCurrentFrame];
+    uint32_t uiInstanceDynamicOffset = 0;
+    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, vk_PipelineLayout, 2, 1, &uiInstanceDescriptorSet, 1, &uiInstanceDynamicOffset);
+
+    if (renderQueue.useIndirectDraws) {
+        RecordRenderQueueIndirect(commandBuffer, renderQueue, firstItem, endItem, depthPrepass, lateOcclusionPhase, simplePushConstantData);
+    }
+    else {
+        RecordRenderQueueDirect(commandBuffer, renderQueue, firstItem, endItem);
+    }
+}
@@ -13,4 +13,5 @@ struct CameraUniformBufferObject {
 
 struct SimplePushConstantData {
     alignas(16) uint32_t shaderFunctionUseID;
+    uint32_t drawDataBaseIndex;
 };
\ No newline at end of file
@@ -15,6 +15,10 @@
 #include <algorithm>
 
 #include <fstream>
+#include <sstream>
+#include <iomanip>
 #include <array>
 
-#include <chrono>
\ No newline at end of file
+#include <chrono>
+#include <functional>
+#include <memory>
\ No newline at end of file
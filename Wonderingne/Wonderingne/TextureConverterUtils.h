@@ -0,0 +1,386 @@
+#pragma once
+
+// ModelUtils.h owns the stb_image implementation.
+#include "ModelUtils.h"
+#include "Ktx2Utils.h"
+#include "MipmapUtils.h"
+
+#include <filesystem>
+
+// Offline texture conversion, run with --convert-textures <directory>. Every source image gets a "<texture>.ktx2" next to it
+// holding the full sRGB mip chain as BC1, or BC3 when the image has any transparency. The encoder is a simple bounding box fit,
+// good enough for albedo maps and a lot cheaper to sample and keep resident than RGBA8.
+
+const std::array<std::string, 5> CONVERTIBLE_TEXTURE_EXTENSIONS = { ".png", ".jpg", ".jpeg", ".tga", ".bmp" };
+
+const uint32_t BC_BLOCK_DIMENSION = 4;
+const uint32_t BC1_BLOCK_SIZE = 8;
+const uint32_t BC3_BLOCK_SIZE = 16;
+
+uint16_t PackColorTo565(const glm::ivec3& color) {
+    return static_cast<uint16_t>(((color.r * 31 + 127) / 255) << 11 | ((color.g * 63 + 127) / 255) << 5 | ((color.b * 31 + 127) / 255));
+}
+
+glm::ivec3 UnpackColorFrom565(uint16_t packedColor) {
+
+    int r = (packedColor >> 11) & 31;
+    int g = (packedColor >> 5) & 63;
+    int b = packedColor & 31;
+
+    return glm::ivec3((r << 3) | (r >> 2), (g << 2) | (g >> 4), (b << 3) | (b >> 2));
+}
+
+// Reads the 4x4 block at blockX, blockY. Blocks hanging over the edge of small levels repeat the last row and column.
+void GatherBlockTexels(const uint8_t* pixels, uint32_t width, uint32_t height, uint32_t blockX, uint32_t blockY, std::array<glm::ivec4, 16>& blockTexels) {
+
+    for (uint32_t y = 0; y < BC_BLOCK_DIMENSION; y++)
+    {
+        uint32_t pixelY = std::min(blockY * BC_BLOCK_DIMENSION + y, height - 1);
+
+        for (uint32_t x = 0; x < BC_BLOCK_DIMENSION; x++)
+        {
+            uint32_t pixelX = std::min(blockX * BC_BLOCK_DIMENSION + x, width - 1);
+
+            const uint8_t* texel = &pixels[(static_cast<size_t>(pixelY) * width + pixelX) * 4];
+            blockTexels[y * BC_BLOCK_DIMENSION + x] = glm::ivec4(texel[0], texel[1], texel[2], texel[3]);
+        }
+    }
+}
+
+// Endpoints are the bounding box of the block pulled in by 1/16th, which keeps outliers from wasting the palette.
+// The first endpoint is always the bigger one so the block decodes in four colour mode.
+void EncodeBC1ColorBlock(const std::array<glm::ivec4, 16>& blockTexels, uint8_t* outBlock) {
+
+    glm::ivec3 colorMin = glm::ivec3(255);
+    glm::ivec3 colorMax = glm::ivec3(0);
+    for (const glm::ivec4& texel : blockTexels) {
+        colorMin = glm::min(colorMin, glm::ivec3(texel));
+        colorMax = glm::max(colorMax, glm::ivec3(texel));
+    }
+
+    glm::ivec3 inset = (colorMax - colorMin) / 16;
+    colorMin = glm::min(colorMin + inset, glm::ivec3(255));
+    colorMax = glm::max(colorMax - inset, glm::ivec3(0));
+
+    uint16_t color0 = PackColorTo565(colorMax);
+    uint16_t color1 = PackColorTo565(colorMin);
+    if (color0 < color1) {
+        std::swap(color0, color1);
+    }
+
+    uint32_t indices = 0;
+
+    if (color0 != color1) {
+        std::array<glm::ivec3, 4> palette;
+        palette[0] = UnpackColorFrom565(color0);
+        palette[1] = UnpackColorFrom565(color1);
+        palette[2] = (palette[0] * 2 + palette[1]) / 3;
+        palette[3] = (palette[0] + palette[1] * 2) / 3;
+
+        for (uint32_t i = 0; i < 16; i++)
+        {
+            uint32_t bestIndex = 0;
+            int bestDistance = INT_MAX;
+
+            for (uint32_t paletteIndex = 0; paletteIndex < 4; paletteIndex++)
+            {
+                glm::ivec3 difference = glm::ivec3(blockTexels[i]) - palette[paletteIndex];
+                int distance = difference.r * difference.r + difference.g * difference.g + difference.b * difference.b;
+                if (distance < bestDistance) {
+                    bestDistance = distance;
+                    bestIndex = paletteIndex;
+                }
+            }
+
+            indices |= bestIndex << (i * 2);
+        }
+    }
+
+    memcpy(outBlock, &color0, sizeof(color0));
+    memcpy(outBlock + 2, &color1, sizeof(color1));
+    memcpy(outBlock + 4, &indices, sizeof(indices));
+}
+
+// BC3 alpha block, two endpoints and eight interpolated values with a 3 bit index per texel.
+void EncodeBC3AlphaBlock(const std::array<glm::ivec4, 16>& blockTexels, uint8_t* outBlock) {
+
+    int alphaMin = 255;
+    int alphaMax = 0;
+    for (const glm::ivec4& texel : blockTexels) {
+        alphaMin = std::min(alphaMin, texel.a);
+        alphaMax = std::max(alphaMax, texel.a);
+    }
+
+    uint64_t indices = 0;
+
+    if (alphaMax != alphaMin) {
+        std::array<int, 8> palette;
+        palette[0] = alphaMax;
+        palette[1] = alphaMin;
+        for (int i = 1; i < 7; i++)
+        {
+            palette[i + 1] = ((7 - i) * alphaMax + i * alphaMin) / 7;
+        }
+
+        for (uint32_t i = 0; i < 16; i++)
+        {
+            uint64_t bestIndex = 0;
+            int bestDistance = INT_MAX;
+
+            for (uint32_t paletteIndex = 0; paletteIndex < 8; paletteIndex++)
+            {
+                int distance = std::abs(blockTexels[i].a - palette[paletteIndex]);
+                if (distance < bestDistance) {
+                    bestDistance = distance;
+                    bestIndex = paletteIndex;
+                }
+            }
+
+            indices |= bestIndex << (i * 3);
+        }
+    }
+
+    outBlock[0] = static_cast<uint8_t>(alphaMax);
+    outBlock[1] = static_cast<uint8_t>(alphaMin);
+    for (int i = 0; i < 6; i++)
+    {
+        outBlock[2 + i] = static_cast<uint8_t>(indices >> (i * 8));
+    }
+}
+
+void CompressRGBA8LevelToBC(const uint8_t* pixels, uint32_t width, uint32_t height, bool withAlpha, std::vector<uint8_t>& compressedLevel) {
+
+    uint32_t blocksWide = (width + BC_BLOCK_DIMENSION - 1) / BC_BLOCK_DIMENSION;
+    uint32_t blocksHigh = (height + BC_BLOCK_DIMENSION - 1) / BC_BLOCK_DIMENSION;
+    uint32_t blockSize = withAlpha ? BC3_BLOCK_SIZE : BC1_BLOCK_SIZE;
+
+    compressedLevel.resize(static_cast<size_t>(blocksWide) * blocksHigh * blockSize);
+
+    std::array<glm::ivec4, 16> blockTexels;
+    for (uint32_t blockY = 0; blockY < blocksHigh; blockY++)
+    {
+        for (uint32_t blockX = 0; blockX < blocksWide; blockX++)
+        {
+            GatherBlockTexels(pixels, width, height, blockX, blockY, blockTexels);
+
+            uint8_t* outBlock = compressedLevel.data() + (static_cast<size_t>(blockY) * blocksWide + blockX) * blockSize;
+            if (withAlpha) {
+                EncodeBC3AlphaBlock(blockTexels, outBlock);
+                EncodeBC1ColorBlock(blockTexels, outBlock + 8);
+            }
+            else {
+                EncodeBC1ColorBlock(blockTexels, outBlock);
+            }
+        }
+    }
+}
+
+template<typename T>
+void AppendKtx2Bytes(std::vector<uint8_t>& fileData, const T& value) {
+    const uint8_t* bytes = reinterpret_cast<const uint8_t*>(&value);
+    fileData.insert(fileData.end(), bytes, bytes + sizeof(T));
+}
+
+void AppendKtx2DataFormatDescriptorSample(std::vector<uint8_t>& fileData, uint16_t bitOffset, uint8_t channelType) {
+
+    Ktx2DataFormatDescriptorSample sample{};
+    sample.bitOffset = bitOffset;
+    sample.bitLength = 63;
+    sample.channelType = channelType;
+    sample.sampleLower = 0;
+    sample.sampleUpper = UINT32_MAX;
+
+    AppendKtx2Bytes(fileData, sample);
+}
+
+// Data format descriptor for BC1 (no alpha) or BC3 with sRGB transfer, one 64 bit sample per 8 byte half of the block.
+void AppendKtx2DataFormatDescriptor(std::vector<uint8_t>& fileData, bool withAlpha) {
+
+    uint32_t sampleCount = withAlpha ? 2 : 1;
+
+    Ktx2DataFormatDescriptorBlockHeader blockHeader{};
+    blockHeader.vendorIdAndDescriptorType = 0;
+    blockHeader.versionNumber = KHR_DF_VERSION_NUMBER;
+    blockHeader.descriptorBlockSize = static_cast<uint16_t>(sizeof(Ktx2DataFormatDescriptorBlockHeader) + sampleCount * sizeof(Ktx2DataFormatDescriptorSample));
+    blockHeader.colorModel = withAlpha ? KHR_DF_MODEL_BC3 : KHR_DF_MODEL_BC1A;
+    blockHeader.colorPrimaries = KHR_DF_PRIMARIES_BT709;
+    blockHeader.transferFunction = KHR_DF_TRANSFER_SRGB;
+    blockHeader.texelBlockDimension[0] = BC_BLOCK_DIMENSION - 1;
+    blockHeader.texelBlockDimension[1] = BC_BLOCK_DIMENSION - 1;
+    blockHeader.bytesPlane[0] = static_cast<uint8_t>(withAlpha ? BC3_BLOCK_SIZE : BC1_BLOCK_SIZE);
+
+    uint32_t totalSize = sizeof(uint32_t) + blockHeader.descriptorBlockSize;
+    AppendKtx2Bytes(fileData, totalSize);
+    AppendKtx2Bytes(fileData, blockHeader);
+
+    if (withAlpha) {
+        AppendKtx2DataFormatDescriptorSample(fileData, 0, KHR_DF_CHANNEL_BC3_ALPHA);
+        AppendKtx2DataFormatDescriptorSample(fileData, 64, KHR_DF_CHANNEL_BC3_COLOR);
+    }
+    else {
+        AppendKtx2DataFormatDescriptorSample(fileData, 0, KHR_DF_CHANNEL_BC1A_COLOR);
+    }
+}
+
+bool ConvertTextureToKtx2(const std::string& sourcePath, const std::string& ktx2Path) {
+
+    int texWidth, texHeight, texChannels;
+    stbi_uc* pixels = stbi_load(sourcePath.c_str(), &texWidth, &texHeight, &texChannels, STBI_rgb_alpha);
+    if (!pixels) {
+        std::cout << "Failed to load texture for conversion := " << sourcePath << std::endl;
+        return false;
+    }
+
+    uint32_t width = static_cast<uint32_t>(texWidth);
+    uint32_t height = static_cast<uint32_t>(texHeight);
+    uint32_t mipLevels = GetMipLevelCount(width, height);
+
+    bool withAlpha = false;
+    for (size_t i = 0; i < static_cast<size_t>(width) * height; i++)
+    {
+        if (pixels[i * 4 + 3] != 255) {
+            withAlpha = true;
+            break;
+        }
+    }
+
+    std::vector<uint8_t> mipChain;
+    std::vector<VkDeviceSize> mipChainOffsets;
+    GenerateRGBA8SRGBMipChainOnCPU(pixels, width, height, mipLevels, mipChain, mipChainOffsets);
+    stbi_image_free(pixels);
+
+    std::vector<std::vector<uint8_t>> compressedLevels(mipLevels);
+    for (uint32_t level = 0; level < mipLevels; level++)
+    {
+        CompressRGBA8LevelToBC(mipChain.data() + mipChainOffsets[level], std::max(width >> level, 1u), std::max(height >> level, 1u), withAlpha, compressedLevels[level]);
+    }
+
+    Ktx2Header header{};
+    header.vkFormat = withAlpha ? VK_FORMAT_BC3_SRGB_BLOCK : VK_FORMAT_BC1_RGB_SRGB_BLOCK;
+    header.typeSize = 1;
+    header.pixelWidth = width;
+    header.pixelHeight = height;
+    header.pixelDepth = 0;
+    header.layerCount = 0;
+    header.faceCount = 1;
+    header.levelCount = mipLevels;
+    header.supercompressionScheme = KTX2_SUPERCOMPRESSION_NONE;
+
+    std::vector<uint8_t> dataFormatDescriptor;
+    AppendKtx2DataFormatDescriptor(dataFormatDescriptor, withAlpha);
+
+    uint64_t levelIndexOffset = KTX2_IDENTIFIER.size() + sizeof(Ktx2Header) + sizeof(Ktx2Index);
+
+    Ktx2Index index{};
+    index.dfdByteOffset = static_cast<uint32_t>(levelIndexOffset + sizeof(Ktx2LevelIndexEntry) * mipLevels);
+    index.dfdByteLength = static_cast<uint32_t>(dataFormatDescriptor.size());
+
+    // Every level starts on a block boundary, levels are laid out from the smallest to the base level.
+    uint64_t levelAlignment = withAlpha ? BC3_BLOCK_SIZE : BC1_BLOCK_SIZE;
+    std::vector<Ktx2LevelIndexEntry> levelIndex(mipLevels);
+
+    uint64_t levelOffset = index.dfdByteOffset + index.dfdByteLength;
+    for (int level = static_cast<int>(mipLevels) - 1; level >= 0; level--)
+    {
+        levelOffset = (levelOffset + levelAlignment - 1) / levelAlignment * levelAlignment;
+
+        levelIndex[level].byteOffset = levelOffset;
+        levelIndex[level].byteLength = compressedLevels[level].size();
+        levelIndex[level].uncompressedByteLength = compressedLevels[level].size();
+
+        levelOffset += compressedLevels[level].size();
+    }
+
+    std::vector<uint8_t> fileData;
+    fileData.reserve(static_cast<size_t>(levelOffset));
+    fileData.insert(fileData.end(), KTX2_IDENTIFIER.begin(), KTX2_IDENTIFIER.end());
+    AppendKtx2Bytes(fileData, header);
+    AppendKtx2Bytes(fileData, index);
+    for (const Ktx2LevelIndexEntry& levelEntry : levelIndex) {
+        AppendKtx2Bytes(fileData, levelEntry);
+    }
+    fileData.insert(fileData.end(), dataFormatDescriptor.begin(), dataFormatDescriptor.end());
+
+    for (int level = static_cast<int>(mipLevels) - 1; level >= 0; level--)
+    {
+        fileData.resize(static_cast<size_t>(levelIndex[level].byteOffset), 0);
+        fileData.insert(fileData.end(), compressedLevels[level].begin(), compressedLevels[level].end());
+    }
+
+    // Same as the mesh cache, a crash while writing never leaves a half written texture behind.
+    std::string temporaryFilePath = ktx2Path + ".tmp";
+
+    {
+        std::ofstream file(temporaryFilePath, std::ios::binary | std::ios::trunc);
+        if (!file.is_open()) {
+            std::cout << "Failed to open KTX2 texture for writing := " << temporaryFilePath << std::endl;
+            return false;
+        }
+
+        file.write(reinterpret_cast<const char*>(fileData.data()), static_cast<std::streamsize>(fileData.size()));
+
+        if (!file.good()) {
+            std::cout << "Failed to write KTX2 texture := " << temporaryFilePath << std::endl;
+            return false;
+        }
+    }
+
+    std::error_code errorCode;
+    std::filesystem::rename(temporaryFilePath, ktx2Path, errorCode);
+    if (errorCode) {
+        std::cout << "Failed to replace KTX2 texture := " << ktx2Path << " Error := " << errorCode.message() << std::endl;
+        std::filesystem::remove(temporaryFilePath, errorCode);
+        return false;
+    }
+
+    std::cout << "Converted " << sourcePath << " to " << (withAlpha ? "BC3" : "BC1") << " with " << mipLevels << " mip levels." << std::endl;
+
+    return true;
+}
+
+bool IsConvertibleTexture(const std::filesystem::path& filePath) {
+
+    std::string extension = filePath.extension().string();
+    std::transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+
+    return std::find(CONVERTIBLE_TEXTURE_EXTENSIONS.begin(), CONVERTIBLE_TEXTURE_EXTENSIONS.end(), extension) != CONVERTIBLE_TEXTURE_EXTENSIONS.end();
+}
+
+// Converts every texture under directoryPath whose .ktx2 is missing or older than the source. Returns how many failed.
+uint32_t ConvertTexturesInDirectory(const std::string& directoryPath) {
+
+    uint32_t convertedCount = 0;
+    uint32_t failedCount = 0;
+
+    std::error_code errorCode;
+    for (const std::filesystem::directory_entry& entry : std::filesystem::recursive_directory_iterator(directoryPath, errorCode)) {
+
+        if (!entry.is_regular_file() || !IsConvertibleTexture(entry.path())) {
+            continue;
+        }
+
+        std::string sourcePath = entry.path().string();
+        std::string ktx2Path = GetKtx2PathForTexture(sourcePath);
+
+        std::error_code timeErrorCode;
+        if (std::filesystem::exists(ktx2Path) && std::filesystem::last_write_time(ktx2Path, timeErrorCode) >= entry.last_write_time(timeErrorCode) && !timeErrorCode) {
+            continue;
+        }
+
+        if (ConvertTextureToKtx2(sourcePath, ktx2Path)) {
+            convertedCount++;
+        }
+        else {
+            failedCount++;
+        }
+    }
+
+    if (errorCode) {
+        std::cout << "Failed to walk texture directory := " << directoryPath << " Error := " << errorCode.message() << std::endl;
+        failedCount++;
+    }
+
+    std::cout << "Converted " << convertedCount << " textures, " << failedCount << " failed." << std::endl;
+
+    return failedCount;
+}
@@ -4,6 +4,9 @@
 #include "Model.h"
 
 #include "VulkanCreateUtils.h"
+#include "VertexFormatUtils.h"
+#include "MeshBoundsUtils.h"
+#include "ModelUniformRingUtils.h"
 
 void CreateDescriptorSetLayoutForUIInstanceSSBO() {
 
@@ -91,12 +94,16 @@ void UpdateUIModelUniformBuffer(Mesh& currentMesh, uint32_t indexOfDataForCurren
 
     ModelUniformBufferObject model_ubo{};
 
-    model_ubo.model = glm::mat4(1.0);
-    model_ubo.model = glm::rotate(model_ubo.model, glm::radians(90.0f) * -1.0f, glm::vec3(1.0f, 0.0f, 0.0f));
-    //model_ubo.model = glm::rotate(model_ubo.model, time * glm::radians(90.0f) * -1.0f, glm::vec3(0.0f, 0.0f, 1.0f));
-    model_ubo.model = glm::scale(model_ubo.model, glm::vec3(0.1f));
+    glm::mat4 meshToWorld = glm::mat4(1.0);
+    meshToWorld = glm::rotate(meshToWorld, glm::radians(90.0f) * -1.0f, glm::vec3(1.0f, 0.0f, 0.0f));
+    //meshToWorld = glm::rotate(meshToWorld, time * glm::radians(90.0f) * -1.0f, glm::vec3(0.0f, 0.0f, 1.0f));
+    meshToWorld = glm::scale(meshToWorld, glm::vec3(0.1f));
+    UpdateMeshWorldBounds(currentMesh, meshToWorld);
 
-    vmaCopyMemoryToAllocation(vma_Allocator, &model_ubo, currentMesh.vk_ModelUniformBuffersAllocations[indexOfDataForCurrentFrame], 0, sizeof(model_ubo));
+    model_ubo.model = meshToWorld * GetPositionDequantizationMatrix(currentMesh);
+
+    currentMesh.modelMatrix = model_ubo.model;
+    currentMesh.modelUniformDynamicOffset = WriteToModelUniformRing(model_ubo, indexOfDataForCurrentFrame);
 }
 
 void UpdateUIModelInstanceDynamicShaderBuffer(uint32_t indexOfDataForCurrentFrame) {
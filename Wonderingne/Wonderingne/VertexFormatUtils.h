@@ -0,0 +1,148 @@
+#pragma once
+
+#include "Model.h"
+#include "VertexFormats.h"
+
+#include <glm/gtc/packing.hpp>
+
+void EncodePositionComponent(const glm::vec3& position, glm::vec3& encodedPosition) {
+    encodedPosition = position;
+}
+
+void EncodePositionComponent(const glm::vec3& normalizedPosition, Snorm16x4& encodedPosition) {
+    encodedPosition.x = static_cast<int16_t>(glm::packSnorm1x16(normalizedPosition.x));
+    encodedPosition.y = static_cast<int16_t>(glm::packSnorm1x16(normalizedPosition.y));
+    encodedPosition.z = static_cast<int16_t>(glm::packSnorm1x16(normalizedPosition.z));
+    encodedPosition.w = INT16_MAX;
+}
+
+void EncodePositionComponent(const glm::vec3& normalizedPosition, Half16x4& encodedPosition) {
+    encodedPosition.x = glm::packHalf1x16(normalizedPosition.x);
+    encodedPosition.y = glm::packHalf1x16(normalizedPosition.y);
+    encodedPosition.z = glm::packHalf1x16(normalizedPosition.z);
+    encodedPosition.w = glm::packHalf1x16(1.0f);
+}
+
+void EncodeTexCoordComponent(const glm::vec2& texCoord, glm::vec2& encodedTexCoord) {
+    encodedTexCoord = texCoord;
+}
+
+void EncodeTexCoordComponent(const glm::vec2& texCoord, Unorm16x2& encodedTexCoord) {
+    encodedTexCoord.x = glm::packUnorm1x16(texCoord.x);
+    encodedTexCoord.y = glm::packUnorm1x16(texCoord.y);
+}
+
+void EncodeTexCoordComponent(const glm::vec2& texCoord, Half16x2& encodedTexCoord) {
+    encodedTexCoord.x = glm::packHalf1x16(texCoord.x);
+    encodedTexCoord.y = glm::packHalf1x16(texCoord.y);
+}
+
+// Fills in positionDequantizationScale and positionDequantizationOffset so that offset + scale * normalizedPosition
+// gives back the original position.
+void CalculatePositionDequantizationForMesh(Mesh& curMesh) {
+
+    curMesh.positionDequantizationScale = glm::vec3(1.0f);
+    curMesh.positionDequantizationOffset = glm::vec3(0.0f);
+
+    if (curMesh.vertices.empty()) {
+        return;
+    }
+
+    glm::vec3 boundsMin = curMesh.vertices[0].position;
+    glm::vec3 boundsMax = curMesh.vertices[0].position;
+    for (const Vertex& vertex : curMesh.vertices) {
+        boundsMin = glm::min(boundsMin, vertex.position);
+        boundsMax = glm::max(boundsMax, vertex.position);
+    }
+
+    glm::vec3 halfExtent = (boundsMax - boundsMin) * 0.5f;
+
+    curMesh.positionDequantizationOffset = (boundsMin + boundsMax) * 0.5f;
+
+    // Flat axes (a plane) would otherwise divide by zero, any scale works there since every position maps to 0.
+    for (int axis = 0; axis < 3; axis++)
+    {
+        curMesh.positionDequantizationScale[axis] = halfExtent[axis] > 0.0f ? halfExtent[axis] : 1.0f;
+    }
+}
+
+// Unorm16 can only hold [0, 1]. Shifting by whole tiles is invisible with the repeating sampler, anything still outside is clamped.
+glm::vec2 GetTexCoordTileShiftForMesh(const Mesh& curMesh, const std::string& meshName) {
+
+    if (curMesh.vertices.empty()) {
+        return glm::vec2(0.0f);
+    }
+
+    glm::vec2 texCoordMin = curMesh.vertices[0].texCoord;
+    glm::vec2 texCoordMax = curMesh.vertices[0].texCoord;
+    for (const Vertex& vertex : curMesh.vertices) {
+        texCoordMin = glm::min(texCoordMin, vertex.texCoord);
+        texCoordMax = glm::max(texCoordMax, vertex.texCoord);
+    }
+
+    glm::vec2 tileShift = glm::floor(texCoordMin);
+
+    glm::vec2 shiftedMax = texCoordMax - tileShift;
+    if (shiftedMax.x > 1.0f || shiftedMax.y > 1.0f) {
+        std::cout << "Texture coordinates of " << meshName << " span more than one tile and get clamped by the unorm16 vertex format, use HalfVertexFormat for it." << std::endl;
+    }
+
+    return tileShift;
+}
+
+glm::mat4 GetPositionDequantizationMatrix(const Mesh& curMesh) {
+
+    glm::mat4 dequantization = glm::translate(glm::mat4(1.0f), curMesh.positionDequantizationOffset);
+    dequantization = glm::scale(dequantization, curMesh.positionDequantizationScale);
+
+    return dequantization;
+}
+
+// Encodes the mesh into VertexFormatType. With a split position stream the attribute stream starts at curMesh.attributeStreamOffset
+// in the same buffer.
+template<typename VertexFormatType>
+void EncodeMeshVerticesForGPU(Mesh& curMesh, const std::string& meshName, std::vector<uint8_t>& encodedVertices) {
+
+    using PositionComponent = typename VertexFormatType::PositionComponent;
+    using TexCoordComponent = typename VertexFormatType::TexCoordComponent;
+
+    constexpr bool normalizePositions = VertexComponentTraits<PositionComponent>::normalizedToMeshBounds;
+    constexpr bool shiftTexCoordTiles = std::is_same_v<TexCoordComponent, Unorm16x2>;
+
+    if constexpr (normalizePositions) {
+        CalculatePositionDequantizationForMesh(curMesh);
+    }
+    else {
+        curMesh.positionDequantizationScale = glm::vec3(1.0f);
+        curMesh.positionDequantizationOffset = glm::vec3(0.0f);
+    }
+
+    glm::vec2 texCoordTileShift = glm::vec2(0.0f);
+    if constexpr (shiftTexCoordTiles) {
+        texCoordTileShift = GetTexCoordTileShiftForMesh(curMesh, meshName);
+    }
+
+    size_t vertexCount = curMesh.vertices.size();
+    encodedVertices.assign(vertexCount * VertexFormatType::bytesPerVertex, 0);
+
+    curMesh.attributeStreamOffset = VertexFormatType::splitPositionStream ? vertexCount * VertexFormatType::positionStride : 0;
+
+    uint8_t* positionStream = encodedVertices.data();
+    uint8_t* attributeStream = encodedVertices.data() + curMesh.attributeStreamOffset;
+
+    glm::vec3 inverseScale = 1.0f / curMesh.positionDequantizationScale;
+
+    for (size_t i = 0; i < vertexCount; i++)
+    {
+        const Vertex& vertex = curMesh.vertices[i];
+
+        PositionComponent encodedPosition;
+        EncodePositionComponent((vertex.position - curMesh.positionDequantizationOffset) * inverseScale, encodedPosition);
+
+        TexCoordComponent encodedTexCoord;
+        EncodeTexCoordComponent(vertex.texCoord - texCoordTileShift, encodedTexCoord);
+
+        memcpy(positionStream + i * VertexFormatType::positionStride + VertexFormatType::positionOffset, &encodedPosition, sizeof(encodedPosition));
+        memcpy(attributeStream + i * VertexFormatType::attributeStride + VertexFormatType::texCoordOffset, &encodedTexCoord, sizeof(encodedTexCoord));
+    }
+}
@@ -0,0 +1,116 @@
+#pragma once
+
+#include "DependencyIncludes.h"
+#include "StandardIncludes.h"
+
+// GPU side vertex layouts. The CPU keeps working with the full precision Vertex from Model.h (import, optimization, mesh cache)
+// and meshes are encoded into GPUVertexFormat on upload, see VertexFormatUtils.h.
+//
+// Quantized positions store the position normalized to the mesh bounds, the scale and offset to undo that are folded into the
+// model matrix so the vertex shader reads them like any other vec3.
+
+struct Snorm16x4 {
+    int16_t x, y, z, w;
+};
+
+struct Half16x4 {
+    uint16_t x, y, z, w;
+};
+
+struct Unorm16x2 {
+    uint16_t x, y;
+};
+
+struct Half16x2 {
+    uint16_t x, y;
+};
+
+template<typename ComponentType>
+struct VertexComponentTraits;
+
+template<>
+struct VertexComponentTraits<glm::vec3> {
+    static constexpr VkFormat format = VK_FORMAT_R32G32B32_SFLOAT;
+    static constexpr bool normalizedToMeshBounds = false;
+};
+
+template<>
+struct VertexComponentTraits<Snorm16x4> {
+    static constexpr VkFormat format = VK_FORMAT_R16G16B16A16_SNORM;
+    static constexpr bool normalizedToMeshBounds = true;
+};
+
+template<>
+struct VertexComponentTraits<Half16x4> {
+    static constexpr VkFormat format = VK_FORMAT_R16G16B16A16_SFLOAT;
+    static constexpr bool normalizedToMeshBounds = true;
+};
+
+template<>
+struct VertexComponentTraits<glm::vec2> {
+    static constexpr VkFormat format = VK_FORMAT_R32G32_SFLOAT;
+    static constexpr bool normalizedToMeshBounds = false;
+};
+
+template<>
+struct VertexComponentTraits<Unorm16x2> {
+    static constexpr VkFormat format = VK_FORMAT_R16G16_UNORM;
+    static constexpr bool normalizedToMeshBounds = false;
+};
+
+template<>
+struct VertexComponentTraits<Half16x2> {
+    static constexpr VkFormat format = VK_FORMAT_R16G16_SFLOAT;
+    static constexpr bool normalizedToMeshBounds = false;
+};
+
+// With SplitPositionStream positions live in binding 0 on their own and everything else in binding 1, so depth only passes
+// only fetch positions. Otherwise everything is interleaved in binding 0.
+template<typename PositionType, typename TexCoordType, bool SplitPositionStream>
+struct VertexFormat {
+
+    using PositionComponent = PositionType;
+    using TexCoordComponent = TexCoordType;
+
+    struct InterleavedVertex {
+        PositionType position;
+        TexCoordType texCoord;
+    };
+
+    struct PositionStreamVertex {
+        PositionType position;
+    };
+
+    struct AttributeStreamVertex {
+        TexCoordType texCoord;
+    };
+
+    static constexpr bool splitPositionStream = SplitPositionStream;
+    static constexpr uint32_t bindingCount = SplitPositionStream ? 2 : 1;
+
+    static constexpr uint32_t positionBinding = 0;
+    static constexpr uint32_t attributeBinding = SplitPositionStream ? 1 : 0;
+
+    static constexpr uint32_t positionStride = SplitPositionStream ? sizeof(PositionStreamVertex) : sizeof(InterleavedVertex);
+    static constexpr uint32_t attributeStride = SplitPositionStream ? sizeof(AttributeStreamVertex) : sizeof(InterleavedVertex);
+
+    static constexpr uint32_t positionOffset = SplitPositionStream ? offsetof(PositionStreamVertex, position) : offsetof(InterleavedVertex, position);
+    static constexpr uint32_t texCoordOffset = SplitPositionStream ? offsetof(AttributeStreamVertex, texCoord) : offsetof(InterleavedVertex, texCoord);
+
+    static constexpr uint32_t bytesPerVertex = SplitPositionStream ? positionStride + attributeStride : sizeof(InterleavedVertex);
+};
+
+// 20 bytes, same layout as Vertex.
+using FullPrecisionVertexFormat = VertexFormat<glm::vec3, glm::vec2, false>;
+
+// 12 bytes. Unorm16 texture coordinates only cover one [0, 1] tile, meshes with a wider range need HalfVertexFormat.
+using CompactVertexFormat = VertexFormat<Snorm16x4, Unorm16x2, false>;
+using CompactSplitVertexFormat = VertexFormat<Snorm16x4, Unorm16x2, true>;
+
+// 12 bytes, half floats keep repeating texture coordinates intact.
+using HalfVertexFormat = VertexFormat<Half16x4, Half16x2, false>;
+using HalfSplitVertexFormat = VertexFormat<Half16x4, Half16x2, true>;
+
+// Layout every mesh is uploaded in and every pipeline is built for. Half by default, it is as small as the compact formats and
+// does not clamp texture coordinates that repeat over more than one tile.
+using GPUVertexFormat = HalfVertexFormat;
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "VulkanInitUtils.h"
+#include "GpuTimelineUtils.h"
 
 VkCommandBuffer BeginSingleTimeCommands() {
 
@@ -84,7 +85,37 @@ void CreateBuffer_VMA(VkDeviceSize sizeInBytesOfBufferBeingPassedIn, VmaAllocati
 
 }
 
-void CreateImage_VMA(int texWidth, int texHeight, VkFormat imageFormat, VkImageTiling imageTiling, VkImageUsageFlags imageUsageFlags, VmaAllocationCreateFlags allocInfoFlags, VkMemoryPropertyFlags properties, VkImage& image, VmaAllocation& imageAllocation) {
+// Long lived buffers that keep receiving uploads in pieces, like the geometry arena. Ownership transfers only cover whole
+// uploads, so with a dedicated transfer family these are shared between both families instead.
+void CreateSharedBuffer_VMA(VkDeviceSize sizeInBytesOfBufferBeingPassedIn, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkBuffer& buffer, VmaAllocation& allocation) {
+
+    std::array<uint32_t, 2> queueFamilyIndices = { graphicsQueueFamilyIndex, transferQueueFamilyIndex };
+
+    VkBufferCreateInfo bufferInfo{};
+    bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    bufferInfo.size = sizeInBytesOfBufferBeingPassedIn;
+    bufferInfo.usage = usage;
+
+    if (graphicsQueueFamilyIndex != transferQueueFamilyIndex) {
+        bufferInfo.sharingMode = VK_SHARING_MODE_CONCURRENT;
+        bufferInfo.queueFamilyIndexCount = static_cast<uint32_t>(queueFamilyIndices.size());
+        bufferInfo.pQueueFamilyIndices = queueFamilyIndices.data();
+    }
+    else {
+        bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    }
+
+    VmaAllocationCreateInfo allocInfo = {};
+    allocInfo.usage = VMA_MEMORY_USAGE_AUTO;
+    allocInfo.requiredFlags = properties;
+
+    VkResult result = vmaCreateBuffer(vma_Allocator, &bufferInfo, &allocInfo, &buffer, &allocation, nullptr);
+    if (result != VK_SUCCESS) {
+        throw std::runtime_error("failed to create shared buffer using VMA!");
+    }
+}
+
+void CreateImage_VMA(int texWidth, int texHeight, VkFormat imageFormat, VkImageTiling imageTiling, VkImageUsageFlags imageUsageFlags, VmaAllocationCreateFlags allocInfoFlags, VkMemoryPropertyFlags properties, VkImage& image, VmaAllocation& imageAllocation, uint32_t mipLevels = 1) {
 
     VkImageCreateInfo imageInfo{};
     imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
@@ -92,7 +123,7 @@ void CreateImage_VMA(int texWidth, int texHeight, VkFormat imageFormat, VkImageT
     imageInfo.extent.width = static_cast<uint32_t>(texWidth);
     imageInfo.extent.height = static_cast<uint32_t>(texHeight);
     imageInfo.extent.depth = 1;
-    imageInfo.mipLevels = 1;
+    imageInfo.mipLevels = mipLevels;
     imageInfo.arrayLayers = 1;
     //imageInfo.format = VK_FORMAT_R8G8B8A8_SRGB;
     imageInfo.format = imageFormat;
@@ -231,7 +262,7 @@ void CopyBufferToImage(VkBuffer buffer, VkImage image, uint32_t width, uint32_t
 
 }
 
-VkImageView CreateImageView(VkImage image, VkFormat format, VkImageAspectFlags subresourceRangeAspectMask) {
+VkImageView CreateImageView(VkImage image, VkFormat format, VkImageAspectFlags subresourceRangeAspectMask, uint32_t mipLevels = 1) {
 
     VkImageViewCreateInfo viewInfo{};
     viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
@@ -240,7 +271,7 @@ VkImageView CreateImageView(VkImage image, VkFormat format, VkImageAspectFlags s
     viewInfo.format = format;
     viewInfo.subresourceRange.aspectMask = subresourceRangeAspectMask;
     viewInfo.subresourceRange.baseMipLevel = 0;
-    viewInfo.subresourceRange.levelCount = 1;
+    viewInfo.subresourceRange.levelCount = mipLevels;
     viewInfo.subresourceRange.baseArrayLayer = 0;
     viewInfo.subresourceRange.layerCount = 1;
 
@@ -250,4 +281,621 @@ VkImageView CreateImageView(VkImage image, VkFormat format, VkImageAspectFlags s
     }
 
     return imageView;
+}
+
+// Collects every pending buffer and image upload so they can go through one staging buffer and one transfer submit.
+// Source pointers only have to stay valid until SubmitUploadBatch has copied them into the staging buffer.
+struct PendingBufferUpload {
+
+    const void* sourceData = nullptr;
+    VkDeviceSize size = 0;
+    VkDeviceSize stagingOffset = 0;
+
+    VkBuffer dstBuffer = VK_NULL_HANDLE;
+    VkDeviceSize dstOffset = 0;
+
+    // Buffers created with CreateSharedBuffer_VMA are usable from both families and skip the ownership transfer.
+    bool transferOwnership = true;
+};
+
+struct PendingImageUpload {
+
+    const void* sourceData = nullptr;
+    VkDeviceSize size = 0;
+    VkDeviceSize stagingOffset = 0;
+
+    VkImage dstImage = VK_NULL_HANDLE;
+    uint32_t width = 0;
+    uint32_t height = 0;
+
+    // Offsets of the levels present in sourceData. When only the base level is there and generateMipmapsOnGPU is set
+    // the rest of the mipLevels are blitted from it.
+    uint32_t mipLevels = 1;
+    std::vector<VkDeviceSize> mipLevelDataOffsets = { 0 };
+    bool generateMipmapsOnGPU = false;
+};
+
+struct UploadBatch {
+
+    std::vector<PendingBufferUpload> bufferUploads = {};
+    std::vector<PendingImageUpload> imageUploads = {};
+
+    // Called once the source data has been copied into the staging buffer, used to free CPU side copies early.
+    std::vector<std::function<void()>> releaseSourceDataCallbacks = {};
+
+    VkDeviceSize totalStagingSize = 0;
+
+    // Handed out on first use, resources queued into this batch keep it so the renderer knows when they are safe to draw.
+    uint64_t uploadBatchID = 0;
+};
+
+// A submitted batch whose staging memory and command buffers are kept alive until the GPU is done with them.
+struct InFlightUploadBatch {
+
+    uint64_t uploadBatchID = 0;
+
+    VkBuffer vk_StagingBuffer = VK_NULL_HANDLE;
+    VmaAllocation vma_StagingBufferAllocation = VK_NULL_HANDLE;
+
+    VkCommandBuffer vk_TransferCommandBuffer = VK_NULL_HANDLE;
+    VkFence vk_TransferFinishedFence = VK_NULL_HANDLE;
+
+    // Only used with a dedicated transfer family, the graphics queue has to acquire ownership before anything can be drawn.
+    VkSemaphore vk_TransferFinishedSemaphore = VK_NULL_HANDLE;
+    VkCommandBuffer vk_AcquireCommandBuffer = VK_NULL_HANDLE;
+    VkFence vk_AcquireFinishedFence = VK_NULL_HANDLE;
+    bool acquireSubmitted = false;
+
+    // With the GPU timeline there are no fences or binary semaphores, the batch is done once its last submission's value is reached.
+    uint64_t finishedTimelineValue = 0;
+};
+
+uint64_t nextUploadBatchID = 1;
+uint64_t lastUsableUploadBatchID = 0;
+std::vector<InFlightUploadBatch> inFlightUploadBatches = {};
+
+const VkDeviceSize UPLOAD_BATCH_STAGING_ALIGNMENT = 16;
+
+bool UsesDedicatedTransferQueue() {
+    return transferQueueFamilyIndex != graphicsQueueFamilyIndex;
+}
+
+uint64_t GetUploadBatchID(UploadBatch& batch) {
+
+    if (batch.uploadBatchID == 0) {
+        batch.uploadBatchID = nextUploadBatchID++;
+    }
+
+    return batch.uploadBatchID;
+}
+
+bool IsUploadBatchUsable(uint64_t uploadBatchID) {
+    return uploadBatchID <= lastUsableUploadBatchID;
+}
+
+VkDeviceSize ReserveUploadBatchStagingRange(UploadBatch& batch, VkDeviceSize size) {
+
+    VkDeviceSize stagingOffset = (batch.totalStagingSize + UPLOAD_BATCH_STAGING_ALIGNMENT - 1) & ~(UPLOAD_BATCH_STAGING_ALIGNMENT - 1);
+    batch.totalStagingSize = stagingOffset + size;
+
+    return stagingOffset;
+}
+
+void QueueBufferUpload(UploadBatch& batch, const void* sourceData, VkDeviceSize size, VkBuffer dstBuffer, VkDeviceSize dstOffset = 0, bool transferOwnership = true) {
+
+    PendingBufferUpload bufferUpload{};
+    bufferUpload.sourceData = sourceData;
+    bufferUpload.size = size;
+    bufferUpload.stagingOffset = ReserveUploadBatchStagingRange(batch, size);
+    bufferUpload.dstBuffer = dstBuffer;
+    bufferUpload.dstOffset = dstOffset;
+    bufferUpload.transferOwnership = transferOwnership;
+
+    batch.bufferUploads.push_back(bufferUpload);
+}
+
+// The image is expected in VK_IMAGE_LAYOUT_UNDEFINED and ends up in VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL with every mip level filled.
+void QueueImageUpload(UploadBatch& batch, const void* sourceData, VkDeviceSize size, VkImage dstImage, uint32_t width, uint32_t height, uint32_t mipLevels = 1, std::vector<VkDeviceSize> mipLevelDataOffsets = { 0 }, bool generateMipmapsOnGPU = false) {
+
+    PendingImageUpload imageUpload{};
+    imageUpload.sourceData = sourceData;
+    imageUpload.size = size;
+    imageUpload.stagingOffset = ReserveUploadBatchStagingRange(batch, size);
+    imageUpload.dstImage = dstImage;
+    imageUpload.width = width;
+    imageUpload.height = height;
+    imageUpload.mipLevels = mipLevels;
+    imageUpload.mipLevelDataOffsets = std::move(mipLevelDataOffsets);
+    imageUpload.generateMipmapsOnGPU = generateMipmapsOnGPU;
+
+    batch.imageUploads.push_back(imageUpload);
+}
+
+// Covers every mip level unless a single level is asked for.
+VkImageMemoryBarrier MakeColorImageLayoutBarrier(VkImage image, VkImageLayout oldLayout, VkImageLayout newLayout, VkAccessFlags srcAccessMask, VkAccessFlags dstAccessMask, uint32_t srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED, uint32_t dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED, uint32_t baseMipLevel = 0, uint32_t levelCount = VK_REMAINING_MIP_LEVELS) {
+
+    VkImageMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    barrier.oldLayout = oldLayout;
+    barrier.newLayout = newLayout;
+    barrier.srcAccessMask = srcAccessMask;
+    barrier.dstAccessMask = dstAccessMask;
+
+    barrier.srcQueueFamilyIndex = srcQueueFamilyIndex;
+    barrier.dstQueueFamilyIndex = dstQueueFamilyIndex;
+
+    barrier.image = image;
+    barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    barrier.subresourceRange.baseMipLevel = baseMipLevel;
+    barrier.subresourceRange.levelCount = levelCount;
+    barrier.subresourceRange.baseArrayLayer = 0;
+    barrier.subresourceRange.layerCount = 1;
+
+    return barrier;
+}
+
+bool SupportsLinearBlitForFormat(VkFormat format) {
+
+    VkFormatProperties formatProperties;
+    vkGetPhysicalDeviceFormatProperties(vk_PhysicalDevice, format, &formatProperties);
+
+    VkFormatFeatureFlags requiredFeatures = VK_FORMAT_FEATURE_BLIT_SRC_BIT | VK_FORMAT_FEATURE_BLIT_DST_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT;
+    return (formatProperties.optimalTilingFeatures & requiredFeatures) == requiredFeatures;
+}
+
+// Needs a graphics queue. Expects every level in VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL with the base level written,
+// leaves every level in VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL.
+void RecordMipmapGenerationCommands(VkCommandBuffer commandBuffer, VkImage image, uint32_t width, uint32_t height, uint32_t mipLevels) {
+
+    int32_t mipWidth = static_cast<int32_t>(width);
+    int32_t mipHeight = static_cast<int32_t>(height);
+
+    for (uint32_t level = 1; level < mipLevels; level++)
+    {
+        VkImageMemoryBarrier toTransferSrc = MakeColorImageLayoutBarrier(image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_TRANSFER_READ_BIT, VK_QUEUE_FAMILY_IGNORED, VK_QUEUE_FAMILY_IGNORED, level - 1, 1);
+        vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 1, &toTransferSrc);
+
+        VkImageBlit blit{};
+        blit.srcOffsets[0] = { 0, 0, 0 };
+        blit.srcOffsets[1] = { mipWidth, mipHeight, 1 };
+        blit.srcSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        blit.srcSubresource.mipLevel = level - 1;
+        blit.srcSubresource.baseArrayLayer = 0;
+        blit.srcSubresource.layerCount = 1;
+
+        blit.dstOffsets[0] = { 0, 0, 0 };
+        blit.dstOffsets[1] = { mipWidth > 1 ? mipWidth / 2 : 1, mipHeight > 1 ? mipHeight / 2 : 1, 1 };
+        blit.dstSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        blit.dstSubresource.mipLevel = level;
+        blit.dstSubresource.baseArrayLayer = 0;
+        blit.dstSubresource.layerCount = 1;
+
+        vkCmdBlitImage(commandBuffer, image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &blit, VK_FILTER_LINEAR);
+
+        VkImageMemoryBarrier toShaderRead = MakeColorImageLayoutBarrier(image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_ACCESS_TRANSFER_READ_BIT, VK_ACCESS_SHADER_READ_BIT, VK_QUEUE_FAMILY_IGNORED, VK_QUEUE_FAMILY_IGNORED, level - 1, 1);
+        vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 0, nullptr, 0, nullptr, 1, &toShaderRead);
+
+        mipWidth = mipWidth > 1 ? mipWidth / 2 : 1;
+        mipHeight = mipHeight > 1 ? mipHeight / 2 : 1;
+    }
+
+    VkImageMemoryBarrier lastLevelToShaderRead = MakeColorImageLayoutBarrier(image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT, VK_QUEUE_FAMILY_IGNORED, VK_QUEUE_FAMILY_IGNORED, mipLevels - 1, 1);
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 0, nullptr, 0, nullptr, 1, &lastLevelToShaderRead);
+}
+
+VkBufferMemoryBarrier MakeBufferOwnershipBarrier(const PendingBufferUpload& bufferUpload, VkAccessFlags srcAccessMask, VkAccessFlags dstAccessMask) {
+
+    VkBufferMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+    barrier.srcAccessMask = srcAccessMask;
+    barrier.dstAccessMask = dstAccessMask;
+
+    barrier.srcQueueFamilyIndex = transferQueueFamilyIndex;
+    barrier.dstQueueFamilyIndex = graphicsQueueFamilyIndex;
+
+    barrier.buffer = bufferUpload.dstBuffer;
+    barrier.offset = bufferUpload.dstOffset;
+    barrier.size = bufferUpload.size;
+
+    return barrier;
+}
+
+const VkAccessFlags UPLOADED_BUFFER_READ_ACCESS = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT | VK_ACCESS_UNIFORM_READ_BIT | VK_ACCESS_SHADER_READ_BIT;
+const VkPipelineStageFlags UPLOADED_RESOURCE_READ_STAGES = VK_PIPELINE_STAGE_VERTEX_INPUT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+
+// Recorded on the transfer queue. With a dedicated transfer family the final barriers are the release half of the ownership transfer,
+// otherwise they make the writes visible to the graphics stages directly.
+void RecordUploadBatchCommands(VkCommandBuffer commandBuffer, const UploadBatch& batch, VkBuffer stagingBuffer) {
+
+    bool releaseToGraphicsFamily = UsesDedicatedTransferQueue();
+
+    std::vector<VkImageMemoryBarrier> toTransferDstBarriers;
+    std::vector<VkImageMemoryBarrier> toShaderReadBarriers;
+    std::vector<VkBufferMemoryBarrier> bufferReleaseBarriers;
+
+    for (const PendingImageUpload& imageUpload : batch.imageUploads) {
+        toTransferDstBarriers.push_back(MakeColorImageLayoutBarrier(imageUpload.dstImage, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 0, VK_ACCESS_TRANSFER_WRITE_BIT));
+
+        // Blits need the graphics queue, these images keep their transfer layout until the mip chain is generated there.
+        if (releaseToGraphicsFamily && imageUpload.generateMipmapsOnGPU) {
+            toShaderReadBarriers.push_back(MakeColorImageLayoutBarrier(imageUpload.dstImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_ACCESS_TRANSFER_WRITE_BIT, 0, transferQueueFamilyIndex, graphicsQueueFamilyIndex));
+        }
+        else if (releaseToGraphicsFamily) {
+            toShaderReadBarriers.push_back(MakeColorImageLayoutBarrier(imageUpload.dstImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_ACCESS_TRANSFER_WRITE_BIT, 0, transferQueueFamilyIndex, graphicsQueueFamilyIndex));
+        }
+        else if (imageUpload.generateMipmapsOnGPU) {
+            continue;
+        }
+        else {
+            toShaderReadBarriers.push_back(MakeColorImageLayoutBarrier(imageUpload.dstImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT));
+        }
+    }
+
+    if (!toTransferDstBarriers.empty()) {
+        vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, static_cast<uint32_t>(toTransferDstBarriers.size()), toTransferDstBarriers.data());
+    }
+
+    for (const PendingBufferUpload& bufferUpload : batch.bufferUploads) {
+
+        VkBufferCopy copyRegion{};
+        copyRegion.srcOffset = bufferUpload.stagingOffset;
+        copyRegion.dstOffset = bufferUpload.dstOffset;
+        copyRegion.size = bufferUpload.size;
+        vkCmdCopyBuffer(commandBuffer, stagingBuffer, bufferUpload.dstBuffer, 1, &copyRegion);
+
+        if (releaseToGraphicsFamily && bufferUpload.transferOwnership) {
+            bufferReleaseBarriers.push_back(MakeBufferOwnershipBarrier(bufferUpload, VK_ACCESS_TRANSFER_WRITE_BIT, 0));
+        }
+    }
+
+    for (const PendingImageUpload& imageUpload : batch.imageUploads) {
+
+        std::vector<VkBufferImageCopy> regions(imageUpload.mipLevelDataOffsets.size());
+
+        for (uint32_t level = 0; level < regions.size(); level++)
+        {
+            VkBufferImageCopy& region = regions[level];
+            region.bufferOffset = imageUpload.stagingOffset + imageUpload.mipLevelDataOffsets[level];
+            region.bufferRowLength = 0;
+            region.bufferImageHeight = 0;
+
+            region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+            region.imageSubresource.mipLevel = level;
+            region.imageSubresource.baseArrayLayer = 0;
+            region.imageSubresource.layerCount = 1;
+
+            region.imageOffset = { 0, 0, 0 };
+            region.imageExtent = { std::max(imageUpload.width >> level, 1u), std::max(imageUpload.height >> level, 1u), 1 };
+        }
+
+        vkCmdCopyBufferToImage(commandBuffer, stagingBuffer, imageUpload.dstImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, static_cast<uint32_t>(regions.size()), regions.data());
+    }
+
+    if (releaseToGraphicsFamily) {
+        vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, 0, nullptr, static_cast<uint32_t>(bufferReleaseBarriers.size()), bufferReleaseBarriers.data(), static_cast<uint32_t>(toShaderReadBarriers.size()), toShaderReadBarriers.data());
+        return;
+    }
+
+    VkMemoryBarrier bufferWritesBarrier{};
+    bufferWritesBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    bufferWritesBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    bufferWritesBarrier.dstAccessMask = UPLOADED_BUFFER_READ_ACCESS;
+
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, UPLOADED_RESOURCE_READ_STAGES, 0, 1, &bufferWritesBarrier, 0, nullptr, static_cast<uint32_t>(toShaderReadBarriers.size()), toShaderReadBarriers.data());
+
+    for (const PendingImageUpload& imageUpload : batch.imageUploads) {
+        if (imageUpload.generateMipmapsOnGPU) {
+            RecordMipmapGenerationCommands(commandBuffer, imageUpload.dstImage, imageUpload.width, imageUpload.height, imageUpload.mipLevels);
+        }
+    }
+}
+
+// Acquire half of the ownership transfer, recorded on the graphics queue with the exact same ranges and layouts as the release.
+void RecordUploadBatchAcquireCommands(VkCommandBuffer commandBuffer, const UploadBatch& batch) {
+
+    std::vector<VkBufferMemoryBarrier> bufferAcquireBarriers;
+    std::vector<VkImageMemoryBarrier> imageAcquireBarriers;
+
+    // Shared buffers need nothing more than the semaphore wait this is submitted with.
+    for (const PendingBufferUpload& bufferUpload : batch.bufferUploads) {
+        if (bufferUpload.transferOwnership) {
+            bufferAcquireBarriers.push_back(MakeBufferOwnershipBarrier(bufferUpload, 0, UPLOADED_BUFFER_READ_ACCESS));
+        }
+    }
+
+    for (const PendingImageUpload& imageUpload : batch.imageUploads) {
+
+        if (imageUpload.generateMipmapsOnGPU) {
+            imageAcquireBarriers.push_back(MakeColorImageLayoutBarrier(imageUpload.dstImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 0, VK_ACCESS_TRANSFER_READ_BIT | VK_ACCESS_TRANSFER_WRITE_BIT, transferQueueFamilyIndex, graphicsQueueFamilyIndex));
+        }
+        else {
+            imageAcquireBarriers.push_back(MakeColorImageLayoutBarrier(imageUpload.dstImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, 0, VK_ACCESS_SHADER_READ_BIT, transferQueueFamilyIndex, graphicsQueueFamilyIndex));
+        }
+    }
+
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, UPLOADED_RESOURCE_READ_STAGES | VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, static_cast<uint32_t>(bufferAcquireBarriers.size()), bufferAcquireBarriers.data(), static_cast<uint32_t>(imageAcquireBarriers.size()), imageAcquireBarriers.data());
+
+    for (const PendingImageUpload& imageUpload : batch.imageUploads) {
+        if (imageUpload.generateMipmapsOnGPU) {
+            RecordMipmapGenerationCommands(commandBuffer, imageUpload.dstImage, imageUpload.width, imageUpload.height, imageUpload.mipLevels);
+        }
+    }
+}
+
+VkCommandBuffer AllocateOneTimeCommandBuffer(VkCommandPool commandPool) {
+
+    VkCommandBufferAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+    allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    allocInfo.commandPool = commandPool;
+    allocInfo.commandBufferCount = 1;
+
+    VkCommandBuffer commandBuffer;
+    if (vkAllocateCommandBuffers(vk_LogicalDevice, &allocInfo, &commandBuffer) != VK_SUCCESS) {
+        throw std::runtime_error("failed to allocate upload batch command buffer!");
+    }
+
+    VkCommandBufferBeginInfo beginInfo{};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+    vkBeginCommandBuffer(commandBuffer, &beginInfo);
+
+    return commandBuffer;
+}
+
+VkFence CreateUnsignaledFence() {
+
+    VkFenceCreateInfo fenceInfo{};
+    fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+
+    VkFence fence;
+    if (vkCreateFence(vk_LogicalDevice, &fenceInfo, nullptr, &fence) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create upload batch fence!");
+    }
+
+    return fence;
+}
+
+// The transfer signals the transfer queue's timeline. With a dedicated transfer queue the ownership acquire is submitted right away,
+// waiting for that value on the GPU and signalling the graphics timeline, so the CPU never has to see the transfer finish first.
+void SubmitUploadBatchCommandsOnTimeline(const UploadBatch& batch, InFlightUploadBatch& inFlightBatch) {
+
+    TimelineSemaphore& transferTimeline = GetTransferQueueTimeline();
+    uint64_t transferFinishedValue = AdvanceTimeline(transferTimeline);
+
+    VkTimelineSemaphoreSubmitInfo transferTimelineInfo{};
+    transferTimelineInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+    transferTimelineInfo.signalSemaphoreValueCount = 1;
+    transferTimelineInfo.pSignalSemaphoreValues = &transferFinishedValue;
+
+    VkSubmitInfo submitInfo{};
+    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submitInfo.pNext = &transferTimelineInfo;
+    submitInfo.commandBufferCount = 1;
+    submitInfo.pCommandBuffers = &inFlightBatch.vk_TransferCommandBuffer;
+    submitInfo.signalSemaphoreCount = 1;
+    submitInfo.pSignalSemaphores = &transferTimeline.vk_Semaphore;
+
+    if (vkQueueSubmit(vk_TransferQueue, 1, &submitInfo, VK_NULL_HANDLE) != VK_SUCCESS) {
+        throw std::runtime_error("failed to submit upload batch!");
+    }
+
+    inFlightBatch.finishedTimelineValue = transferFinishedValue;
+
+    if (UsesDedicatedTransferQueue()) {
+
+        inFlightBatch.vk_AcquireCommandBuffer = AllocateOneTimeCommandBuffer(vk_CommandPool);
+        RecordUploadBatchAcquireCommands(inFlightBatch.vk_AcquireCommandBuffer, batch);
+        vkEndCommandBuffer(inFlightBatch.vk_AcquireCommandBuffer);
+
+        uint64_t acquireFinishedValue = AdvanceTimeline(GpuTimeline::graphics);
+
+        VkTimelineSemaphoreSubmitInfo acquireTimelineInfo{};
+        acquireTimelineInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+        acquireTimelineInfo.waitSemaphoreValueCount = 1;
+        acquireTimelineInfo.pWaitSemaphoreValues = &transferFinishedValue;
+        acquireTimelineInfo.signalSemaphoreValueCount = 1;
+        acquireTimelineInfo.pSignalSemaphoreValues = &acquireFinishedValue;
+
+        VkPipelineStageFlags waitStage = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+
+        VkSubmitInfo acquireSubmitInfo{};
+        acquireSubmitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+        acquireSubmitInfo.pNext = &acquireTimelineInfo;
+        acquireSubmitInfo.waitSemaphoreCount = 1;
+        acquireSubmitInfo.pWaitSemaphores = &transferTimeline.vk_Semaphore;
+        acquireSubmitInfo.pWaitDstStageMask = &waitStage;
+        acquireSubmitInfo.commandBufferCount = 1;
+        acquireSubmitInfo.pCommandBuffers = &inFlightBatch.vk_AcquireCommandBuffer;
+        acquireSubmitInfo.signalSemaphoreCount = 1;
+        acquireSubmitInfo.pSignalSemaphores = &GpuTimeline::graphics.vk_Semaphore;
+
+        if (vkQueueSubmit(vk_GraphicsQueue, 1, &acquireSubmitInfo, VK_NULL_HANDLE) != VK_SUCCESS) {
+            throw std::runtime_error("failed to submit upload batch ownership acquire!");
+        }
+
+        inFlightBatch.acquireSubmitted = true;
+        inFlightBatch.finishedTimelineValue = acquireFinishedValue;
+    }
+
+    // Either way every later graphics submission is ordered behind the upload.
+    lastUsableUploadBatchID = inFlightBatch.uploadBatchID;
+}
+
+// Copies every pending upload into one staging buffer and submits all copies on the transfer queue without waiting.
+// The staging buffer is released by ProcessCompletedUploadBatches once the GPU has finished with it.
+void SubmitUploadBatch(UploadBatch& batch) {
+
+    if (batch.bufferUploads.empty() && batch.imageUploads.empty()) {
+        return;
+    }
+
+    InFlightUploadBatch inFlightBatch{};
+    inFlightBatch.uploadBatchID = GetUploadBatchID(batch);
+
+    CreateBuffer_VMA(batch.totalStagingSize, VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, inFlightBatch.vk_StagingBuffer, inFlightBatch.vma_StagingBufferAllocation);
+    vmaSetAllocationName(vma_Allocator, inFlightBatch.vma_StagingBufferAllocation, "Upload Batch Staging Buffer");
+
+    void* mappedStagingMemory = nullptr;
+    if (vmaMapMemory(vma_Allocator, inFlightBatch.vma_StagingBufferAllocation, &mappedStagingMemory) != VK_SUCCESS) {
+        throw std::runtime_error("failed to map upload batch staging buffer!");
+    }
+
+    for (const PendingBufferUpload& bufferUpload : batch.bufferUploads) {
+        memcpy(static_cast<uint8_t*>(mappedStagingMemory) + bufferUpload.stagingOffset, bufferUpload.sourceData, static_cast<size_t>(bufferUpload.size));
+    }
+
+    for (const PendingImageUpload& imageUpload : batch.imageUploads) {
+        memcpy(static_cast<uint8_t*>(mappedStagingMemory) + imageUpload.stagingOffset, imageUpload.sourceData, static_cast<size_t>(imageUpload.size));
+    }
+
+    vmaUnmapMemory(vma_Allocator, inFlightBatch.vma_StagingBufferAllocation);
+
+    for (std::function<void()>& releaseSourceData : batch.releaseSourceDataCallbacks) {
+        releaseSourceData();
+    }
+
+    inFlightBatch.vk_TransferCommandBuffer = AllocateOneTimeCommandBuffer(vk_TransferCommandPool);
+    RecordUploadBatchCommands(inFlightBatch.vk_TransferCommandBuffer, batch, inFlightBatch.vk_StagingBuffer);
+    vkEndCommandBuffer(inFlightBatch.vk_TransferCommandBuffer);
+
+    if (IsGpuTimelineActive()) {
+        SubmitUploadBatchCommandsOnTimeline(batch, inFlightBatch);
+    }
+    else {
+        inFlightBatch.vk_TransferFinishedFence = CreateUnsignaledFence();
+
+        VkSubmitInfo submitInfo{};
+        submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+        submitInfo.commandBufferCount = 1;
+        submitInfo.pCommandBuffers = &inFlightBatch.vk_TransferCommandBuffer;
+
+        if (UsesDedicatedTransferQueue()) {
+
+            VkSemaphoreCreateInfo semaphoreInfo{};
+            semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+
+            if (vkCreateSemaphore(vk_LogicalDevice, &semaphoreInfo, nullptr, &inFlightBatch.vk_TransferFinishedSemaphore) != VK_SUCCESS) {
+                throw std::runtime_error("failed to create upload batch semaphore!");
+            }
+
+            // Recorded now while the batch still knows its ranges, submitted once the transfer has finished.
+            inFlightBatch.vk_AcquireCommandBuffer = AllocateOneTimeCommandBuffer(vk_CommandPool);
+            RecordUploadBatchAcquireCommands(inFlightBatch.vk_AcquireCommandBuffer, batch);
+            vkEndCommandBuffer(inFlightBatch.vk_AcquireCommandBuffer);
+
+            inFlightBatch.vk_AcquireFinishedFence = CreateUnsignaledFence();
+
+            submitInfo.signalSemaphoreCount = 1;
+            submitInfo.pSignalSemaphores = &inFlightBatch.vk_TransferFinishedSemaphore;
+        }
+
+        if (vkQueueSubmit(vk_TransferQueue, 1, &submitInfo, inFlightBatch.vk_TransferFinishedFence) != VK_SUCCESS) {
+            throw std::runtime_error("failed to submit upload batch!");
+        }
+
+        // Without an ownership transfer the transfer queue is the graphics queue, so submission order already covers every later frame.
+        if (!UsesDedicatedTransferQueue()) {
+            lastUsableUploadBatchID = inFlightBatch.uploadBatchID;
+        }
+    }
+
+    std::cout << "Submitted upload batch " << inFlightBatch.uploadBatchID << " with " << batch.bufferUploads.size() << " buffers and " << batch.imageUploads.size() << " images. Staging size := " << batch.totalStagingSize << " bytes." << std::endl;
+
+    inFlightUploadBatches.push_back(inFlightBatch);
+
+    batch = UploadBatch();
+}
+
+void ReleaseInFlightUploadBatch(InFlightUploadBatch& inFlightBatch) {
+
+    vkFreeCommandBuffers(vk_LogicalDevice, vk_TransferCommandPool, 1, &inFlightBatch.vk_TransferCommandBuffer);
+    vkDestroyFence(vk_LogicalDevice, inFlightBatch.vk_TransferFinishedFence, nullptr);
+
+    if (inFlightBatch.vk_AcquireCommandBuffer != VK_NULL_HANDLE) {
+        vkFreeCommandBuffers(vk_LogicalDevice, vk_CommandPool, 1, &inFlightBatch.vk_AcquireCommandBuffer);
+        vkDestroyFence(vk_LogicalDevice, inFlightBatch.vk_AcquireFinishedFence, nullptr);
+        vkDestroySemaphore(vk_LogicalDevice, inFlightBatch.vk_TransferFinishedSemaphore, nullptr);
+    }
+
+    vmaDestroyBuffer(vma_Allocator, inFlightBatch.vk_StagingBuffer, inFlightBatch.vma_StagingBufferAllocation);
+}
+
+bool IsInFlightUploadBatchFinished(const InFlightUploadBatch& inFlightBatch) {
+
+    // Ends on the graphics timeline when there was an acquire and on the transfer queue's otherwise.
+    if (IsGpuTimelineActive()) {
+        return IsTimelineValueReached(inFlightBatch.vk_AcquireCommandBuffer != VK_NULL_HANDLE ? GpuTimeline::graphics : GetTransferQueueTimeline(), inFlightBatch.finishedTimelineValue);
+    }
+
+    if (inFlightBatch.vk_AcquireCommandBuffer == VK_NULL_HANDLE) {
+        return vkGetFenceStatus(vk_LogicalDevice, inFlightBatch.vk_TransferFinishedFence) == VK_SUCCESS;
+    }
+
+    return inFlightBatch.acquireSubmitted && vkGetFenceStatus(vk_LogicalDevice, inFlightBatch.vk_AcquireFinishedFence) == VK_SUCCESS;
+}
+
+// Polled once per frame. Never blocks, batches are walked in submission order since the transfer queue finishes them in that order.
+void ProcessCompletedUploadBatches() {
+
+    for (InFlightUploadBatch& inFlightBatch : inFlightUploadBatches) {
+
+        if (inFlightBatch.vk_AcquireCommandBuffer == VK_NULL_HANDLE || inFlightBatch.acquireSubmitted) {
+            continue;
+        }
+
+        if (vkGetFenceStatus(vk_LogicalDevice, inFlightBatch.vk_TransferFinishedFence) != VK_SUCCESS) {
+            break;
+        }
+
+        VkPipelineStageFlags waitStage = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+
+        VkSubmitInfo submitInfo{};
+        submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+        submitInfo.waitSemaphoreCount = 1;
+        submitInfo.pWaitSemaphores = &inFlightBatch.vk_TransferFinishedSemaphore;
+        submitInfo.pWaitDstStageMask = &waitStage;
+        submitInfo.commandBufferCount = 1;
+        submitInfo.pCommandBuffers = &inFlightBatch.vk_AcquireCommandBuffer;
+
+        if (vkQueueSubmit(vk_GraphicsQueue, 1, &submitInfo, inFlightBatch.vk_AcquireFinishedFence) != VK_SUCCESS) {
+            throw std::runtime_error("failed to submit upload batch ownership acquire!");
+        }
+
+        inFlightBatch.acquireSubmitted = true;
+
+        // Every graphics submission after this point is ordered behind the acquire barrier.
+        lastUsableUploadBatchID = inFlightBatch.uploadBatchID;
+    }
+
+    size_t numFinishedBatches = 0;
+    while (numFinishedBatches < inFlightUploadBatches.size() && IsInFlightUploadBatchFinished(inFlightUploadBatches[numFinishedBatches])) {
+        ReleaseInFlightUploadBatch(inFlightUploadBatches[numFinishedBatches]);
+        numFinishedBatches++;
+    }
+
+    inFlightUploadBatches.erase(inFlightUploadBatches.begin(), inFlightUploadBatches.begin() + numFinishedBatches);
+}
+
+// Blocks until every submitted batch is usable and released, used on shutdown.
+void FinishAllUploadBatches() {
+
+    while (!inFlightUploadBatches.empty()) {
+
+        InFlightUploadBatch& oldestBatch = inFlightUploadBatches.front();
+
+        if (IsGpuTimelineActive()) {
+            WaitForTimelineValue(oldestBatch.vk_AcquireCommandBuffer != VK_NULL_HANDLE ? GpuTimeline::graphics : GetTransferQueueTimeline(), oldestBatch.finishedTimelineValue);
+            ProcessCompletedUploadBatches();
+            continue;
+        }
+
+        vkWaitForFences(vk_LogicalDevice, 1, &oldestBatch.vk_TransferFinishedFence, VK_TRUE, UINT64_MAX);
+        if (oldestBatch.acquireSubmitted) {
+            vkWaitForFences(vk_LogicalDevice, 1, &oldestBatch.vk_AcquireFinishedFence, VK_TRUE, UINT64_MAX);
+        }
+
+        ProcessCompletedUploadBatches();
+    }
 }
\ No newline at end of file
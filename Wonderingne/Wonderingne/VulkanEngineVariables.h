@@ -3,6 +3,7 @@
 #include "DependencyIncludes.h"
 #include "StandardIncludes.h"
 #include "EngineConstants.h"
+#include "PresentationPolicy.h"
 
 struct SwapChainSupportDetails {
     VkSurfaceCapabilitiesKHR capabilities;
@@ -18,11 +19,37 @@ VkSurfaceKHR vk_Surface;
 VkPhysicalDevice vk_PhysicalDevice = VK_NULL_HANDLE;
 VkDevice vk_LogicalDevice;
 
+// Set when the device supports BC formats, KTX2 textures fall back to their source images otherwise.
+bool textureCompressionBCEnabled = false;
+
+// Without it every indirect draw is issued with a draw count of 1.
+bool multiDrawIndirectEnabled = false;
+
+// VK_KHR_draw_indirect_count, loaded at device creation since the device may only support Vulkan 1.1.
+bool drawIndirectCountEnabled = false;
+PFN_vkCmdDrawIndexedIndirectCountKHR pfn_vkCmdDrawIndexedIndirectCount = nullptr;
+
+// Vulkan 1.2 descriptor indexing with partially bound, update after bind sampled image arrays and non uniform indexing.
+bool bindlessTexturesEnabled = false;
+
+// Vulkan 1.2 timeline semaphores, see GpuTimeline.h.
+bool timelineSemaphoresEnabled = false;
+
+// VK_KHR_dynamic_rendering, loaded at device creation like VK_KHR_draw_indirect_count, see DynamicRenderingUtils.h.
+bool dynamicRenderingEnabled = false;
+PFN_vkCmdBeginRenderingKHR pfn_vkCmdBeginRendering = nullptr;
+PFN_vkCmdEndRenderingKHR pfn_vkCmdEndRendering = nullptr;
+
 VmaAllocator vma_Allocator;
 
 VkQueue vk_GraphicsQueue;
 VkQueue vk_PresentQueue;
 
+// Same as the graphics queue and family when the device has no separate transfer family.
+VkQueue vk_TransferQueue;
+uint32_t graphicsQueueFamilyIndex = 0;
+uint32_t transferQueueFamilyIndex = 0;
+
 VkSwapchainKHR vk_SwapChain;
 std::vector<VkImage> vk_SwapChainImages;
 VkFormat vk_SwapChainImageFormat;
@@ -32,12 +59,21 @@ std::vector<VkImageView> vk_SwapChainImageViews;
 
 VkRenderPass vk_RenderPass;
 VkPipelineLayout vk_PipelineLayout;
+// Starts at USE_DEPTH_PREPASS, flipped at runtime to compare frame times with and without the pre-pass.
+bool depthPrepassEnabled = USE_DEPTH_PREPASS;
+
+// World function variants of the direct and indirect shaders, owned by PipelineVariants.
 VkPipeline vk_GraphicsPipeline;
+VkPipeline vk_IndirectGraphicsPipeline = VK_NULL_HANDLE;
 
 std::vector<VkFramebuffer> vk_SwapChainFramebuffers;
 
 VkCommandPool vk_CommandPool;
 
+// The primary command buffer of each frame in flight comes from its own pool, reset as a whole at the start of the frame.
+std::array<VkCommandPool, MAX_FRAMES_IN_FLIGHT> vk_FrameCommandPools;
+VkCommandPool vk_TransferCommandPool;
+
 std::vector<VkCommandBuffer> vk_CommandBuffers;
 std::vector<VkSemaphore> renderFinishedSemaphores;
 std::vector<VkFence> inFlightFences;
@@ -49,6 +85,11 @@ const std::vector<const char*> deviceExtensions = { VK_KHR_SWAPCHAIN_EXTENSION_N
 uint32_t indexOfDataForCurrentFrame = 0;
 bool framebufferResized = false;
 
+// Frames cycle through the first presentationPolicy.framesInFlight of the per frame resources. Requests are applied between frames.
+PresentationPolicy presentationPolicy;
+PresentationPolicy requestedPresentationPolicy;
+bool presentationPolicyChangeRequested = false;
+
 VkSampler vk_TextureSampler;
 
 VkImage vk_DepthImage;
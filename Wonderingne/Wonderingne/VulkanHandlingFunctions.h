@@ -14,6 +14,11 @@
 #include "CameraUtils.h"
 #include "ModelUtils.h"
 #include "UIUtils.h"
+#include "IndirectDrawUtils.h"
+#include "DrawCullingUtils.h"
+#include "OcclusionCullingUtils.h"
+#include "BindlessTexturesUtils.h"
+#include "CommandRecordingUtils.h"
 
 
 void InitVKInstance(const std::string applicationName) {
@@ -35,7 +40,7 @@ void InitVKInstance(const std::string applicationName) {
     appInfo.applicationVersion = VK_MAKE_API_VERSION(0, 0, 1, 0);
     appInfo.pEngineName = ENGINE_NAME.c_str();
     appInfo.engineVersion = VK_MAKE_API_VERSION(0, 0, 1, 0);
-    appInfo.apiVersion = VK_API_VERSION_1_1;
+    appInfo.apiVersion = USE_BINDLESS_TEXTURES || USE_TIMELINE_SEMAPHORES || USE_DYNAMIC_RENDERING ? VK_API_VERSION_1_2 : VK_API_VERSION_1_1;
     //appInfo.apiVersion = VK_API_VERSION_1_4;
 
     VkInstanceCreateInfo createInfo{};
@@ -138,6 +143,9 @@ void CreateLogicalDevice() {
 
     std::vector<VkDeviceQueueCreateInfo> queueCreateInfos;
     std::set<uint32_t> uniqueQueueFamilies = { indices.graphicsFamily.value(), indices.presentFamily.value() };
+    if (indices.transferFamily.has_value()) {
+        uniqueQueueFamilies.insert(indices.transferFamily.value());
+    }
 
     float queuePriority = 1.0f;
     for (uint32_t queueFamily : uniqueQueueFamilies) {
@@ -149,13 +157,79 @@ void CreateLogicalDevice() {
         queueCreateInfos.push_back(queueCreateInfo);
     }
 
+    VkPhysicalDeviceFeatures supportedFeatures;
+    vkGetPhysicalDeviceFeatures(vk_PhysicalDevice, &supportedFeatures);
+
     VkPhysicalDeviceFeatures deviceFeatures{};
     deviceFeatures.samplerAnisotropy = VK_TRUE;
+    deviceFeatures.textureCompressionBC = supportedFeatures.textureCompressionBC;
+    deviceFeatures.multiDrawIndirect = supportedFeatures.multiDrawIndirect;
+
+    textureCompressionBCEnabled = supportedFeatures.textureCompressionBC == VK_TRUE;
+    multiDrawIndirectEnabled = supportedFeatures.multiDrawIndirect == VK_TRUE;
 
     VkPhysicalDeviceVulkan11Features features11 = {};
     features11.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_1_FEATURES;
     features11.shaderDrawParameters = VK_TRUE;
 
+    VkPhysicalDeviceProperties deviceProperties;
+    vkGetPhysicalDeviceProperties(vk_PhysicalDevice, &deviceProperties);
+
+    // The 1.2 feature struct may only be chained on a 1.2 device, the query goes through it as well.
+    VkPhysicalDeviceVulkan12Features supportedFeatures12 = {};
+    supportedFeatures12.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+
+    // The extension depends on VK_KHR_depth_stencil_resolve and VK_KHR_create_renderpass2, both core in 1.2.
+    bool dynamicRenderingExtensionSupported = USE_DYNAMIC_RENDERING && IsDeviceExtensionSupported(vk_PhysicalDevice, VK_KHR_DYNAMIC_RENDERING_EXTENSION_NAME);
+
+    VkPhysicalDeviceDynamicRenderingFeaturesKHR supportedDynamicRenderingFeatures = {};
+    supportedDynamicRenderingFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DYNAMIC_RENDERING_FEATURES_KHR;
+    if (dynamicRenderingExtensionSupported) {
+        supportedFeatures12.pNext = &supportedDynamicRenderingFeatures;
+    }
+
+    if ((USE_BINDLESS_TEXTURES || USE_TIMELINE_SEMAPHORES || USE_DYNAMIC_RENDERING) && deviceProperties.apiVersion >= VK_API_VERSION_1_2) {
+
+        VkPhysicalDeviceFeatures2 supportedFeatures2 = {};
+        supportedFeatures2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+        supportedFeatures2.pNext = &supportedFeatures12;
+        vkGetPhysicalDeviceFeatures2(vk_PhysicalDevice, &supportedFeatures2);
+
+        bindlessTexturesEnabled = USE_BINDLESS_TEXTURES
+            && supportedFeatures12.descriptorIndexing == VK_TRUE
+            && supportedFeatures12.runtimeDescriptorArray == VK_TRUE
+            && supportedFeatures12.descriptorBindingPartiallyBound == VK_TRUE
+            && supportedFeatures12.descriptorBindingSampledImageUpdateAfterBind == VK_TRUE
+            && supportedFeatures12.descriptorBindingUpdateUnusedWhilePending == VK_TRUE
+            && supportedFeatures12.shaderSampledImageArrayNonUniformIndexing == VK_TRUE;
+
+        timelineSemaphoresEnabled = USE_TIMELINE_SEMAPHORES && supportedFeatures12.timelineSemaphore == VK_TRUE;
+
+        dynamicRenderingEnabled = dynamicRenderingExtensionSupported && supportedDynamicRenderingFeatures.dynamicRendering == VK_TRUE;
+    }
+
+    VkPhysicalDeviceVulkan12Features features12 = {};
+    features12.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+    features12.descriptorIndexing = bindlessTexturesEnabled;
+    features12.runtimeDescriptorArray = bindlessTexturesEnabled;
+    features12.descriptorBindingPartiallyBound = bindlessTexturesEnabled;
+    features12.descriptorBindingSampledImageUpdateAfterBind = bindlessTexturesEnabled;
+    features12.descriptorBindingUpdateUnusedWhilePending = bindlessTexturesEnabled;
+    features12.shaderSampledImageArrayNonUniformIndexing = bindlessTexturesEnabled;
+    features12.timelineSemaphore = timelineSemaphoresEnabled;
+
+    VkPhysicalDeviceDynamicRenderingFeaturesKHR dynamicRenderingFeatures = {};
+    dynamicRenderingFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DYNAMIC_RENDERING_FEATURES_KHR;
+    dynamicRenderingFeatures.dynamicRendering = VK_TRUE;
+
+    if (bindlessTexturesEnabled || timelineSemaphoresEnabled || dynamicRenderingEnabled) {
+        features11.pNext = &features12;
+    }
+
+    if (dynamicRenderingEnabled) {
+        features12.pNext = &dynamicRenderingFeatures;
+    }
+
     VkDeviceCreateInfo createInfo{};
     createInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
 
@@ -166,8 +240,19 @@ void CreateLogicalDevice() {
 
     createInfo.pNext = &features11;
 
-    createInfo.enabledExtensionCount = static_cast<uint32_t>(deviceExtensions.size());
-    createInfo.ppEnabledExtensionNames = deviceExtensions.data();
+    std::vector<const char*> enabledDeviceExtensions = deviceExtensions;
+
+    drawIndirectCountEnabled = IsDeviceExtensionSupported(vk_PhysicalDevice, VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME);
+    if (drawIndirectCountEnabled) {
+        enabledDeviceExtensions.push_back(VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME);
+    }
+
+    if (dynamicRenderingEnabled) {
+        enabledDeviceExtensions.push_back(VK_KHR_DYNAMIC_RENDERING_EXTENSION_NAME);
+    }
+
+    createInfo.enabledExtensionCount = static_cast<uint32_t>(enabledDeviceExtensions.size());
+    createInfo.ppEnabledExtensionNames = enabledDeviceExtensions.data();
 
     if (enableValidationLayers) {
         createInfo.enabledLayerCount = static_cast<uint32_t>(validationLayers.size());
@@ -181,8 +266,31 @@ void CreateLogicalDevice() {
         throw std::runtime_error("failed to create logical device!");
     }
 
+    if (drawIndirectCountEnabled) {
+        pfn_vkCmdDrawIndexedIndirectCount = (PFN_vkCmdDrawIndexedIndirectCountKHR)vkGetDeviceProcAddr(vk_LogicalDevice, "vkCmdDrawIndexedIndirectCountKHR");
+        drawIndirectCountEnabled = pfn_vkCmdDrawIndexedIndirectCount != nullptr;
+    }
+
+    if (dynamicRenderingEnabled) {
+        pfn_vkCmdBeginRendering = (PFN_vkCmdBeginRenderingKHR)vkGetDeviceProcAddr(vk_LogicalDevice, "vkCmdBeginRenderingKHR");
+        pfn_vkCmdEndRendering = (PFN_vkCmdEndRenderingKHR)vkGetDeviceProcAddr(vk_LogicalDevice, "vkCmdEndRenderingKHR");
+        dynamicRenderingEnabled = pfn_vkCmdBeginRendering != nullptr && pfn_vkCmdEndRendering != nullptr;
+    }
+
+    if (dynamicRenderingEnabled) {
+        std::cout << "Using dynamic rendering, no render passes or framebuffers are created." << std::endl;
+    }
+
     vkGetDeviceQueue(vk_LogicalDevice, indices.graphicsFamily.value(), 0, &vk_GraphicsQueue);
     vkGetDeviceQueue(vk_LogicalDevice, indices.presentFamily.value(), 0, &vk_PresentQueue);
+
+    graphicsQueueFamilyIndex = indices.graphicsFamily.value();
+    transferQueueFamilyIndex = indices.transferFamily.value_or(graphicsQueueFamilyIndex);
+    vkGetDeviceQueue(vk_LogicalDevice, transferQueueFamilyIndex, 0, &vk_TransferQueue);
+
+    if (transferQueueFamilyIndex != graphicsQueueFamilyIndex) {
+        std::cout << "Using dedicated transfer queue family := " << transferQueueFamilyIndex << " for uploads." << std::endl;
+    }
 }
 
 void CreateVulkanMemoryAllocator() {
@@ -215,6 +323,26 @@ void CreateCommandPool() {
     if (vkCreateCommandPool(vk_LogicalDevice, &poolInfo, nullptr, &vk_CommandPool) != VK_SUCCESS) {
         throw std::runtime_error("failed to create command pool!");
     }
+
+    VkCommandPoolCreateInfo framePoolInfo{};
+    framePoolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    framePoolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+    framePoolInfo.queueFamilyIndex = queueFamilyIndices.graphicsFamily.value();
+
+    for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+        if (vkCreateCommandPool(vk_LogicalDevice, &framePoolInfo, nullptr, &vk_FrameCommandPools[i]) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create frame command pool!");
+        }
+    }
+
+    VkCommandPoolCreateInfo transferPoolInfo{};
+    transferPoolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    transferPoolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+    transferPoolInfo.queueFamilyIndex = transferQueueFamilyIndex;
+
+    if (vkCreateCommandPool(vk_LogicalDevice, &transferPoolInfo, nullptr, &vk_TransferCommandPool) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create transfer command pool!");
+    }
 }
 
 
@@ -246,7 +374,7 @@ void CreateTextureSampler() {
     samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
     samplerInfo.mipLodBias = 0.0f;
     samplerInfo.minLod = 0.0f;
-    samplerInfo.maxLod = 0.0f;
+    samplerInfo.maxLod = VK_LOD_CLAMP_NONE;
 
     if (vkCreateSampler(vk_LogicalDevice, &samplerInfo, nullptr, &vk_TextureSampler) != VK_SUCCESS) {
         throw std::runtime_error("Failed to create texture sampler!");
@@ -262,7 +390,7 @@ void CreateDescriptorPool() {
 
     std::array<VkDescriptorPoolSize, largeRandomNumberOfDescriptorSets> poolSizes{};
 
-    int eachPartSize = largeRandomNumberOfDescriptorSets / 3;
+    int eachPartSize = largeRandomNumberOfDescriptorSets / 5;
 
     for (int i = 0; i < eachPartSize; i++)
     {
@@ -270,7 +398,19 @@ void CreateDescriptorPool() {
         poolSizes[i].descriptorCount = static_cast<uint32_t>(eachPartSize);
     }
 
-    for (int i = 2 * eachPartSize; i < largeRandomNumberOfDescriptorSets; i++)
+    for (int i = 3 * eachPartSize; i < 4 * eachPartSize; i++)
+    {
+        poolSizes[i].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+        poolSizes[i].descriptorCount = static_cast<uint32_t>(eachPartSize);
+    }
+
+    for (int i = 4 * eachPartSize; i < largeRandomNumberOfDescriptorSets; i++)
+    {
+        poolSizes[i].type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        poolSizes[i].descriptorCount = static_cast<uint32_t>(eachPartSize);
+    }
+
+    for (int i = 2 * eachPartSize; i < 3 * eachPartSize; i++)
     {
         poolSizes[i].type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC;
         //poolSizes[i].type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
@@ -300,14 +440,17 @@ void CreateCommandBuffers() {
 
     vk_CommandBuffers.resize(MAX_FRAMES_IN_FLIGHT);
 
-    VkCommandBufferAllocateInfo allocInfo{};
-    allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-    allocInfo.commandPool = vk_CommandPool;
-    allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-    allocInfo.commandBufferCount = static_cast<uint32_t>(vk_CommandBuffers.size());
+    for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+
+        VkCommandBufferAllocateInfo allocInfo{};
+        allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+        allocInfo.commandPool = vk_FrameCommandPools[i];
+        allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+        allocInfo.commandBufferCount = 1;
 
-    if (vkAllocateCommandBuffers(vk_LogicalDevice, &allocInfo, vk_CommandBuffers.data()) != VK_SUCCESS) {
-        throw std::runtime_error("failed to allocate command buffers!");
+        if (vkAllocateCommandBuffers(vk_LogicalDevice, &allocInfo, &vk_CommandBuffers[i]) != VK_SUCCESS) {
+            throw std::runtime_error("failed to allocate command buffers!");
+        }
     }
 }
 
@@ -317,7 +460,8 @@ void CreateSyncObjects() {
 
     imageAvailableSemaphores.resize(MAX_FRAMES_IN_FLIGHT);
     renderFinishedSemaphores.resize(MAX_FRAMES_IN_FLIGHT);
-    inFlightFences.resize(MAX_FRAMES_IN_FLIGHT);
+    // Frames wait on the GPU timeline when there is one, the fences are only the fallback.
+    inFlightFences.resize(MAX_FRAMES_IN_FLIGHT, VK_NULL_HANDLE);
 
     VkSemaphoreCreateInfo semaphoreInfo{};
     semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
@@ -329,7 +473,7 @@ void CreateSyncObjects() {
     for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
         if (vkCreateSemaphore(vk_LogicalDevice, &semaphoreInfo, nullptr, &imageAvailableSemaphores[i]) != VK_SUCCESS ||
             vkCreateSemaphore(vk_LogicalDevice, &semaphoreInfo, nullptr, &renderFinishedSemaphores[i]) != VK_SUCCESS ||
-            vkCreateFence(vk_LogicalDevice, &fenceInfo, nullptr, &inFlightFences[i]) != VK_SUCCESS) {
+            (!IsGpuTimelineActive() && vkCreateFence(vk_LogicalDevice, &fenceInfo, nullptr, &inFlightFences[i]) != VK_SUCCESS)) {
 
             throw std::runtime_error("failed to create synchronization objects for a frame!");
         }
@@ -342,6 +486,8 @@ void CreateSyncObjects() {
 
 void InitVulkan(const std::string& applicationName, GLFWwindow& window, std::string& vertexShaderPath, std::string& fragmentShaderPath, std::vector<std::string>& allModelsFilePaths, std::vector<std::string> allUIModelsFilePaths) {
 
+    InitJobSystem();
+
     InitVKInstance(applicationName);
 
     SetupDebugMessenger();
@@ -351,6 +497,7 @@ void InitVulkan(const std::string& applicationName, GLFWwindow& window, std::str
     CreateLogicalDevice();
 
     CreateVulkanMemoryAllocator();
+    CreateGpuTimeline();
 
     CreateSwapChain(window);
     CreateImageViews();
@@ -360,9 +507,11 @@ void InitVulkan(const std::string& applicationName, GLFWwindow& window, std::str
     CreateDescriptorSetLayoutForMaterials();
     CreateDescriptorSetLayoutForCameraUBO();
     CreateDescriptorSetLayoutForUIInstanceSSBO();
+    CreateDescriptorSetLayoutForDrawData();
+    CreateBindlessTextures();
 
 
-
+    CreatePipelineCache();
 
     CreateGraphicsPipeline(vertexShaderPath, fragmentShaderPath);
 
@@ -376,6 +525,14 @@ void InitVulkan(const std::string& applicationName, GLFWwindow& window, std::str
 
     CreateTextureSampler();
 
+    CreateIndirectDrawBuffers_VMA();
+    CreateDescriptorSetsForDrawData();
+    CreateDrawCulling();
+    CreateOcclusionCulling();
+
+    // Every pipeline exists by now, so a cold start writes its cache right away instead of only on a clean shutdown.
+    SavePipelineCache();
+
     InitCamerasAndData();
 
 
@@ -399,10 +556,16 @@ void InitVulkan(const std::string& applicationName, GLFWwindow& window, std::str
     CreateDescriptorSetsForUIInstanceSSBO();
 
     LoadAllModelsDataToCPU(allModelsFilePaths, Model::allModelsThatNeedToBeLoadedAndRendered);
-    UploadAllModelsAndMaterialDataToGPU(Model::allModelsThatNeedToBeLoadedAndRendered);
-
     LoadAllModelsDataToCPU(allUIModelsFilePaths, UI::allUIModelsThatNeedToBeLoadedAndRendered);
-    UploadAllModelsAndMaterialDataToGPU(UI::allUIModelsThatNeedToBeLoadedAndRendered);
+
+    CreateGeometryArena();
+    CreateModelUniformRingBuffers_VMA();
+
+    UploadBatch sceneUploadBatch;
+    UploadAllModelsAndMaterialDataToGPU(Model::allModelsThatNeedToBeLoadedAndRendered, sceneUploadBatch);
+    UploadAllModelsAndMaterialDataToGPU(UI::allUIModelsThatNeedToBeLoadedAndRendered, sceneUploadBatch);
+    SubmitUploadBatch(sceneUploadBatch);
+    QueueDrawCullingInstances(Model::allModelsThatNeedToBeLoadedAndRendered, 0);
 
     //CreateDescriptorSets();
 
@@ -415,6 +578,9 @@ void VulkanCleanup() {
 
     vkDeviceWaitIdle(vk_LogicalDevice);
 
+    FinishAllUploadBatches();
+    FlushDeferredDeletions();
+
     for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
         vkDestroySemaphore(vk_LogicalDevice, renderFinishedSemaphores[i], nullptr);
         vkDestroySemaphore(vk_LogicalDevice, imageAvailableSemaphores[i], nullptr);
@@ -422,6 +588,11 @@ void VulkanCleanup() {
     }
 
     vkDestroyCommandPool(vk_LogicalDevice, vk_CommandPool, nullptr);
+    for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+        vkDestroyCommandPool(vk_LogicalDevice, vk_FrameCommandPools[i], nullptr);
+    }
+    DestroySecondaryCommandPools();
+    vkDestroyCommandPool(vk_LogicalDevice, vk_TransferCommandPool, nullptr);
 
     CleanUpSwapChain();
 
@@ -438,6 +609,14 @@ void VulkanCleanup() {
         CleanUpModelData(UI::allUIModelsThatNeedToBeLoadedAndRendered[i]);
     }
 
+    DestroyGeometryArena();
+    DestroyModelUniformRingBuffers();
+    DestroyGpuTimeline();
+    DestroyOcclusionCulling();
+    DestroyDrawCulling();
+    DestroyIndirectDrawBuffers();
+    DestroyBindlessTextures();
+
     for (int i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
     {
         vmaDestroyBuffer(vma_Allocator, UI::vk_UI_Instance_Model_SSBOBuffers[i], UI::vk_UI_Model_Instance_SSBOBuffersAllocations[i]);
@@ -464,7 +643,8 @@ void VulkanCleanup() {
 
 
 
-    vkDestroyPipeline(vk_LogicalDevice, vk_GraphicsPipeline, nullptr);
+    DestroyPipelineVariants();
+    DestroyPipelineCache();
 
     vkDestroyDescriptorPool(vk_LogicalDevice, vk_DescriptorPool, nullptr);
 
@@ -486,6 +666,8 @@ void VulkanCleanup() {
     vkDestroySurfaceKHR(vk_Instance, vk_Surface, nullptr);
     // destroy instance only after other vulkan resources are cleaned up.
     vkDestroyInstance(vk_Instance, nullptr);
+
+    ShutdownJobSystem();
 }
 
 
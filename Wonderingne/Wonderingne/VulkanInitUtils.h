@@ -6,6 +6,9 @@ struct QueueFamilyIndices {
     std::optional<uint32_t> graphicsFamily;
     std::optional<uint32_t> presentFamily;
 
+    // Only set when the device exposes a transfer capable family without graphics, uploads fall back to the graphics family otherwise.
+    std::optional<uint32_t> transferFamily;
+
     bool IsComplete() {
         return graphicsFamily.has_value() && presentFamily.has_value();
     }
@@ -30,6 +33,23 @@ bool CheckDeviceExtensionSupport(VkPhysicalDevice device) {
     return requiredExtensions.empty();
 }
 
+bool IsDeviceExtensionSupported(VkPhysicalDevice device, const char* extensionName) {
+
+    uint32_t extensionCount;
+    vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, nullptr);
+
+    std::vector<VkExtensionProperties> availableExtensions(extensionCount);
+    vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, availableExtensions.data());
+
+    for (const auto& extension : availableExtensions) {
+        if (strcmp(extension.extensionName, extensionName) == 0) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
 QueueFamilyIndices FindQueueFamilies(VkPhysicalDevice device) {
     QueueFamilyIndices indices;
 
@@ -60,6 +80,28 @@ QueueFamilyIndices FindQueueFamilies(VkPhysicalDevice device) {
         i++;
     }
 
+    // Prefer a pure DMA family (transfer only), then anything transfer capable that is not the graphics family.
+    for (uint32_t j = 0; j < queueFamilyCount; j++) {
+
+        VkQueueFlags familyFlags = queueFamilies[j].queueFlags;
+        bool supportsTransfer = (familyFlags & VK_QUEUE_TRANSFER_BIT) != 0;
+        bool supportsGraphics = (familyFlags & VK_QUEUE_GRAPHICS_BIT) != 0;
+        bool supportsCompute = (familyFlags & VK_QUEUE_COMPUTE_BIT) != 0;
+
+        if (!supportsTransfer || supportsGraphics) {
+            continue;
+        }
+
+        if (!supportsCompute) {
+            indices.transferFamily = j;
+            break;
+        }
+
+        if (!indices.transferFamily.has_value()) {
+            indices.transferFamily = j;
+        }
+    }
+
     return indices;
 }
 
@@ -92,6 +134,14 @@ VkFormat FindDepthFormat() {
     );
 }
 
+bool IsDepthFormatSampleable(VkFormat depthFormat) {
+
+    VkFormatProperties formatProperties;
+    vkGetPhysicalDeviceFormatProperties(vk_PhysicalDevice, depthFormat, &formatProperties);
+
+    return (formatProperties.optimalTilingFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT) != 0;
+}
+
 bool CheckForVulkanValidationLayerSupport() {
     uint32_t layerCount;
     vkEnumerateInstanceLayerProperties(&layerCount, nullptr);
@@ -225,7 +275,7 @@ VkSurfaceFormatKHR ChooseSwapSurfaceFormat(const std::vector<VkSurfaceFormatKHR>
 
 VkPresentModeKHR ChooseSwapPresentMode(const std::vector<VkPresentModeKHR>& availablePresentModes) {
     for (const auto& availablePresentMode : availablePresentModes) {
-        if (availablePresentMode == VK_PRESENT_MODE_MAILBOX_KHR) {
+        if (availablePresentMode == presentationPolicy.presentMode) {
             return availablePresentMode;
         }
     }
@@ -233,6 +283,16 @@ VkPresentModeKHR ChooseSwapPresentMode(const std::vector<VkPresentModeKHR>& avai
     return VK_PRESENT_MODE_FIFO_KHR;
 }
 
+uint32_t ChooseSwapImageCount(const VkSurfaceCapabilitiesKHR& capabilities) {
+
+    uint32_t imageCount = presentationPolicy.swapChainImageCount == 0 ? capabilities.minImageCount + 1 : std::max(presentationPolicy.swapChainImageCount, capabilities.minImageCount);
+    if (capabilities.maxImageCount > 0 && imageCount > capabilities.maxImageCount) {
+        imageCount = capabilities.maxImageCount;
+    }
+
+    return imageCount;
+}
+
 VkExtent2D ChooseSwapExtent(const VkSurfaceCapabilitiesKHR& capabilities, GLFWwindow& window) {
     if (capabilities.currentExtent.width != std::numeric_limits<uint32_t>::max()) {
         return capabilities.currentExtent;
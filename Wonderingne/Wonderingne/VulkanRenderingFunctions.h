@@ -5,34 +5,92 @@
 #include "ModelUtils.h"
 #include "CameraUtils.h"
 #include "UIUtils.h"
+#include "RenderQueueUtils.h"
+#include "CommandRecordingUtils.h"
+#include "JobSystemUtils.h"
+#include "PresentationPolicyUtils.h"
 
 
-void RenderModels(VkCommandBuffer& commandBuffer, std::vector<Model>& modelsToRender, int cameraIndex, int shaderFunctionIndex, uint32_t instanceCount) {
+RenderQueue sceneRenderQueue;
+RenderQueue uiRenderQueue;
 
-    SimplePushConstantData simplePushConstantData = {};
-    simplePushConstantData.shaderFunctionUseID = shaderFunctionIndex;
-    vkCmdPushConstants(commandBuffer, vk_PipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(SimplePushConstantData), &simplePushConstantData);
+// Everything up to the draws themselves, recorded before the render pass begins since the culling pass is a compute dispatch.
+// Passes that cull are culled once, on the GPU when the device can and on the CPU otherwise. GPU culled queues never touch their
+// meshes on the CPU, the draws are built from the draw culling instances by the culling pass.
+void PrepareRenderQueue(VkCommandBuffer& commandBuffer, RenderQueue& renderQueue, std::vector<Model>& modelsToRender, int cameraIndex, int shaderFunctionIndex, uint32_t instanceCount, bool useIndirectDraws, bool useFrustumCulling) {
 
-    for (int i = 0; i < modelsToRender.size(); i++)
-    {
-        for (int j = 0; j < modelsToRender[i].meshes.size(); j++)
-        {
-            Mesh& curMesh = modelsToRender[i].meshes[j];
-            Material& curMaterial = Material::allLoadedMaterials[curMesh.materialIndex];
+    bool useIndirectDrawsForQueue = useIndirectDraws && vk_IndirectGraphicsPipeline != VK_NULL_HANDLE;
+    bool cullOnGPU = useFrustumCulling && useIndirectDrawsForQueue && IsGPUDrawCullingActive();
 
-            VkBuffer vertexBuffers[] = { curMesh.vk_VertexBuffer };
-            VkDeviceSize offsets[] = { 0 };
+    renderQueue.useIndirectDraws = useIndirectDrawsForQueue;
+    renderQueue.useDepthPrepass = useIndirectDrawsForQueue && depthPrepassEnabled && PipelineVariants::depthPrepassAvailable;
+    renderQueue.useOcclusionCulling = cullOnGPU && IsOcclusionCullingActive();
 
-            vkCmdBindVertexBuffers(commandBuffer, 0, 1, vertexBuffers, offsets);
-            vkCmdBindIndexBuffer(commandBuffer, curMesh.vk_IndexBuffer, 0, VK_INDEX_TYPE_UINT32);
+    if (cullOnGPU) {
+        PrepareDrawCullingFrame(commandBuffer, modelsToRender);
+        BuildRenderQueueFromDrawCulling(renderQueue, cameraIndex, shaderFunctionIndex, instanceCount);
 
-            std::array<VkDescriptorSet, 3> descriptorSetsToBindForThisDrawCommand = { vk_DescriptorSetsForEachFlightFrame[Camera::allCameraUBODescriptorSetIndices[cameraIndex]][indexOfDataForCurrentFrame], vk_DescriptorSetsForEachFlightFrame[curMaterial.descriptorSetIndex][indexOfDataForCurrentFrame], vk_DescriptorSetsForEachFlightFrame[UI::vk_UI_Instance_Model_SSBO_DescriptorSetIndex][indexOfDataForCurrentFrame] };
-            std::array<uint32_t, 1> dynamicOffsets = { 0 };
+        // The late occlusion phase is recorded by RecordCommandBuffer once the early draws are done.
+        if (renderQueue.useOcclusionCulling) {
+            RecordOcclusionCullingPass(commandBuffer, GetCameraFrustum(Camera::camera_ubos[cameraIndex]), cameraIndex, OCCLUSION_CULLING_PHASE_EARLY);
+        }
+        else {
+            RecordDrawCullingPass(commandBuffer, GetCameraFrustum(Camera::camera_ubos[cameraIndex]));
+        }
 
-            vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, vk_PipelineLayout, 0, static_cast<uint32_t>(descriptorSetsToBindForThisDrawCommand.size()), descriptorSetsToBindForThisDrawCommand.data(), static_cast<uint32_t>(dynamicOffsets.size()), dynamicOffsets.data());
+        return;
+    }
 
-            vkCmdDrawIndexed(commandBuffer, static_cast<uint32_t>(curMesh.indices.size()), instanceCount, 0, 0, 0);
-        }
+    BuildRenderQueue(renderQueue, modelsToRender, cameraIndex, shaderFunctionIndex, instanceCount, useFrustumCulling);
+    SortRenderQueue(renderQueue);
+
+    if (renderQueue.useIndirectDraws) {
+        WriteRenderQueueIndirectDraws(renderQueue);
+    }
+}
+
+// Secondaries inherit nothing from the primary, so every one of them sets the dynamic state and vertex buffers itself.
+void RecordPassState(VkCommandBuffer commandBuffer) {
+
+    VkViewport viewport{};
+    viewport.x = 0.0f;
+    viewport.y = 0.0f;
+    viewport.width = static_cast<float>(vk_SwapChainExtent.width);
+    viewport.height = static_cast<float>(vk_SwapChainExtent.height);
+    viewport.minDepth = 0.0f;
+    viewport.maxDepth = 1.0f;
+    vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+
+    VkRect2D scissor{};
+    scissor.offset = { 0, 0 };
+    scissor.extent = vk_SwapChainExtent;
+    vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+
+    BindGeometryArenaVertexBuffers(commandBuffer);
+}
+
+// Splits the queue into at most one job per thread, small queues stay in a single job since every secondary has a fixed setup cost.
+void AddRenderQueueRecordingJobs(const RenderQueue& renderQueue, bool depthPrepass, bool lateOcclusionPhase, std::vector<SecondaryRecordingJob>& jobs) {
+
+    uint32_t itemCount = GetRenderQueueRecordItemCount(renderQueue);
+    if (itemCount == 0) {
+        return;
+    }
+
+    uint32_t maxJobCount = std::min(static_cast<uint32_t>(JobSystem::workerThreads.size()) + 1, MAX_COMMAND_RECORDING_JOBS_PER_RENDER_QUEUE);
+    uint32_t jobCount = std::clamp((itemCount + MIN_ITEMS_PER_COMMAND_RECORDING_JOB - 1) / MIN_ITEMS_PER_COMMAND_RECORDING_JOB, 1u, maxJobCount);
+    uint32_t itemsPerJob = (itemCount + jobCount - 1) / jobCount;
+
+    for (uint32_t firstItem = 0; firstItem < itemCount; firstItem += itemsPerJob)
+    {
+        SecondaryRecordingJob job{};
+        job.renderQueue = &renderQueue;
+        job.firstItem = firstItem;
+        job.endItem = std::min(firstItem + itemsPerJob, itemCount);
+        job.depthPrepass = depthPrepass;
+        job.lateOcclusionPhase = lateOcclusionPhase;
+
+        jobs.push_back(job);
     }
 }
 
@@ -40,15 +98,66 @@ void RecordCommandBuffer(VkCommandBuffer commandBuffer, uint32_t imageIndex) {
 
     VkCommandBufferBeginInfo beginInfo{};
     beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
 
     if (vkBeginCommandBuffer(commandBuffer, &beginInfo) != VK_SUCCESS) {
         throw std::runtime_error("failed to begin recording command buffer!");
     }
 
+    // UI meshes stay on the direct path and are never culled, the per instance matrices of the UI SSBO move them away from their
+    // mesh bounds.
+    PrepareRenderQueue(commandBuffer, sceneRenderQueue, Model::allModelsThatNeedToBeLoadedAndRendered, 0, SHADER_FUNCTION_WORLD, 1, USE_INDIRECT_DRAWS, USE_FRUSTUM_CULLING);
+    PrepareRenderQueue(commandBuffer, uiRenderQueue, UI::allUIModelsThatNeedToBeLoadedAndRendered, 1, SHADER_FUNCTION_UI_INSTANCE, static_cast<uint32_t>(UI::uiModelMatricesPerInstance.size()), false, false);
+
+    // Jobs keep the queue order, so executing them in order draws exactly what a single command buffer would.
+    std::vector<SecondaryRecordingJob>& jobs = SecondaryCommandRecording::jobs;
+    jobs.clear();
+    // The pre-pass jobs of the scene come first, so all of its depth is in place before any scene draw is shaded.
+    if (sceneRenderQueue.useDepthPrepass) {
+        AddRenderQueueRecordingJobs(sceneRenderQueue, true, false, jobs);
+    }
+    AddRenderQueueRecordingJobs(sceneRenderQueue, false, false, jobs);
+
+    // With occlusion culling everything above goes into the early render pass, and the scene is recorded again for the late one.
+    bool useOcclusionCulling = sceneRenderQueue.useOcclusionCulling;
+    size_t earlyJobCount = useOcclusionCulling ? jobs.size() : 0;
+    if (useOcclusionCulling) {
+        if (sceneRenderQueue.useDepthPrepass) {
+            AddRenderQueueRecordingJobs(sceneRenderQueue, true, true, jobs);
+        }
+        AddRenderQueueRecordingJobs(sceneRenderQueue, false, true, jobs);
+    }
+
+    AddRenderQueueRecordingJobs(uiRenderQueue, false, false, jobs);
+
+    EnsureSecondaryCommandBuffers(indexOfDataForCurrentFrame, jobs.size());
+    std::vector<VkCommandBuffer>& secondaryCommandBuffers = SecondaryCommandRecording::vk_CommandBuffers[indexOfDataForCurrentFrame];
+
+    bool useDynamicRendering = IsDynamicRenderingActive();
+    VkFramebuffer framebuffer = useDynamicRendering ? VK_NULL_HANDLE : vk_SwapChainFramebuffers[imageIndex];
+
+    VkRenderPass earlyRenderPass = OcclusionCulling::vk_EarlyRenderPass;
+    VkRenderPass mainRenderPass = useOcclusionCulling ? OcclusionCulling::vk_LateRenderPass : vk_RenderPass;
+
+    ParallelFor(static_cast<uint32_t>(jobs.size()), [&](uint32_t jobIndex) {
+
+        const SecondaryRecordingJob& job = jobs[jobIndex];
+        VkCommandBuffer secondaryCommandBuffer = secondaryCommandBuffers[jobIndex];
+
+        BeginSecondaryCommandBuffer(secondaryCommandBuffer, jobIndex < earlyJobCount ? earlyRenderPass : mainRenderPass, framebuffer);
+
+        RecordPassState(secondaryCommandBuffer);
+        RecordRenderQueueRange(secondaryCommandBuffer, *job.renderQueue, job.firstItem, job.endItem, job.depthPrepass, job.lateOcclusionPhase);
+
+        if (vkEndCommandBuffer(secondaryCommandBuffer) != VK_SUCCESS) {
+            throw std::runtime_error("failed to record secondary command buffer!");
+        }
+    });
+
     VkRenderPassBeginInfo renderPassInfo{};
     renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
-    renderPassInfo.renderPass = vk_RenderPass;
-    renderPassInfo.framebuffer = vk_SwapChainFramebuffers[imageIndex];
+    renderPassInfo.renderPass = mainRenderPass;
+    renderPassInfo.framebuffer = framebuffer;
     renderPassInfo.renderArea.offset = { 0, 0 };
     renderPassInfo.renderArea.extent = vk_SwapChainExtent;
 
@@ -60,28 +169,56 @@ void RecordCommandBuffer(VkCommandBuffer commandBuffer, uint32_t imageIndex) {
     renderPassInfo.clearValueCount = static_cast<uint32_t>(clearValues.size());
     renderPassInfo.pClearValues = clearValues.data();
 
-    vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+    // The layout transitions the render passes do through their attachment descriptions are recorded here with dynamic rendering.
+    if (useDynamicRendering) {
+        RecordFrameAttachmentsToRenderingLayouts(commandBuffer, imageIndex);
+    }
 
-    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, vk_GraphicsPipeline);
+    if (useOcclusionCulling) {
+        if (useDynamicRendering) {
+            BeginFrameRendering(commandBuffer, imageIndex, VK_ATTACHMENT_LOAD_OP_CLEAR, VK_ATTACHMENT_STORE_OP_STORE);
+        }
+        else {
+            renderPassInfo.renderPass = earlyRenderPass;
+            vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+        }
 
-    VkViewport viewport{};
-    viewport.x = 0.0f;
-    viewport.y = 0.0f;
-    viewport.width = static_cast<float>(vk_SwapChainExtent.width);
-    viewport.height = static_cast<float>(vk_SwapChainExtent.height);
-    viewport.minDepth = 0.0f;
-    viewport.maxDepth = 1.0f;
-    vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+        if (earlyJobCount > 0) {
+            vkCmdExecuteCommands(commandBuffer, static_cast<uint32_t>(earlyJobCount), secondaryCommandBuffers.data());
+        }
 
-    VkRect2D scissor{};
-    scissor.offset = { 0, 0 };
-    scissor.extent = vk_SwapChainExtent;
-    vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+        if (useDynamicRendering) {
+            EndFrameRendering(commandBuffer);
+        }
+        else {
+            vkCmdEndRenderPass(commandBuffer);
+        }
 
-    RenderModels(commandBuffer, Model::allModelsThatNeedToBeLoadedAndRendered, 0, 0, 1);
-    RenderModels(commandBuffer, UI::allUIModelsThatNeedToBeLoadedAndRendered, 1, 1, UI::uiModelMatricesPerInstance.size());
+        RecordHiZBuild(commandBuffer);
+        RecordOcclusionCullingPass(commandBuffer, GetCameraFrustum(Camera::camera_ubos[sceneRenderQueue.cameraIndex]), sceneRenderQueue.cameraIndex, OCCLUSION_CULLING_PHASE_LATE);
 
-    vkCmdEndRenderPass(commandBuffer);
+        // The late pass loads, its clear values are ignored.
+        renderPassInfo.renderPass = mainRenderPass;
+    }
+
+    if (useDynamicRendering) {
+        BeginFrameRendering(commandBuffer, imageIndex, useOcclusionCulling ? VK_ATTACHMENT_LOAD_OP_LOAD : VK_ATTACHMENT_LOAD_OP_CLEAR, VK_ATTACHMENT_STORE_OP_DONT_CARE);
+    }
+    else {
+        vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+    }
+
+    if (jobs.size() > earlyJobCount) {
+        vkCmdExecuteCommands(commandBuffer, static_cast<uint32_t>(jobs.size() - earlyJobCount), secondaryCommandBuffers.data() + earlyJobCount);
+    }
+
+    if (useDynamicRendering) {
+        EndFrameRendering(commandBuffer);
+        RecordSwapChainImageToPresentLayout(commandBuffer, imageIndex);
+    }
+    else {
+        vkCmdEndRenderPass(commandBuffer);
+    }
 
     if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS) {
         throw std::runtime_error("failed to record command buffer!");
@@ -90,22 +227,32 @@ void RecordCommandBuffer(VkCommandBuffer commandBuffer, uint32_t imageIndex) {
 
 void DrawFrame(GLFWwindow& window) {
 
-    vkWaitForFences(vk_LogicalDevice, 1, &inFlightFences[indexOfDataForCurrentFrame], VK_TRUE, UINT64_MAX);
+    if (presentationPolicyChangeRequested) {
+        ApplyRequestedPresentationPolicy(window);
+    }
+
+    WaitForCurrentFrameInFlight();
+
+    ProcessCompletedUploadBatches();
+    ProcessDeferredDeletions();
 
     uint32_t imageIndex;
     VkResult result = vkAcquireNextImageKHR(vk_LogicalDevice, vk_SwapChain, UINT64_MAX, imageAvailableSemaphores[indexOfDataForCurrentFrame], VK_NULL_HANDLE, &imageIndex);
 
     if (result == VK_ERROR_OUT_OF_DATE_KHR) {
         RecreateSwapChain(window);
+        RecreateHiZResources();
         return;
     }
     else if (result != VK_SUCCESS && result != VK_SUBOPTIMAL_KHR) {
         throw std::runtime_error("failed to acquire swap chain image!");
     }
 
-    vkResetFences(vk_LogicalDevice, 1, &inFlightFences[indexOfDataForCurrentFrame]);
+    if (!IsGpuTimelineActive()) {
+        vkResetFences(vk_LogicalDevice, 1, &inFlightFences[indexOfDataForCurrentFrame]);
+    }
 
-    vkResetCommandBuffer(vk_CommandBuffers[indexOfDataForCurrentFrame], 0);
+    ResetFrameCommandPools(indexOfDataForCurrentFrame);
 
 
 
@@ -114,11 +261,24 @@ void DrawFrame(GLFWwindow& window) {
         UpdateCameraUniformBuffer(indexOfDataForCurrentFrame, i);
     }
 
+    ResetModelUniformRing();
+    ResetIndirectDrawBuffers();
+
+    // GPU culled meshes only need their model's transform, the culling pass applies it to their instances.
+    bool updateMeshUniforms = !IsGPUDrawCullingActive();
+
     for (int i = 0; i < Model::allModelsThatNeedToBeLoadedAndRendered.size(); i++)
     {
-        for (int j = 0; j < Model::allModelsThatNeedToBeLoadedAndRendered[i].meshes.size(); j++)
+        Model& currentModel = Model::allModelsThatNeedToBeLoadedAndRendered[i];
+        UpdateModelTransform(currentModel);
+
+        if (!updateMeshUniforms) {
+            continue;
+        }
+
+        for (int j = 0; j < currentModel.meshes.size(); j++)
         {
-            UpdateModelUniformBuffer(Model::allModelsThatNeedToBeLoadedAndRendered[i].meshes[j], indexOfDataForCurrentFrame);
+            UpdateModelUniformBuffer(currentModel.meshes[j], currentModel.modelToWorld, indexOfDataForCurrentFrame);
         }
     }
 
@@ -152,10 +312,33 @@ void DrawFrame(GLFWwindow& window) {
     submitInfo.signalSemaphoreCount = 1;
     submitInfo.pSignalSemaphores = signalSemaphores;
 
+    // The frame also signals its point on the GPU timeline, the binary semaphores stay for the swap chain which only takes those.
+    VkTimelineSemaphoreSubmitInfo timelineSubmitInfo{};
+    std::array<VkSemaphore, 2> timelineSignalSemaphores = { renderFinishedSemaphores[indexOfDataForCurrentFrame], GpuTimeline::graphics.vk_Semaphore };
+    std::array<uint64_t, 2> timelineSignalValues = {};
+    uint64_t unusedBinaryWaitValue = 0;
+
+    if (IsGpuTimelineActive()) {
+        timelineSignalValues[1] = AdvanceTimeline(GpuTimeline::graphics);
+        GpuTimeline::frameTimelineValues[indexOfDataForCurrentFrame] = timelineSignalValues[1];
+
+        timelineSubmitInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+        timelineSubmitInfo.waitSemaphoreValueCount = 1;
+        timelineSubmitInfo.pWaitSemaphoreValues = &unusedBinaryWaitValue;
+        timelineSubmitInfo.signalSemaphoreValueCount = static_cast<uint32_t>(timelineSignalValues.size());
+        timelineSubmitInfo.pSignalSemaphoreValues = timelineSignalValues.data();
+
+        submitInfo.pNext = &timelineSubmitInfo;
+        submitInfo.signalSemaphoreCount = static_cast<uint32_t>(timelineSignalSemaphores.size());
+        submitInfo.pSignalSemaphores = timelineSignalSemaphores.data();
+    }
+
     if (vkQueueSubmit(vk_GraphicsQueue, 1, &submitInfo, inFlightFences[indexOfDataForCurrentFrame]) != VK_SUCCESS) {
         throw std::runtime_error("failed to submit draw command buffer!");
     }
 
+    MarkFrameSubmitted(indexOfDataForCurrentFrame);
+
     VkPresentInfoKHR presentInfo{};
     presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
 
@@ -172,10 +355,11 @@ void DrawFrame(GLFWwindow& window) {
     if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR || framebufferResized) {
         framebufferResized = false;
         RecreateSwapChain(window);
+        RecreateHiZResources();
     }
     else if (result != VK_SUCCESS) {
         throw std::runtime_error("failed to present swap chain image!");
     }
 
-    indexOfDataForCurrentFrame = (indexOfDataForCurrentFrame + 1) % MAX_FRAMES_IN_FLIGHT;
+    indexOfDataForCurrentFrame = (indexOfDataForCurrentFrame + 1) % presentationPolicy.framesInFlight;
 }
@@ -1,6 +1,8 @@
 #pragma once
 
 #include "VulkanCreateUtils.h"
+#include "DynamicRenderingUtils.h"
+#include "DeferredDeletionUtils.h"
 
 void CreateSwapChain(GLFWwindow& window) {
     SwapChainSupportDetails swapChainSupport = QuerySwapChainSupport(vk_PhysicalDevice);
@@ -9,10 +11,7 @@ void CreateSwapChain(GLFWwindow& window) {
     VkPresentModeKHR presentMode = ChooseSwapPresentMode(swapChainSupport.presentModes);
     VkExtent2D extent = ChooseSwapExtent(swapChainSupport.capabilities, window);
 
-    uint32_t imageCount = swapChainSupport.capabilities.minImageCount + 1;
-    if (swapChainSupport.capabilities.maxImageCount > 0 && imageCount > swapChainSupport.capabilities.maxImageCount) {
-        imageCount = swapChainSupport.capabilities.maxImageCount;
-    }
+    uint32_t imageCount = ChooseSwapImageCount(swapChainSupport.capabilities);
 
     VkSwapchainCreateInfoKHR createInfo{};
     createInfo.sType = VK_STRUCTURE_TYPE_SWAPCHAIN_CREATE_INFO_KHR;
@@ -46,12 +45,16 @@ void CreateSwapChain(GLFWwindow& window) {
     createInfo.presentMode = presentMode;
     createInfo.clipped = VK_TRUE;
 
-    createInfo.oldSwapchain = VK_NULL_HANDLE;
+    // Lets the presentation engine hand the old swap chain's resources over, images already queued on it are still presented.
+    createInfo.oldSwapchain = vk_SwapChain;
 
-    if (vkCreateSwapchainKHR(vk_LogicalDevice, &createInfo, nullptr, &vk_SwapChain) != VK_SUCCESS) {
+    VkSwapchainKHR swapChain;
+    if (vkCreateSwapchainKHR(vk_LogicalDevice, &createInfo, nullptr, &swapChain) != VK_SUCCESS) {
         throw std::runtime_error("failed to create swap chain!");
     }
 
+    vk_SwapChain = swapChain;
+
     vkGetSwapchainImagesKHR(vk_LogicalDevice, vk_SwapChain, &imageCount, nullptr);
     vk_SwapChainImages.resize(imageCount);
     vkGetSwapchainImagesKHR(vk_LogicalDevice, vk_SwapChain, &imageCount, vk_SwapChainImages.data());
@@ -71,20 +74,24 @@ void CreateImageViews() {
     }
 }
 
-void CreateRenderPass() {
+// Render passes that only differ in load and store ops and layouts are compatible, so they all share vk_RenderPass's framebuffers
+// and pipelines. Loading keeps the attachments from an earlier pass in the same frame.
+VkRenderPass CreateColorDepthRenderPass(VkAttachmentLoadOp loadOp, VkImageLayout colorFinalLayout, VkAttachmentStoreOp depthStoreOp) {
+
+    bool loadAttachments = loadOp == VK_ATTACHMENT_LOAD_OP_LOAD;
 
     VkAttachmentDescription colorAttachment{};
     colorAttachment.format = vk_SwapChainImageFormat;
     colorAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
 
-    colorAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+    colorAttachment.loadOp = loadOp;
     colorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
 
     colorAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
     colorAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
 
-    colorAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-    colorAttachment.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+    colorAttachment.initialLayout = loadAttachments ? VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL : VK_IMAGE_LAYOUT_UNDEFINED;
+    colorAttachment.finalLayout = colorFinalLayout;
 
     VkAttachmentReference colorAttachmentRef{};
     colorAttachmentRef.attachment = 0;
@@ -106,11 +113,11 @@ void CreateRenderPass() {
     VkAttachmentDescription depthAttachment{};
     depthAttachment.format = FindDepthFormat();
     depthAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
-    depthAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
-    depthAttachment.storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+    depthAttachment.loadOp = loadOp;
+    depthAttachment.storeOp = depthStoreOp;
     depthAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
     depthAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-    depthAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    depthAttachment.initialLayout = loadAttachments ? VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL : VK_IMAGE_LAYOUT_UNDEFINED;
     depthAttachment.finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
 
     VkAttachmentReference depthAttachmentRef{};
@@ -152,13 +159,30 @@ void CreateRenderPass() {
     //renderPassInfo.dependencyCount = 1;
     //renderPassInfo.pDependencies = &dependency;
 
-    if (vkCreateRenderPass(vk_LogicalDevice, &renderPassInfo, nullptr, &vk_RenderPass) != VK_SUCCESS) {
+    VkRenderPass renderPass;
+    if (vkCreateRenderPass(vk_LogicalDevice, &renderPassInfo, nullptr, &renderPass) != VK_SUCCESS) {
         throw std::runtime_error("failed to create render pass!");
     }
+
+    return renderPass;
+}
+
+// Neither exists with dynamic rendering, vk_RenderPass stays VK_NULL_HANDLE and vk_SwapChainFramebuffers empty.
+void CreateRenderPass() {
+
+    if (IsDynamicRenderingActive()) {
+        return;
+    }
+
+    vk_RenderPass = CreateColorDepthRenderPass(VK_ATTACHMENT_LOAD_OP_CLEAR, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR, VK_ATTACHMENT_STORE_OP_DONT_CARE);
 }
 
 void CreateFramebuffers() {
 
+    if (IsDynamicRenderingActive()) {
+        return;
+    }
+
     vk_SwapChainFramebuffers.resize(vk_SwapChainImageViews.size());
 
     for (size_t i = 0; i < vk_SwapChainImageViews.size(); i++) {
@@ -187,10 +211,17 @@ void CreateDepthResources() {
 
     VkFormat depthFormat = FindDepthFormat();
 
-    CreateImage_VMA(vk_SwapChainExtent.width, vk_SwapChainExtent.height, depthFormat, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT, 0, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, vk_DepthImage, vma_DepthImageAllocation);
+    // Sampled by the Hi-Z build of the occlusion culling.
+    VkImageUsageFlags depthUsage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
+    if (USE_OCCLUSION_CULLING && IsDepthFormatSampleable(depthFormat)) {
+        depthUsage |= VK_IMAGE_USAGE_SAMPLED_BIT;
+    }
+
+    CreateImage_VMA(vk_SwapChainExtent.width, vk_SwapChainExtent.height, depthFormat, VK_IMAGE_TILING_OPTIMAL, depthUsage, 0, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, vk_DepthImage, vma_DepthImageAllocation);
     vk_DepthImageView = CreateImageView(vk_DepthImage, depthFormat, VK_IMAGE_ASPECT_DEPTH_BIT);
 
-    TransitionImageLayout(vk_DepthImage, depthFormat, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL);
+    // No layout transition here, it would wait for the graphics queue and with it every frame in flight when the swap chain is
+    // recreated. The first pass of every frame takes the depth image from UNDEFINED, through the render pass or its own barrier.
 }
 
 
@@ -210,6 +241,38 @@ void CleanUpSwapChain() {
     vkDestroySwapchainKHR(vk_LogicalDevice, vk_SwapChain, nullptr);
 }
 
+// Hands the current swap chain and everything sized to it to the deferred deletion queue. Frames in flight keep rendering to and
+// presenting the old images, the handles stay valid until CreateSwapChain has passed the old swap chain on as oldSwapchain.
+void RetireSwapChain() {
+
+    VkSwapchainKHR swapChain = vk_SwapChain;
+    std::vector<VkImageView> swapChainImageViews = vk_SwapChainImageViews;
+    std::vector<VkFramebuffer> swapChainFramebuffers = vk_SwapChainFramebuffers;
+
+    VkImage depthImage = vk_DepthImage;
+    VmaAllocation depthImageAllocation = vma_DepthImageAllocation;
+    VkImageView depthImageView = vk_DepthImageView;
+
+    DeferDeletion([=]() {
+
+        vkDestroyImageView(vk_LogicalDevice, depthImageView, nullptr);
+        vmaDestroyImage(vma_Allocator, depthImage, depthImageAllocation);
+
+        for (VkFramebuffer framebuffer : swapChainFramebuffers) {
+            vkDestroyFramebuffer(vk_LogicalDevice, framebuffer, nullptr);
+        }
+
+        for (VkImageView imageView : swapChainImageViews) {
+            vkDestroyImageView(vk_LogicalDevice, imageView, nullptr);
+        }
+
+        vkDestroySwapchainKHR(vk_LogicalDevice, swapChain, nullptr);
+    });
+
+    vk_SwapChainFramebuffers.clear();
+}
+
+// Does not wait for the GPU, see RetireSwapChain.
 void RecreateSwapChain(GLFWwindow& window) {
 
     int width = 0, height = 0;
@@ -219,9 +282,7 @@ void RecreateSwapChain(GLFWwindow& window) {
         glfwWaitEvents();
     }
 
-    vkDeviceWaitIdle(vk_LogicalDevice);
-
-    CleanUpSwapChain();
+    RetireSwapChain();
 
     CreateSwapChain(window);
     CreateImageViews();
@@ -1,5 +1,6 @@
 
 #include "VulkanHandlingFunctions.h"
+#include "TextureConverterUtils.h"
 
 #include "ft2build.h"
 #include FT_FREETYPE_H
@@ -8,6 +9,8 @@ class HelloTriangleApplication {
 public:
     void Run() {
 
+        JobSystemShutdownGuard jobSystemShutdownGuard;
+
         //InitFontLibrary();
         //LoadFont();
 
@@ -83,7 +86,13 @@ private:
 private:
 
     void MainLoop() {
+
+        PrintPresentationPolicy(presentationPolicy);
+
         while (!glfwWindowShouldClose(window)) {
+            if (presentationPolicy.latencyLimiter) {
+                WaitForCurrentFrameInFlight();
+            }
             glfwPollEvents();
             DrawFrame(*window);
         }
@@ -106,6 +115,7 @@ private:
 
         glfwSetWindowUserPointer(window, this);
         glfwSetFramebufferSizeCallback(window, FramebufferResizeCallback);
+        glfwSetKeyCallback(window, KeyCallback);
     }
 
     //static void FramebufferResizeCallback() {
@@ -118,6 +128,18 @@ private:
         framebufferResized = true;
     }
 
+    static void KeyCallback(GLFWwindow* window, int key, int scancode, int action, int mods) {
+
+        if (key == GLFW_KEY_F2 && action == GLFW_PRESS) {
+            depthPrepassEnabled = !depthPrepassEnabled;
+            std::cout << "Depth pre-pass := " << (depthPrepassEnabled ? "on" : "off") << std::endl;
+        }
+
+        if (key == GLFW_KEY_F3 && action == GLFW_PRESS) {
+            CyclePresentationPolicyPresets();
+        }
+    }
+
     void GlfwCleanup() {
         glfwDestroyWindow(window);
         glfwTerminate();
@@ -133,7 +155,16 @@ private:
 
 };
 
-int main() {
+int main(int argc, char** argv) {
+
+    // Offline conversion only, the window and Vulkan are never brought up.
+    if (argc >= 3 && std::string(argv[1]) == "--convert-textures") {
+        return ConvertTexturesInDirectory(argv[2]) == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+
+    ParsePresentationPolicyArguments(argc, argv, presentationPolicy);
+    presentationPolicy.framesInFlight = std::clamp(presentationPolicy.framesInFlight, 1u, static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT));
+
     HelloTriangleApplication app;
 
     try {